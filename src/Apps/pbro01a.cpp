@@ -71,6 +71,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/thread/thread.hpp>
 
+#include <sys/stat.h>
+
 #include <vector>
 
 #include "../lspfall.h"
@@ -79,6 +81,7 @@
 #include "pbro01a.h"
 
 #define CLRTABLE   "EDITCLRS"
+#define HLT_INTERVAL 1024
 
 using namespace boost ;
 using namespace std   ;
@@ -215,8 +218,10 @@ void pbro01a::Browse()
 	msg          = ""    ;
 	zxcmd        = ""    ;
 	startCol     = 1     ;
-	maxCol       = 1     ;
 	hltdl        = 0     ;
+	hlgen        = 0     ;
+	wfirst       = 0     ;
+	wlast        = 0     ;
 	bhltStatus   = BHLT_STOPPED ;
 
 	read_file() ;
@@ -368,27 +373,14 @@ void pbro01a::Browse()
 
 void pbro01a::read_file()
 {
-	string inLine ;
-
-	b_shadow t ;
-
 	int rc ;
-	int i  ;
-	int j  ;
-
-	bool cr = true ;
 
 	size_t p1 ;
-	size_t p2 ;
 	size_t maxl = ( reclen == 0 ) ? zareaw : reclen ;
 
-	char x ;
-
 	RC      = 0 ;
 	topLine = 0 ;
 
-	std::ifstream fin ;
-
 	try
 	{
 		if ( !exists( zfile ) )
@@ -421,19 +413,6 @@ void pbro01a::read_file()
 		return    ;
 	}
 
-	fin.open( zfile.c_str() ) ;
-
-	if ( !fin.is_open() )
-	{
-		vreplace( "ZVAL1", strerror( errno ) ) ;
-		vreplace( "ZVAL2", zfile ) ;
-		vput( "ZVAL1 ZVAL2", SHARED ) ;
-		XRC  = 20 ;
-		XRSN = 12 ;
-		ZRESULT = "PSYS011U" ;
-		return    ;
-	}
-
 	fileType = "text/plain" ;
 	magic_t cookie = magic_open( MAGIC_CONTINUE | MAGIC_ERROR | MAGIC_MIME | MAGIC_SYMLINK ) ;
 	rc = magic_load( cookie, nullptr ) ;
@@ -459,77 +438,52 @@ void pbro01a::read_file()
 	}
 	magic_close( cookie ) ;
 
-	maxLines = 1 ;
-	data.clear()   ;
-	shadow.clear() ;
-	data.push_back( centre( " Top of Data ", zareaw, '*' ) ) ;
-	shadow.push_back( t ) ;
-
 	if      ( binOn )  { asBin = true ; }
 	else if ( textOn ) { asBin = false ; }
 
+	//
+	// Stop the background hilight task using the current data before it is replaced.
+	//
+
+	boost::lock_guard<boost::mutex> lock( mtx_hlt ) ;
+
+	++hlgen ;
+	hlcheck.clear() ;
+	wshadow.clear() ;
+	hiComplete = false ;
+	hltdl      = 0 ;
+	cond_hlt.notify_all() ;
+
+	if ( !data.open( zfile, ( asBin || reclen > 0 ) ? maxl : 0, zareaw, !optNoConvTabs ) )
+	{
+		vreplace( "ZVAL1", strerror( errno ) ) ;
+		vreplace( "ZVAL2", zfile ) ;
+		vput( "ZVAL1 ZVAL2", SHARED ) ;
+		XRC  = 20 ;
+		XRSN = 12 ;
+		ZRESULT = "PSYS011U" ;
+		return    ;
+	}
+
 	detLang = "NONE" ;
 
+	if ( !data.has_line( 2 ) )
+	{
+		vreplace( "ZVAL1", zfile ) ;
+		vput( "ZVAL1", SHARED ) ;
+		XRC  = 12 ;
+		XRSN = 0  ;
+		ZRESULT = "PSYS011P" ;
+		return    ;
+	}
+
 	if ( asBin || reclen > 0 )
 	{
-		inLine = string( maxl, ' ' ) ;
-		maxCol = maxl ;
-		i      = 0    ;
-		while ( true )
-		{
-			fin.get( x ) ;
-			if ( fin.fail() != 0 ) { break ; } ;
-			inLine[ i ] = x ;
-			++i ;
-			if ( ( reclen > 0 && i == reclen ) || ( reclen == 0 && i == zareaw ) )
-			{
-				data.push_back( inLine )     ;
-				inLine = string( maxl, ' ' ) ;
-				shadow.push_back( t ) ;
-				++maxLines ;
-				i = 0      ;
-			}
-		}
-		if ( i > 0 )
-		{
-			inLine.resize( i )       ;
-			data.push_back( inLine ) ;
-			shadow.push_back( t ) ;
-			++maxLines ;
-		}
 		fileType  = "application/octet-stream" ;
 		hilightOn = false ;
 	}
 	else
 	{
-		while ( getline( fin, inLine ) )
-		{
-			if ( !optNoConvTabs )
-			{
-				p1 = inLine.find( '\t' ) ;
-				while ( p1 != string::npos )
-				{
-					j = 8 - ( p1 % 8 ) ;
-					inLine.replace( p1, 1, j, ' ' ) ;
-					p1 = inLine.find( '\t', p1 + 1 ) ;
-				}
-			}
-			if ( cr && ( inLine.size() == 0 || inLine.back() != 0x0D ) )
-			{
-				cr = false ;
-			}
-			if ( maxCol < inLine.size() ) { maxCol = inLine.size() ; }
-			data.push_back( inLine ) ;
-			shadow.push_back( t ) ;
-			++maxLines ;
-		}
-		if ( cr )
-		{
-			for ( auto it = data.begin() + 1 ; it != data.end() ; ++it )
-			{
-				it->pop_back() ;
-			}
-		}
 		if ( entLang == "" || entLang == "AUTO" )
 		{
 			detLang = determineLang() ;
@@ -540,64 +494,29 @@ void pbro01a::read_file()
 		}
 		load_language_colours() ;
 		set_language_fvars( detLang ) ;
+		data.set_ansi( detLang == "ANSI" ) ;
 		hilightOn = true ;
 	}
 
-	if ( maxLines == 1 )
-	{
-		vreplace( "ZVAL1", zfile ) ;
-		vput( "ZVAL1", SHARED ) ;
-		XRC  = 12 ;
-		XRSN = 0  ;
-		ZRESULT = "PSYS011P" ;
-		return    ;
-	}
-
-	++maxCol   ;
-	++maxLines ;
-
-	data.push_back( centre( " Bottom of Data ", zareaw, '*' ) ) ;
-	shadow.push_back( t ) ;
-	fin.close() ;
-
 	fscroll = ( zfile.size() < ( zareaw - 41 ) ) ? "NO" : "YES" ;
-
-	if ( detLang == "ANSI" )
-	{
-		for ( int i = 0 ; i < data.size() ; ++i )
-		{
-			shadow[ i ].bs_line = data[ i ] ;
-			string& t = data[ i ] ;
-			p1 = t.find( ansi_start ) ;
-			while ( p1 != string::npos )
-			{
-				p2 = t.find_first_not_of( ansi_codes, p1+2 ) ;
-				if ( p2 == string::npos ) { break ; }
-				if ( t[ p2 ] != ansi_end )
-				{
-					p1 = t.find( ansi_start, p2 ) ;
-					continue ;
-				}
-				t.erase( p1, p2-p1+1 ) ;
-				p1 = t.find( ansi_start, p1 ) ;
-			}
-		}
-	}
 }
 
 
 void pbro01a::fill_dynamic_area()
 {
 	//
-	// Fill dynamic area from the data vector.
+	// Fill dynamic area from the file data.
 	//
 
 	string t1 ;
+	string t2 ;
 	string t3 ;
 	string t4 ;
 
 	int ln ;
 
+	bool dline ;
+
 	if ( colsOn )
 	{
 		zarea   = getColumnLine() ;
@@ -611,13 +530,15 @@ void pbro01a::fill_dynamic_area()
 
 	if ( hexOn )
 	{
-		for ( uint k = topLine ; k < (topLine + zaread) ; ++k )
+		for ( int k = topLine ; k < (topLine + zaread) ; ++k )
 		{
-			if ( k > 0 && k < data.size()-1 )
+			t2    = data.at( k ) ;
+			dline = ( k > 0 && data.has_line( k + 1 ) ) ;
+			if ( dline )
 			{
-				ln = data.at( k ).size() - startCol + 1 ;
+				ln = t2.size() - startCol + 1 ;
 				if ( ln > zareaw ) { ln = zareaw ; }
-				t1 = substr( data.at( k ), startCol, zareaw ) ;
+				t1 = substr( t2, startCol, zareaw ) ;
 				if ( vertOn )
 				{
 					t3 = cs2xs1( t1, 0, ln ) ;
@@ -637,21 +558,22 @@ void pbro01a::fill_dynamic_area()
 			}
 			else
 			{
-				zarea   += substr( data.at( k ), 1, zareaw ) ;
+				zarea   += substr( t2, 1, zareaw ) ;
 				zshadow += s1b ;
 			}
-			if ( zarea.size() >= zasize || k >= ( data.size() - 1 ) ) { break ; }
+			if ( zarea.size() >= zasize || ( k > 0 && !dline ) ) { break ; }
 		}
 	}
 	else
 	{
 		for ( int k = topLine ; k < (topLine + zaread) ; ++k )
 		{
-			if ( k > 0 && k < data.size()-1 ) { t1 = substr( data.at( k ), startCol, zareaw ) ; }
-			else                              { t1 = substr( data.at( k ), 1, zareaw )        ; }
+			dline = ( k > 0 && data.has_line( k + 1 ) ) ;
+			if ( dline ) { t1 = substr( data.at( k ), startCol, zareaw ) ; }
+			else         { t1 = substr( data.at( k ), 1, zareaw )        ; }
 			zarea += t1 ;
-			if ( zarea.size() >= zasize ) { break ; }
-			if ( k == data.size() - 1 )   { break ; }
+			if ( zarea.size() >= zasize )  { break ; }
+			if ( k > 0 && !dline )         { break ; }
 		}
 
 	}
@@ -672,36 +594,45 @@ void pbro01a::fill_zshadow()
 	//
 	// Copy the relevant parts of the shadow data to the zshadow variable.
 	//
-	// If the background hilight task is still busy, wait until it has completed the
+	// If the background hilight task is still busy, wait until it has passed the
 	// current screen of data.
 	//
 
 	int i  ;
+	int k  ;
 	int w  ;
 
-	while ( bhltStatus == BHLT_RUNNING && hltdl < ( topLine + zaread ) )
+	while ( bhltStatus == BHLT_RUNNING && !hiComplete && hltdl < ( topLine + zaread ) )
 	{
 		boost::this_thread::sleep_for( boost::chrono::milliseconds( 5 ) ) ;
 	}
 
-	vector<b_shadow>::iterator its ;
-	vector<string>::iterator itd ;
+	k = ( topLine == 0 ) ? 1 : topLine ;
+	if ( wshadow.empty() || k < wfirst || ( k + zaread ) > wlast )
+	{
+		fill_shadow_window( k ) ;
+	}
 
 	string::const_iterator it1 ;
 	string::const_iterator it2 ;
 
-	itd = data.begin() + topLine ;
-	its = shadow.begin() + topLine ;
-	i   = ( colsOn ) ? 1 : 0 ;
+	i = ( colsOn ) ? 1 : 0 ;
+	k = topLine ;
 
-	for ( ; i < zaread && itd != data.end() ; ++i, ++its, ++itd )
+	for ( ; i < zaread && data.has_line( k ) ; ++i, ++k )
 	{
-		if ( topLine == 0 && i == ( colsOn ) ? 1 : 0 ) { continue ; }
-		if ( its->bs_Shadow.size() >= startCol )
+		if ( k == 0 ) { continue ; }
+		if ( k < wfirst || k >= ( wfirst + int( wshadow.size() ) ) )
+		{
+			if ( hexOn ) { i += 3 ; }
+			continue ;
+		}
+		const string& s = wshadow[ k - wfirst ] ;
+		if ( s.size() >= startCol )
 		{
 			it1 = zshadow.begin() + ( zareaw * i ) ;
-			it2 = its->bs_Shadow.begin() + startCol - 1 ;
-			w = its->bs_Shadow.size() - startCol + 1 ;
+			it2 = s.begin() + startCol - 1 ;
+			w = s.size() - startCol + 1 ;
 			if ( w > zareaw ) { w = zareaw ; }
 			zshadow.replace( it1, it1+w, it2, it2+w ) ;
 		}
@@ -710,56 +641,128 @@ void pbro01a::fill_zshadow()
 }
 
 
+void pbro01a::fill_shadow_window( int first )
+{
+	//
+	// Build the shadow data for a window of lines around the screen.
+	//
+	// Only the hilight state at every HLT_INTERVAL lines is kept by the background task, so
+	// start from the nearest saved state before the window and hilight forward from there.
+	//
+
+	int ln ;
+
+	size_t c ;
+
+	string s ;
+
+	hilight h ;
+
+	wshadow.clear() ;
+
+	wfirst = max( 1, first - zaread ) ;
+	wlast  = first + 2 * zaread ;
+
+	{
+		boost::lock_guard<boost::mutex> lock( mtx_hlt ) ;
+		if ( hlcheck.empty() ) { return ; }
+		c = min( size_t( wfirst - 1 ) / HLT_INTERVAL, hlcheck.size() - 1 ) ;
+		h = hlcheck[ c ] ;
+	}
+
+	for ( ln = c * HLT_INTERVAL + 1 ; ln < wlast && data.has_line( ln + 1 ) ; ++ln )
+	{
+		s = "" ;
+		addHilight( lg, h, hilight_line( ln ), s ) ;
+		if ( h.hl_abend )
+		{
+			wshadow.clear() ;
+			return ;
+		}
+		if ( ln >= wfirst )
+		{
+			wshadow.push_back( s ) ;
+		}
+	}
+}
+
+
+string pbro01a::hilight_line( int ln )
+{
+	//
+	// Return the line to pass to the hilighter.  ANSI colour sequences are
+	// removed from the displayed line so use the raw line for ANSI.
+	//
+
+	return ( detLang == "ANSI" ) ? data.raw( ln ) : data.at( ln ) ;
+}
+
+
 void pbro01a::hilightData()
 {
 	//
-	// Background task to build shadow data.
+	// Background task to hilight the data.
+	//
+	// Save a copy of the hilight state every HLT_INTERVAL lines so the shadow data for any
+	// part of the file can be recreated quickly by fill_shadow_window().  The pass is abandoned
+	// if the data or hilight options change (hlgen incremented).
 	//
 
 	boost::mutex mutex ;
 
-	string::const_iterator it1 ;
-	string::const_iterator it2 ;
+	uint gen ;
+
+	string s ;
 
 	bhltStatus = BHLT_RUNNING ;
 
 	while ( bhltStatus == BHLT_RUNNING )
 	{
 		boost::mutex::scoped_lock lk( mutex ) ;
-		cond_hlt.wait_for( lk, boost::chrono::milliseconds( 200 ) ) ;
+		if ( detLang == "NONE" || hiComplete )
+		{
+			cond_hlt.wait_for( lk, boost::chrono::milliseconds( 200 ) ) ;
+		}
 		lk.unlock() ;
 		if ( detLang == "NONE" || hiComplete ) { continue ; }
-		hlight.hl_language = detLang ;
-		hlight.hl_oBrac1   = 0 ;
-		hlight.hl_oBrac2   = 0 ;
-		hlight.hl_oIf      = 0 ;
-		hlight.hl_oDo      = 0 ;
-		hlight.hl_ifLogic  = true ;
-		hlight.hl_doLogic  = true ;
-		hlight.hl_Paren    = true ;
-		hlight.hl_oComment = false ;
-
-		for ( hltdl = 1 ; hltdl < data.size() - 1 && bhltStatus == BHLT_RUNNING ; ++hltdl )
-		{
-			auto& refs = shadow.at( hltdl ) ;
-			auto& refd = ( detLang == "ANSI" ) ? refs.bs_line : data.at( hltdl ) ;
-			addHilight( lg, hlight, refd, refs.bs_Shadow ) ;
+
+		{
+			boost::lock_guard<boost::mutex> lock( mtx_hlt ) ;
+			gen = hlgen ;
+			hlcheck.clear() ;
+			hlight.hl_language = detLang ;
+			hlight.hl_oBrac1   = 0 ;
+			hlight.hl_oBrac2   = 0 ;
+			hlight.hl_oIf      = 0 ;
+			hlight.hl_oDo      = 0 ;
+			hlight.hl_ifLogic  = true ;
+			hlight.hl_doLogic  = true ;
+			hlight.hl_Paren    = true ;
+			hlight.hl_oComment = false ;
+		}
+
+		for ( hltdl = 1 ; bhltStatus == BHLT_RUNNING ; ++hltdl )
+		{
+			boost::lock_guard<boost::mutex> lock( mtx_hlt ) ;
+			if ( gen != hlgen || !data.has_line( hltdl + 1 ) ) { break ; }
+			if ( ( hltdl - 1 ) % HLT_INTERVAL == 0 )
+			{
+				hlcheck.push_back( hlight ) ;
+			}
+			s = "" ;
+			addHilight( lg, hlight, hilight_line( hltdl ), s ) ;
 			if ( hlight.hl_abend )
 			{
 				bhltStatus = BHLT_STOPPED ;
 				return ;
 			}
-			refs.bs_vShadow = true ;
-			refs.bs_wShadow = ( hlight.hl_oBrac1 == 0 &&
-					    hlight.hl_oBrac2 == 0 &&
-					    hlight.hl_oIf    == 0 &&
-					    hlight.hl_oDo    == 0 &&
-					   !hlight.hl_continue    &&
-					   !hlight.hl_oQuote      &&
-					   !hlight.hl_oComment ) ;
-		}
-		hiComplete = true ;
-		hltdl     += zaread ;
+		}
+		boost::lock_guard<boost::mutex> lock( mtx_hlt ) ;
+		if ( gen == hlgen && bhltStatus == BHLT_RUNNING )
+		{
+			hiComplete = true ;
+			hltdl     += zaread ;
+		}
 	}
 	bhltStatus = BHLT_STOPPED ;
 }
@@ -771,7 +774,7 @@ void pbro01a::hilite_cursor()
 
 	for ( i = curpos-1 ; i < zasize ; ++i )
 	{
-		if ( zarea[ i ] == ' ' || ( i / zareaw ) > ( data.size() - topLine - 2 ) ) { break ; }
+		if ( zarea[ i ] == ' ' || !data.has_line( topLine + ( i / zareaw ) + 1 ) ) { break ; }
 		zshadow[ i ] = N_WHITE ;
 	}
 	for ( i = curpos-1 ; i >= 0 ; --i )
@@ -843,7 +846,7 @@ void pbro01a::action_ScrollDown()
 	else
 	{
 		amnt = ( hexOn && !datatype( zscrolla, 'W') ) ? 4 : 1 ;
-		for ( ; topLine < ( data.size() - 1 ) ; ++topLine )
+		for ( ; data.has_line( topLine + 1 ) ; ++topLine )
 		{
 			t += amnt ;
 			if ( t > zscrolln ) { break ; }
@@ -872,7 +875,7 @@ void pbro01a::action_ScrollRight()
 {
 	if ( zscrolla == "MAX" )
 	{
-		startCol = maxCol - zareaw ;
+		startCol = data.max_width() + 1 - zareaw ;
 	}
 	else
 	{
@@ -1055,10 +1058,12 @@ void pbro01a::action_HILIGHT( a_parms& parms )
 	load_language_colours() ;
 	set_language_fvars( detLang ) ;
 
+	boost::lock_guard<boost::mutex> lock( mtx_hlt ) ;
+
 	if ( parms.w2 == "ON" )
 	{
-		shadow[ 1 ].bs_wShadow = false ;
-		shadow[ 1 ].bs_vShadow = false ;
+		++hlgen ;
+		wshadow.clear() ;
 		hiComplete   = false ;
 		hilightOn    = true ;
 		rebuildZAREA = true ;
@@ -1067,8 +1072,8 @@ void pbro01a::action_HILIGHT( a_parms& parms )
 	}
 	else if ( parms.w2 == "OFF" )
 	{
-		shadow[ 1 ].bs_wShadow = false ;
-		shadow[ 1 ].bs_vShadow = false ;
+		++hlgen ;
+		wshadow.clear() ;
 		hiComplete   = false ;
 		hilightOn    = false ;
 		rebuildZAREA = true ;
@@ -1205,9 +1210,9 @@ void pbro01a::action_LOCATE( a_parms& parms )
 	if ( datatype( parms.w2, 'W' ) )
 	{
 		topLine = ds2d( parms.w2 ) ;
-		if ( topLine >= maxLines )
+		if ( !data.has_line( topLine ) )
 		{
-			topLine = maxLines - 1 ;
+			topLine = data.size() - 1 ;
 		}
 		rebuildZAREA = true ;
 	}
@@ -1646,20 +1651,27 @@ void pbro01a::performFind()
 	int c2 ;
 	int oX = -1 ;
 	int oY = -1 ;
+	int last ;
+	int fl ;
 
 	size_t p1 ;
 
 	bool skip ;
 	bool found ;
 	bool found1 ;
+	bool fast ;
 
 	string::const_iterator itss ;
 	string::const_iterator itse ;
 
+	string line ;
+
 	smatch results ;
 
 	find_parms.f_rstring = "" ;
 
+	last = data.size() - 2 ;
+
 	if ( find_parms.f_dir != 'F' && find_parms.f_dir != 'A' && find_parms.f_dir != 'L' )
 	{
 		if ( zcurfld == "ZAREA" )
@@ -1704,7 +1716,7 @@ void pbro01a::performFind()
 	else if ( ( find_parms.f_dir == 'L' ) ||
 		  ( find_parms.f_dir == 'P' && topLine == 0 && ( oY == 0 || oY == -1 ) ) )
 	{
-		dl = data.size() - 2 ;
+		dl = last ;
 	}
 	else if ( find_parms.f_dir == 'P' && oX == 0 )
 	{
@@ -1733,7 +1745,7 @@ void pbro01a::performFind()
 		dl = topLine ;
 	}
 
-	if ( dl > data.size() - 2 )
+	if ( dl > last )
 	{
 		dl = topLine ;
 	}
@@ -1743,13 +1755,39 @@ void pbro01a::performFind()
 	}
 
 	find_parms.f_top    = ( dl == 1               ) ;
-	find_parms.f_bottom = ( dl == data.size() - 2 ) ;
+	find_parms.f_bottom = ( dl == last ) ;
+
+	//
+	// For a simple string, search the file data directly for the next line that can contain
+	// the string instead of formatting and searching each line in turn.
+	//
+
+	fast = ( !find_parms.f_regreq && data.can_search( find_parms.f_string ) ) ;
 
 	while ( true )
 	{
+		if ( fast )
+		{
+			fl = data.find_line( dl,
+					     find_parms.f_string,
+					     !find_parms.f_asis,
+					     ( find_parms.f_dir != 'P' && find_parms.f_dir != 'L' ) ) ;
+			if ( fl == 0 )
+			{
+				if      ( find_parms.f_dir == 'F' ) { find_parms.f_dir = 'N' ; }
+				else if ( find_parms.f_dir == 'L' ) { find_parms.f_dir = 'P' ; }
+				break ;
+			}
+			if ( fl != dl )
+			{
+				dl = fl ;
+				oX = -1 ;
+			}
+		}
+		line = data.at( dl ) ;
 		skip = false ;
 		c1   = 0 ;
-		c2   = data.at( dl ).size() - 1 ;
+		c2   = line.size() - 1 ;
 
 		if ( find_parms.f_scol > 0 )
 		{
@@ -1768,9 +1806,9 @@ void pbro01a::performFind()
 
 		if ( oX > 0 )
 		{
-			if ( oX > data.at( dl ).size() )
+			if ( oX > line.size() )
 			{
-				oX = data.at( dl ).size() ;
+				oX = line.size() ;
 			}
 			if ( find_parms.f_dir == 'P' || find_parms.f_dir == 'L' )
 			{
@@ -1805,7 +1843,7 @@ void pbro01a::performFind()
 			{
 				++dl ;
 			}
-			if ( dl < 1 || dl > data.size()-2 ) { break ; }
+			if ( dl < 1 || dl > last ) { break ; }
 			continue ;
 		}
 
@@ -1814,10 +1852,10 @@ void pbro01a::performFind()
 			found  = false ;
 			found1 = true  ;
 			if ( find_parms.f_mtch == 'S' && c1 > 0 ) { --c1 ; }
-			itss   = data.at( dl ).begin() + c1 ;
+			itss   = line.begin() + c1 ;
 			if ( find_parms.f_oncol )
 			{
-				itse = data.at( dl ).end() ;
+				itse = line.end() ;
 				if ( regex_search( itss, itse, results, find_parms.f_regexp ) )
 				{
 					if ( itss == results[ 0 ].first )
@@ -1884,11 +1922,11 @@ void pbro01a::performFind()
 				{
 					if ( find_parms.f_asis )
 					{
-						p1 = data.at( dl ).rfind( find_parms.f_string, c2 ) ;
+						p1 = line.rfind( find_parms.f_string, c2 ) ;
 					}
 					else
 					{
-						p1 = upper( data.at( dl ) ).rfind( find_parms.f_string, c2 ) ;
+						p1 = upper( line ).rfind( find_parms.f_string, c2 ) ;
 					}
 					c2 = p1 - 1 ;
 				}
@@ -1896,11 +1934,11 @@ void pbro01a::performFind()
 				{
 					if ( find_parms.f_asis )
 					{
-						p1 = data.at( dl ).find( find_parms.f_string, c1 ) ;
+						p1 = line.find( find_parms.f_string, c1 ) ;
 					}
 					else
 					{
-						p1 = upper( data.at( dl ) ).find( find_parms.f_string, c1 ) ;
+						p1 = upper( line ).find( find_parms.f_string, c1 ) ;
 					}
 					c1 = p1 + 1 ;
 				}
@@ -1961,7 +1999,7 @@ void pbro01a::performFind()
 			if ( found ) { break ; }
 			--dl ;
 		}
-		if ( dl < 1 || dl > data.size() - 2 )
+		if ( dl < 1 || dl > last )
 		{
 			break ;
 		}
@@ -2310,9 +2348,9 @@ string pbro01a::determineLang()
 
 	if ( ansi_on )
 	{
-		for ( i = 1, j = 0 ; i < data.size() && i < 200 ; ++i )
+		for ( i = 1, j = 0 ; data.has_line( i + 1 ) && i < 200 ; ++i )
 		{
-			string& t = data.at( i ) ;
+			const string t = data.raw( i ) ;
 			p1 = t.find( ansi_start ) ;
 			while ( p1 != string::npos )
 			{
@@ -2349,9 +2387,9 @@ string pbro01a::determineLang()
 	if ( zfile.find( "/rexx/" )  != string::npos ) { return rexx  ; }
 	if ( zfile.find( "/cobol/" ) != string::npos ) { return cobol ; }
 
-	for ( i = 1 ; i < data.size() && i < 100 ; ++i )
+	for ( i = 1 ; data.has_line( i + 1 ) && i < 100 ; ++i )
 	{
-		const string& t = data.at( i ) ;
+		const string t = data.raw( i ) ;
 		if ( t.size() == 0 ) { continue ; }
 		w = word( t, 1 ) ;
 		if ( findword( w, "#!/bin/sh #!/bin/bash" ) ||
@@ -2400,3 +2438,542 @@ string pbro01a::determineLang()
 	}
 	return def ;
 }
+
+
+/**************************************************************************************************************/
+/**********************************               FILE DATA                  **********************************/
+/**************************************************************************************************************/
+
+b_data::b_data()
+{
+	base     = nullptr ;
+	fd       = -1 ;
+	datasize = 0 ;
+	loaded   = 0 ;
+	reclen   = 0 ;
+	banner   = 0 ;
+	maxw     = 0 ;
+	complete = true  ;
+	exptabs  = false ;
+	ansi     = false ;
+	stopping = false ;
+	bThread  = nullptr ;
+}
+
+
+b_data::~b_data()
+{
+	close() ;
+}
+
+
+bool b_data::open( const string& file,
+		   size_t rlen,
+		   size_t width,
+		   bool tabs )
+{
+	//
+	// Open the file and start the background task to read it and index the lines.
+	// rlen > 0 splits the file into fixed length records instead of lines.
+	// tabs is true to expand tabs to the next multiple of 8 columns.
+	//
+	// Return false with errno set if the file cannot be opened.
+	//
+
+	struct stat sb ;
+
+	close() ;
+
+	fd = ::open( file.c_str(), O_RDONLY | O_CLOEXEC ) ;
+	if ( fd == -1 )
+	{
+		return false ;
+	}
+
+	if ( fstat( fd, &sb ) == -1 )
+	{
+		::close( fd ) ;
+		fd = -1 ;
+		return false ;
+	}
+
+	datasize = sb.st_size ;
+	loaded   = 0 ;
+	reclen   = rlen  ;
+	banner   = width ;
+	maxw     = rlen  ;
+	exptabs  = tabs  ;
+	ansi     = false ;
+
+	offsets.clear() ;
+	offsets.push_back( 0 ) ;
+
+	if ( datasize == 0 )
+	{
+		::close( fd ) ;
+		fd       = -1 ;
+		complete = true ;
+		return true ;
+	}
+
+	base = new char[ datasize ] ;
+
+	posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL ) ;
+
+	complete = false ;
+	stopping = false ;
+	bThread  = new boost::thread( &b_data::build_index, this ) ;
+
+	return true ;
+}
+
+
+void b_data::close()
+{
+	if ( bThread )
+	{
+		stopping = true ;
+		bThread->join() ;
+		delete bThread ;
+		bThread = nullptr ;
+	}
+
+	if ( fd != -1 )
+	{
+		::close( fd ) ;
+		fd = -1 ;
+	}
+
+	delete[] base ;
+	base = nullptr ;
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	datasize = 0 ;
+	loaded   = 0 ;
+	maxw     = 0 ;
+	complete = true ;
+	offsets.clear() ;
+	offsets.push_back( 0 ) ;
+	cond.notify_all() ;
+}
+
+
+void b_data::set_ansi( bool ansi_strip )
+{
+	//
+	// Set whether ANSI colour sequences are removed from lines returned by at().
+	//
+
+	ansi = ansi_strip ;
+}
+
+
+void b_data::build_index()
+{
+	//
+	// Background task to read the file and build the line start offsets and maximum line width.
+	// The file is read a chunk at a time and new offsets are added after each chunk so early lines
+	// can be displayed while the rest of the file is being read.  Fixed length records are not
+	// indexed, only the amount of data read is updated.
+	//
+	// offsets[ n ] is the start of line n+1.  A final entry past the end of the data is added
+	// if the last line has no newline, so line n always ends at offsets[ n ] - 1.
+	//
+	// Data is only written beyond the loaded offset, and readers only access data below it, so
+	// the buffer itself needs no lock.  If the file has been truncated, the data size is reduced
+	// to the amount read.
+	//
+
+	const size_t chunk = 256 * 1024 ;
+
+	size_t start = 0 ;
+	size_t len   ;
+	size_t w     ;
+	size_t t     ;
+	size_t width = 0 ;
+	size_t end   ;
+	size_t got   ;
+	size_t dsize = datasize ;
+
+	ssize_t n ;
+
+	const char* p ;
+	const char* e ;
+	const char* q ;
+	const char* tb ;
+
+	vector<size_t> noffs ;
+
+	for ( size_t pos = 0 ; pos < dsize && !stopping ; pos = end )
+	{
+		end = min( pos + chunk, dsize ) ;
+		for ( got = pos ; got < end ; got += n )
+		{
+			n = ::read( fd, base + got, end - got ) ;
+			if ( n < 0 && errno == EINTR ) { n = 0 ; continue ; }
+			if ( n <= 0 ) { break ; }
+		}
+		if ( got < end )
+		{
+			end   = got ;
+			dsize = got ;
+		}
+		if ( reclen == 0 )
+		{
+			p = base + pos ;
+			e = base + end ;
+			while ( p < e )
+			{
+				q = static_cast<const char*>( memchr( p, '\n', e - p ) ) ;
+				if ( !q ) { break ; }
+				len = ( q - base ) - start ;
+				if ( len > 0 && base[ start + len - 1 ] == 0x0D ) { --len ; }
+				w  = len ;
+				tb = ( exptabs ) ? static_cast<const char*>( memchr( base + start, '\t', len ) ) : nullptr ;
+				if ( tb )
+				{
+					w = tb - ( base + start ) ;
+					for ( ; tb < base + start + len ; ++tb )
+					{
+						w = ( *tb == '\t' ) ? ( w + 8 - ( w % 8 ) ) : w + 1 ;
+					}
+				}
+				if ( width < w ) { width = w ; }
+				start = q - base + 1 ;
+				noffs.push_back( start ) ;
+				p = q + 1 ;
+			}
+			if ( end == dsize && start < dsize )
+			{
+				t = dsize - start ;
+				if ( width < t ) { width = t ; }
+				noffs.push_back( dsize + 1 ) ;
+			}
+		}
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		offsets.insert( offsets.end(), noffs.begin(), noffs.end() ) ;
+		datasize = dsize ;
+		loaded   = end ;
+		if ( reclen == 0 ) { maxw = width ; }
+		cond.notify_all() ;
+		noffs.clear() ;
+	}
+
+	::close( fd ) ;
+	fd = -1 ;
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+	complete = true ;
+	cond.notify_all() ;
+}
+
+
+void b_data::wait_line( boost::unique_lock<boost::mutex>& lock,
+			size_t ln )
+{
+	//
+	// Wait until line ln has been indexed (or read for fixed length records) or the index is complete.
+	//
+
+	while ( !complete && ( ( reclen > 0 ) ? loaded < ln * reclen : offsets.size() <= ln ) )
+	{
+		cond.wait( lock ) ;
+	}
+}
+
+
+bool b_data::has_line( size_t ln )
+{
+	//
+	// Return true if line ln exists (including the Top and Bottom of Data lines).
+	// Only waits for the index to reach line ln, not for the whole file.
+	//
+
+	if ( ln == 0 ) { return true ; }
+
+	boost::unique_lock<boost::mutex> lock( mtx ) ;
+
+	wait_line( lock, ln ) ;
+
+	if ( reclen > 0 )
+	{
+		return ( ln <= ( datasize + reclen - 1 ) / reclen + 1 ) ;
+	}
+
+	return ( ln < offsets.size() + 1 ) ;
+}
+
+
+size_t b_data::size()
+{
+	//
+	// Return the number of lines including the Top and Bottom of Data lines.
+	// This waits for the index to complete.
+	//
+
+	boost::unique_lock<boost::mutex> lock( mtx ) ;
+
+	while ( !complete )
+	{
+		cond.wait( lock ) ;
+	}
+
+	if ( reclen > 0 )
+	{
+		return ( datasize + reclen - 1 ) / reclen + 2 ;
+	}
+
+	return offsets.size() + 1 ;
+}
+
+
+size_t b_data::max_width()
+{
+	boost::unique_lock<boost::mutex> lock( mtx ) ;
+
+	while ( !complete )
+	{
+		cond.wait( lock ) ;
+	}
+
+	return maxw ;
+}
+
+
+string b_data::at( size_t ln )
+{
+	return line( ln, ansi ) ;
+}
+
+
+string b_data::raw( size_t ln )
+{
+	return line( ln, false ) ;
+}
+
+
+string b_data::line( size_t ln,
+		     bool ansi_strip )
+{
+	//
+	// Return line ln formatted for display.
+	//
+	// Expand tabs in one pass rather than replacing each tab in place.
+	// Text lines have any trailing CR removed.
+	//
+
+	size_t s ;
+	size_t e ;
+	size_t p1 ;
+	size_t p2 ;
+
+	string t ;
+
+	const string ansi_start = "\x1B[" ;
+	const char   ansi_end   = 'm' ;
+	const string ansi_codes = "0123456789; " ;
+
+	if ( ln == 0 )
+	{
+		return centre( " Top of Data ", banner, '*' ) ;
+	}
+
+	{
+		boost::unique_lock<boost::mutex> lock( mtx ) ;
+		wait_line( lock, ln ) ;
+		if ( reclen > 0 )
+		{
+			s = ( ln - 1 ) * reclen ;
+			if ( s >= datasize )
+			{
+				return centre( " Bottom of Data ", banner, '*' ) ;
+			}
+			return string( base + s, min( reclen, datasize - s ) ) ;
+		}
+		if ( ln >= offsets.size() )
+		{
+			return centre( " Bottom of Data ", banner, '*' ) ;
+		}
+		s = offsets[ ln - 1 ] ;
+		e = min( offsets[ ln ] - 1, datasize ) ;
+	}
+
+	if ( e > s && base[ e - 1 ] == 0x0D ) { --e ; }
+
+	if ( exptabs && memchr( base + s, '\t', e - s ) )
+	{
+		t.reserve( e - s + 32 ) ;
+		for ( const char* p = base + s ; p < base + e ; ++p )
+		{
+			if ( *p == '\t' )
+			{
+				t.append( 8 - ( t.size() % 8 ), ' ' ) ;
+			}
+			else
+			{
+				t.push_back( *p ) ;
+			}
+		}
+	}
+	else
+	{
+		t.assign( base + s, e - s ) ;
+	}
+
+	if ( ansi_strip )
+	{
+		p1 = t.find( ansi_start ) ;
+		while ( p1 != string::npos )
+		{
+			p2 = t.find_first_not_of( ansi_codes, p1+2 ) ;
+			if ( p2 == string::npos ) { break ; }
+			if ( t[ p2 ] != ansi_end )
+			{
+				p1 = t.find( ansi_start, p2 ) ;
+				continue ;
+			}
+			t.erase( p1, p2-p1+1 ) ;
+			p1 = t.find( ansi_start, p1 ) ;
+		}
+	}
+
+	return t ;
+}
+
+
+size_t b_data::line_start( size_t ln )
+{
+	//
+	// Return the file offset of the start of data line ln.  Index must be complete.
+	//
+
+	return ( reclen > 0 ) ? ( ln - 1 ) * reclen : offsets[ ln - 1 ] ;
+}
+
+
+size_t b_data::line_of( size_t pos )
+{
+	//
+	// Return the data line containing file offset pos.  Index must be complete.
+	//
+
+	if ( reclen > 0 )
+	{
+		return pos / reclen + 1 ;
+	}
+
+	return upper_bound( offsets.begin(), offsets.end(), pos ) - offsets.begin() ;
+}
+
+
+bool b_data::can_search( const string& s )
+{
+	//
+	// Return true if every line that contains string s when formatted by at() also contains s
+	// in the file itself, so find_line() can be used to skip lines that cannot match.
+	//
+	// Expanding tabs only adds blanks and removing a trailing CR only shortens the line, so this
+	// is true unless s contains a blank and tabs are expanded.  Removing ANSI sequences can join
+	// text so searching is not possible for ANSI.
+	//
+
+	return ( !ansi && !s.empty() && ( reclen > 0 || !exptabs || s.find( ' ' ) == string::npos ) ) ;
+}
+
+
+size_t b_data::find_line( size_t ln,
+			  const string& s,
+			  bool icase,
+			  bool forward )
+{
+	//
+	// Search the file for string s starting at data line ln, forwards or backwards.
+	// Return the line containing the first occurrence found or 0 if there are none.
+	//
+	// The returned line may not match when formatted (eg. an occurrence that crosses a line end)
+	// so the caller must still check it and call again from the next line.
+	//
+	// For icase, s must be in upper case.  Use memmem()/memchr()/memrchr() as these are vectorised
+	// in the C library.  For a case insensitive search, look for both cases of the first character
+	// and compare the rest of the string ignoring case.
+	//
+
+	size_t n  ;
+	size_t st ;
+	size_t en ;
+
+	const char* p ;
+	const char* q ;
+	const char* r ;
+	const char* e ;
+
+	char c1 = s[ 0 ] ;
+	char c2 = tolower( c1 ) ;
+
+	const size_t l = s.size() ;
+
+	n = size() - 2 ;
+
+	if ( ln < 1 || ln > n || l > datasize ) { return 0 ; }
+
+	auto match = [ & ]( const char* p )->bool
+	{
+		for ( size_t i = 1 ; i < l ; ++i )
+		{
+			if ( toupper( (unsigned char)p[ i ] ) != (unsigned char)s[ i ] ) { return false ; }
+		}
+		return true ;
+	} ;
+
+	auto next = [ ]( const char* p, char c, const char* e )->const char*
+	{
+		const char* q = static_cast<const char*>( memchr( p, c, e - p ) ) ;
+		return ( q ) ? q : e ;
+	} ;
+
+	auto prev = [ this ]( const char* p, char c )->const char*
+	{
+		return static_cast<const char*>( memrchr( base, c, p - base ) ) ;
+	} ;
+
+	icase = icase && any_of( s.begin(), s.end(), []( char c ) { return isalpha( c ) ; } ) ;
+
+	if ( forward )
+	{
+		st = line_start( ln ) ;
+		if ( st + l > datasize ) { return 0 ; }
+		if ( !icase )
+		{
+			p = static_cast<const char*>( memmem( base + st, datasize - st, s.data(), l ) ) ;
+			return ( p ) ? line_of( p - base ) : 0 ;
+		}
+		e = base + datasize - l + 1 ;
+		q = next( base + st, c1, e ) ;
+		r = ( c1 == c2 ) ? e : next( base + st, c2, e ) ;
+		while ( true )
+		{
+			p = min( q, r ) ;
+			if ( p == e ) { break ; }
+			if ( match( p ) ) { return line_of( p - base ) ; }
+			if ( q == p ) { q = next( p + 1, c1, e ) ; }
+			if ( r == p ) { r = next( p + 1, c2, e ) ; }
+		}
+	}
+	else
+	{
+		en = ( ln < n ) ? line_start( ln + 1 ) : datasize ;
+		e  = base + min( en, datasize - l + 1 ) ;
+		q  = prev( e, c1 ) ;
+		r  = ( icase && c1 != c2 ) ? prev( e, c2 ) : nullptr ;
+		while ( q || r )
+		{
+			p = ( !q ) ? r : ( !r ) ? q : max( q, r ) ;
+			if ( icase ? match( p ) : ( memcmp( p, s.data(), l ) == 0 ) ) { return line_of( p - base ) ; }
+			if ( q == p ) { q = prev( p, c1 ) ; }
+			if ( r == p ) { r = prev( p, c2 ) ; }
+		}
+	}
+
+	return 0 ;
+}
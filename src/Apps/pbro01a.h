@@ -195,23 +195,80 @@ class a_cursor
 } ;
 
 
-class b_shadow
+class b_data
 {
+	//
+	// File data for BROWSE.
+	//
+	// A background thread reads the file into a single buffer a chunk at a time and builds an index
+	// of line start offsets, so lines near the top are available before the whole file has been read.
+	// Lines are formatted (tabs expanded, trailing CR removed, ANSI sequences removed) only when
+	// requested.
+	//
+	// The file is read rather than mapped so truncating it while it is being browsed cannot raise
+	// SIGBUS.  Data beyond the size at open time is ignored and a short read ends the file.
+	//
+	// Line 0 is the Top of Data line and line size()-1 is the Bottom of Data line.
+	// If reclen is non-zero, the file is split into fixed length records and not indexed.
+	//
+	// find_line() searches the file data for a string and returns the line containing the
+	// next (or previous) occurrence, so FIND only needs to format lines that may match.
+	//
+
+	public:
+		b_data() ;
+		~b_data() ;
+
+		bool open( const string&,
+			   size_t,
+			   size_t,
+			   bool ) ;
+
+		void close() ;
+
+		void set_ansi( bool ) ;
+
+		string at( size_t ) ;
+		string raw( size_t ) ;
+
+		bool   has_line( size_t ) ;
+		size_t size() ;
+		size_t max_width() ;
+
+		bool   can_search( const string& ) ;
+		size_t find_line( size_t,
+				  const string&,
+				  bool,
+				  bool ) ;
+
 	private:
-		string bs_Shadow ;
-		string bs_line ;
-		bool   bs_vShadow ;
-		bool   bs_wShadow ;
-		bool   bs_nsect   ;
-	b_shadow()
-	{
-		bs_Shadow  = ""    ;
-		bs_line    = ""    ;
-		bs_vShadow = false ;
-		bs_wShadow = false ;
-		bs_nsect   = false ;
-	}
-	friend class pbro01a ;
+		void build_index() ;
+		size_t line_start( size_t ) ;
+		size_t line_of( size_t ) ;
+		void wait_line( boost::unique_lock<boost::mutex>&,
+				size_t ) ;
+		string line( size_t,
+			     bool ) ;
+
+		char*  base     ;
+		int    fd       ;
+		size_t datasize ;
+		size_t loaded   ;
+		size_t reclen   ;
+		size_t banner   ;
+		size_t maxw     ;
+
+		bool complete ;
+		bool exptabs  ;
+		bool ansi     ;
+
+		std::atomic<bool> stopping ;
+
+		vector<size_t> offsets ;
+
+		boost::mutex mtx ;
+		boost::condition cond ;
+		boost::thread* bThread ;
 } ;
 
 
@@ -376,6 +433,7 @@ class pbro01a : public pApplication
 		BHLT_STATUS bhltStatus ;
 
 		boost::condition cond_hlt ;
+		boost::mutex mtx_hlt ;
 
 		void Browse() ;
 		void initialise() ;
@@ -383,6 +441,8 @@ class pbro01a : public pApplication
 		void fill_dynamic_area() ;
 		void fill_hilight_shadow() ;
 		void fill_zshadow() ;
+		void fill_shadow_window( int ) ;
+		string hilight_line( int ) ;
 		void set_label( a_parms& ) ;
 		bool check_label( const string&, a_parms& ) ;
 		void load_language_colours() ;
@@ -425,16 +485,18 @@ class pbro01a : public pApplication
 		void   hilite_cursor() ;
 
 		int  topLine  ;
-		uint maxLines ;
 		int  startCol ;
 
-		uint maxCol  ;
-
 		map<string, lang_colours> langColours ;
 		map<string, string> langSpecials ;
 
-		vector<string> data     ;
-		vector<b_shadow> shadow ;
+		b_data data ;
+
+		vector<hilight> hlcheck ;
+		vector<string> wshadow  ;
+		int  wfirst ;
+		int  wlast  ;
+		uint hlgen  ;
 
 		b_find find_parms ;
 		hilight hlight    ;
@@ -26,8 +26,8 @@
 /*                                                                          */
 /* If the procedure is a REXX in ALTLIB, the SELECT service is used so      */
 /* will be able to use lspf services, and runs in the foreground, otherwise */
-/* popen is used and the procedure will not have access to lspf services.   */
-/* popen runs in the background.                                            */
+/* the command is run with posix_spawn and will not have access to lspf     */
+/* services.  It runs in the background.                                    */
 /*                                                                          */
 /* Output goes to the files specified in COMM1 and COMM2.                   */
 /*                                                                          */
@@ -275,8 +275,9 @@ void pcmd0a::run_command( string cmd,
 			  const string& fname2 )
 {
 	//
-	// Run command in the background and detach from the terminal (unless pipes are used)
-	// in case it hangs or messes with ncurses.
+	// Run command in the background and detach from the terminal in case it hangs or
+	// messes with ncurses.  Output is written as it arrives.  The command is stopped if the
+	// application is interrupted.
 	//
 	// If command is a REXX, run using the SELECT service.
 	//
@@ -284,11 +285,10 @@ void pcmd0a::run_command( string cmd,
 	// Errors go to fname2.
 	//
 
-	string file ;
+	std::ofstream of1 ;
+	std::ofstream of2 ;
 
-	char buffer[ 2560 ] ;
-
-	std::ofstream of ;
+	subProcess proc ;
 
 	if ( cmd.front() == '%' )
 	{
@@ -296,30 +296,29 @@ void pcmd0a::run_command( string cmd,
 		return ;
 	}
 
-	if ( cmd.find( '|' ) == string::npos ) { cmd += " </dev/null 2> "+ fname2 ; }
-	else                                   { cmd += " 2> "+ fname2            ; }
-
-	FILE* pipe{ popen( cmd.c_str(), "r" ) } ;
-
-	if ( !pipe )
+	if ( !proc.start( cmd ) )
 	{
-		llog( "E", "POPEN failed.  Command string size="<< cmd.size() <<endl ) ;
+		llog( "E", "Command " << cmd << " could not be started.  " << strerror( proc.error() ) << endl ) ;
 		return ;
 	}
 
-	of.open( fname1 ) ;
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
-	{
-		file = buffer ;
-		if ( file != "" && file.back() == 0x0a )
+	of1.open( fname1 ) ;
+	of2.open( fname2 ) ;
+
+	interrupted = false ;
+	proc.run( [ &of1, &of2 ]( const string& line, bool e )
 		{
-			file.pop_back() ;
-		}
-		of << file << endl ;
-	}
+			( ( e ) ? of2 : of1 ) << line << endl ;
+			return true ;
+		}, 0, [ this ]()
+		{
+			return interrupted ;
+		} ) ;
+
+	ZRC = proc.status() ;
 
-	ZRC = WEXITSTATUS( pclose( pipe ) ) ;
-	of.close() ;
+	of1.close() ;
+	of2.close() ;
 }
 
 
@@ -329,10 +328,9 @@ bool pcmd0a::command_exists( const string& cmd )
 	// Check if a command exists.
 	//
 
-	string wcmd = "which '"+ cmd +"' &> /dev/null " ;
+	vector<string> v ;
 
-	FILE* pipe{ popen( wcmd.c_str(), "r" ) } ;
-	ZRC = WEXITSTATUS( pclose( pipe ) ) ;
+	ZRC = lspf::run_command( "which '"+ cmd +"'", v ) ;
 
 	return ( ZRC != 1 ) ;
 }
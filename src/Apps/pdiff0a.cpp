@@ -23,18 +23,22 @@
 /**********************************************************************************/
 /*                                                                                */
 /* Compare files or directories.                                                  */
-/* Calls diff to do the real work.                                                */
+/* Files are compared with the lineDiff engine.  Directory trees are walked in    */
+/* parallel, with content hashes cached between runs in ZUPROF/PDIFFHSH.          */
 /*                                                                                */
 /**********************************************************************************/
 
 
 #include <iostream>
 #include <vector>
+#include <tuple>
 #include <boost/filesystem.hpp>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/xattr.h>
+#include <dirent.h>
+#include <fnmatch.h>
 #include <utime.h>
 #include <pwd.h>
 #include <grp.h>
@@ -53,9 +57,6 @@ pdiff0a::pdiff0a()
 {
 	STANDARD_HEADER( "Compare files and directories", "1.0.0" )
 
-	patch_file = "diff -u %s %s 2>/dev/null" ;
-	patch_dir  = "diff -Naur %s %s %s 2>/dev/null" ;
-
 	const string vlist1 = "ENTRYA ENTRYB SHOWI SHOWA SHOWB RECUR1" ;
 	const string vlist2 = "CMPINS CMPIGD CMPIGB CMPITS CMPIGT EXCLPATT IGNREGEX PROCOPTS" ;
 	const string vlist3 = "SEL ENTRY INA INB MOD ISD MDATEA SIZEA MDATEB SIZEB" ;
@@ -84,8 +85,6 @@ void pdiff0a::application()
 
 	const string vlist = "ZCMD" ;
 
-	char buf[ 2048 ] ;
-
 	initialise() ;
 
 	vdefine( vlist, &zcmd ) ;
@@ -143,12 +142,9 @@ void pdiff0a::application()
 				}
 				else if ( sel == "P" )
 				{
-					snprintf( buf,
-						  sizeof( buf ),
-						  patch_file,
-						  entrya.c_str(),
-						  entryb.c_str() ) ;
-					create_patch( buf, entry ) ;
+					create_patch( entrya,
+						      entryb,
+						      entry ) ;
 				}
 				sel = "" ;
 			}
@@ -176,13 +172,16 @@ void pdiff0a::initialise()
 void pdiff0a::compare_dirs( const string& dir1,
 			    const string& dir2 )
 {
-	int rc ;
 	int sRC ;
 
 	int csrrow = 0 ;
 	int crpx   = 0 ;
 	int ppos   = 0 ;
 
+	size_t maxl    = 40 ;
+	size_t entries = 0  ;
+
+	bool ok ;
 	bool cur2sel = false ;
 
 	const string vlist1 = "ZCMD" ;
@@ -193,13 +192,9 @@ void pdiff0a::compare_dirs( const string& dir1,
 	string temp ;
 	string cursor ;
 	string msgloc ;
-	string excl ;
-	string opts ;
 
 	string autosel = "YES" ;
 
-	char buf[ 2048 ] ;
-
 	if ( dir1 == dir2 )
 	{
 		setmsg( "DIFF011J" ) ;
@@ -208,43 +203,70 @@ void pdiff0a::compare_dirs( const string& dir1,
 
 	vdefine( vlist1, &zcmd ) ;
 
-	opts  = "-q -s" ;
-	opts += ( exclpatt == "" ) ? "" : " -x '"+ exclpatt +"'" ;
-	opts += ( ignregex == "" ) ? "" : " -I '"+ ignregex +"'" ;
+	//
+	// Entries are added to the table as the compare finds them and the table sorted at the end.
+	//
+
+	table = "DFF" + d2ds( taskid(), 5 ) ;
+
+	create_table() ;
 
-	string cmd = create_diff_cmd( dir1, dir2, opts ) ;
+	hash_cache hcache ;
 
-	vector<string> results ;
-	set<entry_info> outl ;
+	string hfile = full_name( get_shared_var( "ZUPROF" ), "PDIFFHSH" ) ;
 
-	execute_cmd( rc, cmd, results ) ;
-	if ( rc == 0 )
+	hcache.load( hfile ) ;
+
+	dir_compare dcomp( dir1, dir2, hcache ) ;
+
+	dcomp.dopts.icase  = ( cmpins == "/" ) ;
+	dcomp.dopts.ispace = ( cmpigd == "/" ) ;
+	dcomp.dopts.iblank = ( cmpigb == "/" ) ;
+	dcomp.dopts.itrail = ( cmpits == "/" ) ;
+	dcomp.dopts.itabs  = ( cmpigt == "/" ) ;
+	dcomp.dopts.ignre  = ignregex ;
+	dcomp.excl         = exclpatt ;
+	dcomp.recursive    = ( recur1 == "/" ) ;
+	dcomp.show_same    = ( showi  == "/" ) ;
+	dcomp.show_a       = ( showa  == "/" ) ;
+	dcomp.show_b       = ( showb  == "/" ) ;
+
+	try
 	{
-		setmsg( "DIFF011O" ) ;
-		vdelete( vlist1 ) ;
-		return ;
+		ok = dcomp.run( [ this, &maxl, &entries ]( entry_info& info )
+			{
+				add_table_entry( info, maxl ) ;
+				++entries ;
+			} ) ;
 	}
-	else if ( rc != 1 )
+	catch ( boost::regex_error& e )
+	{
+		llog( "E", "Invalid ignore regex "<< ignregex <<".  "<< e.what() <<endl) ;
+		ok = false ;
+	}
+
+	hcache.save( hfile ) ;
+
+	if ( !ok )
 	{
-		llog( "E", "Diff return code = "<< rc <<endl) ;
-		llog( "E", "Failing command: "<< cmd <<endl) ;
+		llog( "E", "Compare of directories "<< dir1 <<" and "<< dir2 <<" failed."<<endl) ;
 		setmsg( "DIFF011L" ) ;
+		tbend( table ) ;
 		vdelete( vlist1 ) ;
 		return ;
 	}
 
-	parse_diff_output( dir1, dir2, results, outl ) ;
-
-	if ( outl.size() == 0 )
+	if ( entries == 0 )
 	{
 		setmsg( "DIFF011O" ) ;
+		tbend( table ) ;
 		vdelete( vlist1 ) ;
 		return ;
 	}
 
-	table = "DFF" + d2ds( taskid(), 5 ) ;
+	tbsort( table, "(ENTRY,C,A)" ) ;
 
-	create_table( outl ) ;
+	set_tb_variables( maxl ) ;
 
 	msg     = "" ;
 	cursor  = "" ;
@@ -328,15 +350,10 @@ void pdiff0a::compare_dirs( const string& dir1,
 		autosel = "YES" ;
 		if ( zcmd == "PATCH" )
 		{
-			excl = ( exclpatt == "" ) ? "" : "-x '"+ exclpatt +"'" ;
 			zcmd = "" ;
-			snprintf( buf,
-				  sizeof( buf ),
-				  patch_dir,
-				  entrya.c_str(),
-				  entryb.c_str(),
-				  excl.c_str() ) ;
-			create_patch( buf, "*ALL*" ) ;
+			create_patch( entrya,
+				      entryb,
+				      "*ALL*" ) ;
 		}
 		else if ( zcmd != "" )
 		{
@@ -439,12 +456,9 @@ void pdiff0a::compare_dirs( const string& dir1,
 		}
 		else if ( sel == "P" )
 		{
-			snprintf( buf,
-				  sizeof( buf ),
-				  patch_file,
-				  full_name( entrya, entry ).c_str(),
-				  full_name( entryb, entry ).c_str() ) ;
-			create_patch( buf, entry ) ;
+			create_patch( full_name( entrya, entry ),
+				      full_name( entryb, entry ),
+				      entry ) ;
 		}
 		sel = "" ;
 	}
@@ -454,44 +468,56 @@ void pdiff0a::compare_dirs( const string& dir1,
 }
 
 
-void pdiff0a::create_patch( const char* cmd,
+void pdiff0a::create_patch( const string& file1,
+			    const string& file2,
 			    string entry )
 {
+	//
+	// Create a patch in unified format from file1 to file2, or for all files in the
+	// directories if entry is *ALL*.  Files that exist in only one directory are
+	// compared with an empty file, as diff -Naur.
+	//
+
 	int rc ;
 
-	string str1 ;
-	string line ;
 	string pfile ;
 	string ffile ;
 	string rafile ;
 	string differr ;
 
-	const string vlist = "ENTRY PFILE FFILE RAFILE DIFFERR STR1" ;
+	const string vlist = "ENTRY PFILE FFILE RAFILE DIFFERR" ;
 
-	boost::system::error_code ec ;
+	diffOptions dopts ;
+	diffFormat dfmt( DF_UNIFIED ) ;
+
+	vector<string> out ;
 
-	std::ifstream fin ;
 	std::ofstream fout ;
 
-	string tfile = create_tempname() ;
+	dopts.text = true ;
+
+	if ( entry == "*ALL*" )
+	{
+		rc = diff_dirs( file1, file2, dopts, dfmt, exclpatt, out ) ;
+	}
+	else
+	{
+		rc = diff_files( file1, file2, dopts, dfmt, out ) ;
+	}
 
-	execute_cmd( rc, cmd, tfile ) ;
 	if ( rc == 0 )
 	{
 		setmsg( "DIFF011N" ) ;
-		remove( tfile ) ;
 		return ;
 	}
 	else if ( rc != 1 )
 	{
-		llog( "E", "Diff return code = "<< rc <<endl) ;
-		llog( "E", "Failing command: "<< cmd <<endl) ;
+		llog( "E", "Compare of "<< file1 <<" and "<< file2 <<" failed.  "<< strerror( errno ) <<endl) ;
 		setmsg( "DIFF011M" ) ;
-		remove( tfile ) ;
 		return ;
 	}
 
-	vdefine( vlist, &entry, &pfile, &ffile, &rafile, &differr, &str1 ) ;
+	vdefine( vlist, &entry, &pfile, &ffile, &rafile, &differr ) ;
 
 	addpop( "", 2, 5 ) ;
 	while ( true )
@@ -503,51 +529,31 @@ void pdiff0a::create_patch( const char* cmd,
 			break ;
 		}
 		ffile = ( pfile.front() == '/' ) ? pfile : full_name( get_shared_var( "ZHOME" ), pfile ) ;
-		if ( rafile == "1" )
+		fout.open( ffile, ( rafile == "1" ) ? std::ios::trunc : std::ios::app ) ;
+		if ( fout.fail() )
 		{
-			copy_file( tfile, ffile, copy_options::overwrite_existing, ec ) ;
-			if ( ec.value() == boost::system::errc::success )
-			{
-				setmsg( "DIFF011Q" ) ;
-				break ;
-			}
-			else
-			{
-				differr = ec.message() ;
-				setmsg( "DIFF011R" ) ;
-				continue ;
-			}
+			fout.clear() ;
+			differr = strerror( errno ) ;
+			setmsg( "DIFF011R" ) ;
+			continue ;
 		}
-		else
+		for ( const auto& line : out )
 		{
-			fout.open( ffile, std::ios::app ) ;
-			if ( fout.fail() )
-			{
-				differr = strerror( errno ) ;
-				setmsg( "DIFF011R" ) ;
-				continue ;
-			}
-			fin.open( tfile ) ;
-			if ( fin.fail() )
-			{
-				str1    = tfile ;
-				differr = strerror( errno ) ;
-				setmsg( "DIFF011S" ) ;
-				continue ;
-			}
-			while ( getline( fin, line ) )
-			{
-				fout << line << endl ;
-			}
-			fin.close() ;
-			fout.close() ;
-			setmsg( "DIFF011Q" ) ;
+			fout << line << "\n" ;
+		}
+		fout.close() ;
+		if ( fout.fail() )
+		{
+			fout.clear() ;
+			differr = strerror( errno ) ;
+			setmsg( "DIFF011R" ) ;
+			continue ;
 		}
+		setmsg( "DIFF011Q" ) ;
 		break ;
 	}
 
 	rempop() ;
-	remove( tfile ) ;
 	vdelete( vlist ) ;
 }
 
@@ -557,31 +563,55 @@ void pdiff0a::compare_files( const string& file1,
 			     const string& entry,
 			     bool view_mode )
 {
+	//
+	// Compare two files and show the differences in BROWSE (with colour) or VIEW.
+	//
+
 	int rc ;
 
-	string cmd = create_diff_cmd( file1, file2, ( view_mode ) ? procopts : procopts + " --color=always -t" ) ;
+	diffOptions dopts ;
+	diffFormat dfmt ;
+
+	vector<string> out ;
+
+	std::ofstream fout ;
 
 	string lit = ( entry == "" ) ? file1 + " " + file2 :
 				       "a/" + entry + " b/" + entry ;
 
-	string tfile = create_tempname() ;
+	if ( !diff_options( dopts, dfmt ) )
+	{
+		return ;
+	}
+
+	if ( !view_mode )
+	{
+		dfmt.colour = true ;
+		dfmt.expand = true ;
+	}
 
-	execute_cmd( rc, cmd, tfile ) ;
+	rc = diff_files( file1, file2, dopts, dfmt, out ) ;
 	if ( rc == 0 )
 	{
 		setmsg( "DIFF011N" ) ;
-		remove( tfile ) ;
 		return ;
 	}
 	else if ( rc != 1 )
 	{
-		llog( "E", "Diff return code = "<< rc <<endl) ;
-		llog( "E", "Failing command: "<< cmd <<endl) ;
+		llog( "E", "Compare of "<< file1 <<" and "<< file2 <<" failed.  "<< strerror( errno ) <<endl) ;
 		setmsg( "DIFF011M" ) ;
-		remove( tfile ) ;
 		return ;
 	}
 
+	string tfile = create_tempname() ;
+
+	fout.open( tfile ) ;
+	for ( const auto& line : out )
+	{
+		fout << line << "\n" ;
+	}
+	fout.close() ;
+
 	if ( view_mode )
 	{
 		set_shared_var( "ZEDALT", "COMPARE: " + lit ) ;
@@ -605,6 +635,46 @@ void pdiff0a::compare_files( const string& file1,
 }
 
 
+bool pdiff0a::diff_options( diffOptions& dopts,
+			    diffFormat& dfmt )
+{
+	//
+	// Set compare options from the panel selections and the extra processing options field.
+	// The output format selected on the panel overrides any given in the processing options.
+	//
+
+	string msg ;
+
+	if ( !diff_parse_options( procopts, dopts, dfmt, msg ) )
+	{
+		zstr1 = msg ;
+		llog( "E", msg <<endl ) ;
+		setmsg( "DIFF011V" ) ;
+		return false ;
+	}
+
+	if ( cmpins == "/" ) { dopts.icase  = true ; }
+	if ( cmpigd == "/" ) { dopts.ispace = true ; }
+	if ( cmpigb == "/" ) { dopts.iblank = true ; }
+	if ( cmpits == "/" ) { dopts.itrail = true ; }
+	if ( cmpigt == "/" ) { dopts.itabs  = true ; }
+
+	if      ( dffutt == "--normal" ) { dfmt.type = DF_NORMAL  ; }
+	else if ( dffutt == "-c" )       { dfmt.type = DF_CONTEXT ; }
+	else if ( dffutt == "-u" )       { dfmt.type = DF_UNIFIED ; }
+	else if ( dffutt == "-e" )       { dfmt.type = DF_ED      ; }
+	else if ( dffutt == "-n" )       { dfmt.type = DF_RCS     ; }
+	else if ( dffutt == "-y" )       { dfmt.type = DF_SIDE    ; }
+
+	if ( dfcntx != "" && ( dfmt.type == DF_CONTEXT || dfmt.type == DF_UNIFIED ) )
+	{
+		dfmt.context = ds2d( dfcntx ) ;
+	}
+
+	return true ;
+}
+
+
 void pdiff0a::edit_file( const string& file1 )
 {
 	string emsg ;
@@ -734,253 +804,52 @@ void pdiff0a::merge_files( const string& file1,
 }
 
 
-string pdiff0a::create_diff_cmd( const string& e1,
-				 const string& e2,
-				 const string& opts )
+void pdiff0a::create_table()
 {
-	string dparms ;
-	string utt ;
-
-	if ( cmpins  == "/" ) { dparms += " -i " ; }
-	if ( cmpigd  == "/" ) { dparms += " -b " ; }
-	if ( cmpigb  == "/" ) { dparms += " -B " ; }
-	if ( cmpits  == "/" ) { dparms += " -Z " ; }
-	if ( cmpigt  == "/" ) { dparms += " -E " ; }
-	if ( recur1  == "/" ) { dparms += " -r " ; }
-
-	utt = ( dfcntx != "" && ( dffutt == "-c" || dffutt == "-u" ) ) ? upper( dffutt ) + " " + dfcntx : dffutt ;
-
-	return "diff " + dparms + " " + opts + " " + utt + " " + e1 + " " + e2 + " 2>/dev/null" ;
-
-}
-
-
-void pdiff0a::execute_cmd( int& rc,
-			   const string& cmd,
-			   vector<string>& results )
-{
-	string line ;
-
-	char buffer[ 8192 ] ;
-
-	results.clear() ;
-
-	FILE* pipe { popen( cmd.c_str(), "r" ) } ;
-
-	if ( !pipe )
-	{
-		rc = 3 ;
-		setmsg( "DIFF011I" ) ;
-		llog( "E", "POPEN failed.  Command string size="<< cmd.size() <<endl ) ;
-		return ;
-	}
-
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
-	{
-		line = buffer ;
-		if ( line != "" && line.back() == 0x0a )
-		{
-			line.pop_back() ;
-		}
-		results.push_back( line ) ;
-	}
-
-	rc = WEXITSTATUS( pclose( pipe ) ) ;
-}
-
-
-void pdiff0a::execute_cmd( int& rc,
-			   const string& cmd,
-			   const string& file )
-{
-	string line ;
-
-	char buffer[ 8192 ] ;
-
-	std::ofstream of ;
-
-	FILE* pipe { popen( cmd.c_str(), "r" ) } ;
-
-	if ( !pipe )
-	{
-		rc = 3 ;
-		setmsg( "DIFF011I" ) ;
-		llog( "E", "POPEN failed.  Command string size="<< cmd.size() <<endl ) ;
-		return ;
-	}
-
-	of.open( file ) ;
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
-	{
-		line = buffer ;
-		if ( line != "" && line.back() == 0x0a )
-		{
-			line.pop_back() ;
-		}
-		of << line << endl ;
-	}
-
-	rc = WEXITSTATUS( pclose( pipe ) ) ;
-	of.close() ;
-}
-
-
-void pdiff0a::create_table( set<entry_info>& outl )
-{
-	size_t maxl = 40 ;
-
 	tbcreate( table,
 		  "",
 		  "(SEL,ENTRY,INA,INB,MOD,ISD,MDATEA,SIZEA,MDATEB,SIZEB,MDATEAO,MDATEBO)",
 		  NOWRITE,
 		  REPLACE ) ;
-
-	for ( auto it = outl.begin() ; it != outl.end() ; ++it )
-	{
-		sel     = "" ;
-		entry   = it->file ;
-		inA     = ( it->inA ) ? "Y" : "N" ;
-		inB     = ( it->inB ) ? "Y" : "N" ;
-		mod     = (!it->inA || !it->inB || it->isd ) ? "" :
-			  ( it->mod ) ? "Y" : "N" ;
-		isd     = ( it->isd ) ? "Y" : "N" ;
-		mdatea  = it->ma ;
-		sizea   = it->sa ;
-		mdateb  = it->mb ;
-		sizeb   = it->sb ;
-		mdateao = it->oa ;
-		mdatebo = it->ob ;
-		maxl    = max( maxl, min( entry.size(), size_t( zscreenw-22 ) ) ) ;
-		tbadd( table ) ;
-	}
-
-	tbsort( table, "(ENTRY,C,A)" ) ;
-
-	set_tb_variables( maxl ) ;
 }
 
 
-void pdiff0a::parse_diff_output( const string& dir1,
-				 const string& dir2,
-				 vector<string>& results,
-				 set<entry_info>& outl )
+void pdiff0a::add_table_entry( entry_info& info,
+			       size_t& maxl )
 {
-	int ws ;
-
-	size_t p1 ;
-
-	string w1 ;
-	string wl ;
-	string f1 ;
-	string d1 ;
-	string d2 ;
-
-	struct stat lstat_a ;
-	struct stat lstat_b ;
-
-	set<entry_info> in ;
-
-	entry_info info ;
+	//
+	// Add an entry found by the directory compare to the table.  maxl is the longest entry name.
+	//
 
-	for ( uint i = 0 ; i < results.size() ; ++i )
+	if ( !info.isd && info.inA )
 	{
-		info.clear() ;
-		string& line = results[ i ] ;
-		w1 = word( line, 1 ) ;
-		if ( w1 == "Only" )
-		{
-			ws = words( line ) ;
-			f1 = word( line, ws ) ;
-			d1 = subword( line, 3, ws-3 ) ;
-			d1.pop_back() ;
-			if ( d1 == dir1 )
-			{
-				info.file = f1 ;
-				info.dira = d1 ;
-				info.inA  = true  ;
-				in.insert( info ) ;
-			}
-			else if ( d1 == dir2 )
-			{
-				info.file = f1 ;
-				info.dirb = d1 ;
-				info.inB  = true  ;
-				in.insert( info ) ;
-			}
-			else if ( d1.compare( 0, dir1.size(), dir1 ) == 0 )
-			{
-				info.file = d1.substr( dir1.size() ) + "/" + f1 ;
-				info.dira = d1 ;
-				info.inA  = true  ;
-				in.insert( info ) ;
-			}
-			else if ( d1.compare( 0, dir2.size(), dir2 ) == 0 )
-			{
-				info.file = d1.substr( dir2.size() ) + "/" + f1 ;
-				info.dirb = d1 ;
-				info.inB  = true  ;
-				in.insert( info ) ;
-			}
-		}
-		else if ( w1 == "Files" )
-		{
-			d1 = subword( line, 2 ) ;
-			p1 = d1.find( " and " ) ;
-			d1 = d1.substr( 0, p1 ) ;
-			if ( !is_regular_file( d1 ) ) { continue ; }
-			f1 = d1.substr( dir1.size() ) ;
-			info.dira = d1.substr( 0, d1.find_last_of( '/' ) ) ;
-
-			p1 = line.find( " and " ) ;
-			d2 = line.substr( p1+5 ) ;
-			ws = words( d2 ) ;
-			wl = word( d2, ws ) ;
-			d2 = ( wl == "differ" ) ? subword( d2, 1, ws-1 ) : subword( d2, 1, ws-2 ) ;
-			if ( !is_regular_file( d2 ) ) { continue ; }
-			info.file = f1 ;
-			info.dirb = d2.substr( 0, d2.find_last_of( '/' ) ) ;
-			info.inA  = true ;
-			info.inB  = true ;
-			info.mod  = ( wl == "differ" ) ? true : false ;
-			in.insert( info ) ;
-		}
-		else if ( w1 == "Common" )
-		{
-			p1 = line.find_last_of( '/' ) ;
-			f1 = line.substr( p1+1 ) ;
-			info.file = f1 ;
-			info.inA  = true ;
-			info.inB  = true ;
-			info.isd  = true ;
-			in.insert( info ) ;
-		}
+		info.ma = moddate( info.sta ) ;
+		info.oa = moddats( info.sta ) ;
+		info.sa = filesiz( info.sta ) ;
 	}
 
-	for ( auto it = in.begin() ; it != in.end() ; ++it )
+	if ( !info.isd && info.inB )
 	{
-		if ( ( it->inA && it->inB && it->mod ) ||
-		     ( showi == "/" && it->inA && it->inB && !it->mod ) ||
-		     ( showa == "/" && !it->inB ) ||
-		     ( showb == "/" && !it->inA ) )
-		{
-			info = *it ;
-			if ( !it->isd && it->inA )
-			{
-				lstat_a = get_lstat( full_name( it->dira, file_name( it->file ) ) ) ;
-				info.ma = moddate( lstat_a ) ;
-				info.oa = moddats( lstat_a ) ;
-				info.sa = filesiz( lstat_a ) ;
-			}
-			if ( !it->isd && it->inB )
-			{
-				lstat_b = get_lstat( full_name( it->dirb, file_name( it->file ) ) ) ;
-				info.mb = moddate( lstat_b ) ;
-				info.ob = moddats( lstat_b ) ;
-				info.sb = filesiz( lstat_b ) ;
-			}
-			outl.insert( info ) ;
-		}
+		info.mb = moddate( info.stb ) ;
+		info.ob = moddats( info.stb ) ;
+		info.sb = filesiz( info.stb ) ;
 	}
+
+	sel     = "" ;
+	entry   = info.file ;
+	inA     = ( info.inA ) ? "Y" : "N" ;
+	inB     = ( info.inB ) ? "Y" : "N" ;
+	mod     = (!info.inA || !info.inB || info.isd ) ? "" :
+		  ( info.mod ) ? "Y" : "N" ;
+	isd     = ( info.isd ) ? "Y" : "N" ;
+	mdatea  = info.ma ;
+	sizea   = info.sa ;
+	mdateb  = info.mb ;
+	sizeb   = info.sb ;
+	mdateao = info.oa ;
+	mdatebo = info.ob ;
+	maxl    = max( maxl, min( entry.size(), size_t( zscreenw-22 ) ) ) ;
+	tbadd( table ) ;
 }
 
 
@@ -1216,3 +1085,433 @@ string pdiff0a::create_tempname()
 
 	return temp.native() ;
 }
+
+
+/**************************************************************************************************************/
+/**********************************            HASH CACHE                 *************************************/
+/**************************************************************************************************************/
+
+void hash_cache::load( const string& file )
+{
+	//
+	// Load the cache saved by a previous compare.  A missing or unrecognised file is ignored.
+	//
+
+	uint64_t k1 ;
+	uint64_t k2 ;
+	uint64_t k3 ;
+	uint64_t k4 ;
+	uint64_t k5 ;
+	uint64_t h  ;
+
+	string line ;
+
+	std::ifstream fin( file ) ;
+
+	if ( !fin.is_open() || !getline( fin, line ) || line != "PDIFFHSH 1" )
+	{
+		return ;
+	}
+
+	fin >> std::hex ;
+	while ( fin >> k1 >> k2 >> k3 >> k4 >> k5 >> h )
+	{
+		hashes[ hkey( k1, k2, k3, k4, k5 ) ] = hval( h ) ;
+	}
+}
+
+
+void hash_cache::save( const string& file )
+{
+	//
+	// Save the cache if new hashes have been added.  Once the cache gets large, only keep
+	// entries used by this compare.
+	//
+	// The cache is written to a uniquely named file in the same directory which then replaces it,
+	// so sessions saving at the same time cannot write into each other's file.
+	//
+
+	int fd ;
+
+	size_t p ;
+
+	string tfile ;
+
+	vector<char> tname ;
+
+	const bool all = ( hashes.size() <= 250000 ) ;
+
+	std::ofstream fout ;
+
+	if ( !changed ) { return ; }
+
+	p     = file.find_last_of( '/' ) + 1 ;
+	tfile = file.substr( 0, p ) + ".lspf.XXXXXX" ;
+	tname.assign( tfile.begin(), tfile.end() ) ;
+	tname.push_back( 0x00 ) ;
+
+	fd = mkostemp( tname.data(), O_CLOEXEC ) ;
+	if ( fd == -1 ) { return ; }
+	close( fd ) ;
+
+	tfile = tname.data() ;
+
+	fout.open( tfile ) ;
+	if ( !fout.is_open() )
+	{
+		unlink( tfile.c_str() ) ;
+		return ;
+	}
+
+	fout << "PDIFFHSH 1\n" << std::hex ;
+	for ( const auto& h : hashes )
+	{
+		if ( all || h.second.used )
+		{
+			fout << std::get<0>( h.first ) << " "
+			     << std::get<1>( h.first ) << " "
+			     << std::get<2>( h.first ) << " "
+			     << std::get<3>( h.first ) << " "
+			     << std::get<4>( h.first ) << " "
+			     << h.second.hash << "\n" ;
+		}
+	}
+	fout.close() ;
+
+	if ( fout.fail() || rename( tfile.c_str(), file.c_str() ) != 0 )
+	{
+		unlink( tfile.c_str() ) ;
+		return ;
+	}
+
+	changed = false ;
+}
+
+
+bool hash_cache::find( const struct stat& st,
+		       uint64_t& h )
+{
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	auto it = hashes.find( make_key( st ) ) ;
+	if ( it == hashes.end() ) { return false ; }
+
+	it->second.used = true ;
+	h = it->second.hash ;
+
+	return true ;
+}
+
+
+void hash_cache::insert( const struct stat& st,
+			 uint64_t h )
+{
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	hashes[ make_key( st ) ] = hval( h, true ) ;
+	changed = true ;
+}
+
+
+hash_cache::hkey hash_cache::make_key( const struct stat& st )
+{
+	//
+	// Include the change time so a file rewritten and given back its old modification time
+	// is not matched.
+	//
+
+	return hkey( st.st_dev,
+		     st.st_ino,
+		     st.st_size,
+		     uint64_t( st.st_mtim.tv_sec ) * 1000000000 + st.st_mtim.tv_nsec,
+		     uint64_t( st.st_ctim.tv_sec ) * 1000000000 + st.st_ctim.tv_nsec ) ;
+}
+
+
+/**************************************************************************************************************/
+/**********************************           DIRECTORY COMPARE           *************************************/
+/**************************************************************************************************************/
+
+dir_compare::dir_compare( const string& a,
+			  const string& b,
+			  hash_cache& hc ) : cache( hc ), pool( max( workPool::default_size(), 4U ) )
+{
+	dira      = ( a.back() == '/' ) ? a : a + "/" ;
+	dirb      = ( b.back() == '/' ) ? b : b + "/" ;
+	recursive = false ;
+	show_same = false ;
+	show_a    = false ;
+	show_b    = false ;
+	lineopts  = false ;
+	failed    = false ;
+}
+
+
+bool dir_compare::run( const std::function<void(entry_info&)>& f )
+{
+	//
+	// Compare the directory trees, calling f for each entry to be listed.
+	// Return false if either top level directory cannot be read.
+	//
+	// Check the pool is idle before taking the results so nothing found by
+	// the last task can be missed.
+	//
+
+	bool done = false ;
+
+	vector<entry_info> batch ;
+
+	lineopts = ( dopts.icase  ||
+		     dopts.ispace ||
+		     dopts.iallsp ||
+		     dopts.iblank ||
+		     dopts.itabs  ||
+		     dopts.itrail ||
+		     dopts.ignre != "" ) ;
+
+	if ( dopts.ignre != "" )
+	{
+		boost::regex r( dopts.ignre ) ;
+	}
+
+	pool.submit( [ this ]()
+		{
+			scan_dir( "" ) ;
+		} ) ;
+
+	while ( !done )
+	{
+		done = pool.idle() ;
+		{
+			boost::unique_lock<boost::mutex> lock( mtx ) ;
+			if ( !done && results.empty() )
+			{
+				cond.timed_wait( lock, boost::posix_time::milliseconds( 50 ) ) ;
+			}
+			batch.swap( results ) ;
+		}
+		for ( auto& info : batch )
+		{
+			f( info ) ;
+		}
+		batch.clear() ;
+	}
+
+	pool.wait() ;
+
+	return !failed ;
+}
+
+
+void dir_compare::scan_dir( const string& rel )
+{
+	//
+	// Merge the entries of directory rel in both trees.  Subdirectories and file pairs
+	// are queued as further tasks.  Pairs of a different type or not regular files are ignored.
+	//
+
+	bool first ;
+
+	string sub ;
+
+	entry_info info ;
+
+	map<string, struct stat> ea ;
+	map<string, struct stat> eb ;
+
+	bool oka = read_dir( dira + rel, ea ) ;
+	bool okb = read_dir( dirb + rel, eb ) ;
+
+	if ( rel == "" && ( !oka || !okb ) )
+	{
+		failed = true ;
+		return ;
+	}
+
+	auto ia = ea.begin() ;
+	auto ib = eb.begin() ;
+
+	while ( ia != ea.end() || ib != eb.end() )
+	{
+		info.clear() ;
+		if ( ib == eb.end() || ( ia != ea.end() && ia->first < ib->first ) )
+		{
+			if ( show_a )
+			{
+				info.file = rel + ia->first ;
+				info.inA  = true ;
+				info.sta  = ia->second ;
+				found( info ) ;
+			}
+			++ia ;
+			continue ;
+		}
+		if ( ia == ea.end() || ib->first < ia->first )
+		{
+			if ( show_b )
+			{
+				info.file = rel + ib->first ;
+				info.inB  = true ;
+				info.stb  = ib->second ;
+				found( info ) ;
+			}
+			++ib ;
+			continue ;
+		}
+		info.file = rel + ia->first ;
+		info.inA  = true ;
+		info.inB  = true ;
+		info.sta  = ia->second ;
+		info.stb  = ib->second ;
+		if ( S_ISDIR( info.sta.st_mode ) && S_ISDIR( info.stb.st_mode ) )
+		{
+			if ( recursive )
+			{
+				{
+					boost::lock_guard<boost::mutex> lock( mtx ) ;
+					first = visited.insert( make_pair( info.sta.st_dev, info.sta.st_ino ) ).second ;
+				}
+				if ( first )
+				{
+					sub = info.file + "/" ;
+					pool.submit( [ this, sub ]()
+						{
+							scan_dir( sub ) ;
+						} ) ;
+				}
+			}
+			else if ( show_same )
+			{
+				info.isd = true ;
+				found( info ) ;
+			}
+		}
+		else if ( S_ISREG( info.sta.st_mode ) && S_ISREG( info.stb.st_mode ) )
+		{
+			pool.submit( [ this, info ]()
+				{
+					compare_files( info ) ;
+				} ) ;
+		}
+		++ia ;
+		++ib ;
+	}
+}
+
+
+bool dir_compare::read_dir( const string& dir,
+			    map<string, struct stat>& ents )
+{
+	//
+	// Read the entries of a directory, skipping those matching the exclude pattern.
+	// Symbolic links are followed.  Broken links are returned as links.
+	//
+
+	int dfd ;
+
+	DIR* dp ;
+
+	struct dirent* de ;
+	struct stat st ;
+
+	dp = opendir( dir.c_str() ) ;
+	if ( !dp ) { return false ; }
+
+	dfd = dirfd( dp ) ;
+
+	while ( ( de = readdir( dp ) ) )
+	{
+		if ( strcmp( de->d_name, "." ) == 0 || strcmp( de->d_name, ".." ) == 0 ) { continue ; }
+		if ( excl != "" && fnmatch( excl.c_str(), de->d_name, 0 ) == 0 ) { continue ; }
+		if ( fstatat( dfd, de->d_name, &st, 0 ) != 0 &&
+		     fstatat( dfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW ) != 0 )
+		{
+			continue ;
+		}
+		ents[ de->d_name ] = st ;
+	}
+
+	closedir( dp ) ;
+
+	return true ;
+}
+
+
+void dir_compare::compare_files( entry_info info )
+{
+	//
+	// Decide if a pair of regular files differ.  Size and modification time are checked
+	// first, then the content hashes, and only if options change the line compare are the
+	// files read and compared line by line.
+	//
+
+	uint64_t ha ;
+	uint64_t hb ;
+
+	bool same ;
+
+	vector<string> out ;
+
+	const struct stat& sa = info.sta ;
+	const struct stat& sb = info.stb ;
+
+	const string fa = dira + info.file ;
+	const string fb = dirb + info.file ;
+
+	if ( sa.st_size == sb.st_size &&
+	     sa.st_mtim.tv_sec  == sb.st_mtim.tv_sec &&
+	     sa.st_mtim.tv_nsec == sb.st_mtim.tv_nsec )
+	{
+		same = true ;
+	}
+	else if ( sa.st_size != sb.st_size && !lineopts )
+	{
+		same = false ;
+	}
+	else if ( sa.st_size == sb.st_size &&
+		  file_hash( fa, sa, ha ) &&
+		  file_hash( fb, sb, hb ) &&
+		  ha == hb )
+	{
+		same = true ;
+	}
+	else if ( lineopts )
+	{
+		same = ( diff_files( fa, fb, dopts, diffFormat(), out ) == 0 ) ;
+	}
+	else
+	{
+		same = false ;
+	}
+
+	info.mod = !same ;
+	if ( info.mod || show_same )
+	{
+		found( info ) ;
+	}
+}
+
+
+bool dir_compare::file_hash( const string& file,
+			     const struct stat& st,
+			     uint64_t& h )
+{
+	if ( cache.find( st, h ) ) { return true ; }
+
+	if ( !diff_hash_file( file, h ) ) { return false ; }
+
+	cache.insert( st, h ) ;
+
+	return true ;
+}
+
+
+void dir_compare::found( entry_info& info )
+{
+	{
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		results.push_back( info ) ;
+	}
+
+	cond.notify_one() ;
+}
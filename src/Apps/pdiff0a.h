@@ -34,6 +34,8 @@ class entry_info
 			mb  = "" ;
 			sa  = "" ;
 			sb  = "" ;
+			sta.st_mtime = 0 ;
+			stb.st_mtime = 0 ;
 		}
 
 		void clear()
@@ -51,6 +53,8 @@ class entry_info
 			sb   = "" ;
 			oa   = "" ;
 			ob   = "" ;
+			sta.st_mtime = 0 ;
+			stb.st_mtime = 0 ;
 		}
 
 		string file ;
@@ -67,6 +71,9 @@ class entry_info
 		string oa  ;
 		string ob  ;
 
+		struct stat sta ;
+		struct stat stb ;
+
 		bool operator == ( const entry_info& rhs ) const
 		{
 			return ( file == rhs.file ) ;
@@ -90,6 +97,117 @@ class entry_info
 } ;
 
 
+class hash_cache
+{
+	//
+	// Content hashes of files keyed on device, inode, size, modification and change times,
+	// so unchanged files do not need to be read again on the next compare.
+	//
+
+	public:
+		hash_cache()
+		{
+			changed = false ;
+		}
+
+		void load( const string& ) ;
+		void save( const string& ) ;
+
+		bool find( const struct stat&,
+			   uint64_t& ) ;
+
+		void insert( const struct stat&,
+			     uint64_t ) ;
+
+	private:
+		typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t> hkey ;
+
+		class hval
+		{
+			public:
+				hval( uint64_t h = 0,
+				      bool u = false )
+				{
+					hash = h ;
+					used = u ;
+				}
+
+				uint64_t hash ;
+				bool     used ;
+		} ;
+
+		hkey make_key( const struct stat& ) ;
+
+		map<hkey, hval> hashes ;
+
+		boost::mutex mtx ;
+
+		bool changed ;
+} ;
+
+
+class dir_compare
+{
+	//
+	// Compare two directory trees using a pool of threads.  Each directory is read by a separate
+	// task and file pairs that need their contents checking are queued as further tasks.
+	//
+	// Files are the same if size and modification time match, different if the sizes differ,
+	// otherwise the content hashes are compared.  If any options that change the line compare are
+	// set, files with different hashes are compared using lineDiff.
+	//
+	// Entries are passed to the callback on the calling thread as they are found.
+	//
+
+	public:
+		dir_compare( const string&,
+			     const string&,
+			     hash_cache& ) ;
+
+		bool run( const std::function<void(entry_info&)>& ) ;
+
+		diffOptions dopts ;
+
+		string excl ;
+
+		bool recursive ;
+		bool show_same ;
+		bool show_a ;
+		bool show_b ;
+
+	private:
+		void scan_dir( const string& ) ;
+
+		bool read_dir( const string&,
+			       map<string, struct stat>& ) ;
+
+		void compare_files( entry_info ) ;
+
+		bool file_hash( const string&,
+				const struct stat&,
+				uint64_t& ) ;
+
+		void found( entry_info& ) ;
+
+		string dira ;
+		string dirb ;
+
+		bool lineopts ;
+		bool failed ;
+
+		hash_cache& cache ;
+
+		workPool pool ;
+
+		boost::mutex mtx ;
+		boost::condition cond ;
+
+		vector<entry_info> results ;
+
+		set<pair<dev_t, ino_t>> visited ;
+} ;
+
+
 class pdiff0a : public pApplication
 {
 	public:
@@ -100,7 +218,8 @@ class pdiff0a : public pApplication
 	private:
 		void initialise() ;
 
-		void create_patch( const char*,
+		void create_patch( const string&,
+				   const string&,
 				   string ) ;
 
 		void compare_files( const string&,
@@ -119,24 +238,13 @@ class pdiff0a : public pApplication
 
 		void edit_file( const string& ) ;
 
-		string create_diff_cmd( const string&,
-					const string&,
-					const string& ) ;
-
-		void execute_cmd( int&,
-				  const string&,
-				  vector<string>& ) ;
+		bool diff_options( diffOptions&,
+				   diffFormat& ) ;
 
-		void execute_cmd( int&,
-				  const string&,
-				  const string& ) ;
-
-		void create_table( set<entry_info>& ) ;
+		void create_table() ;
 
-		void parse_diff_output( const string&,
-					const string&,
-					vector<string>&,
-					set<entry_info>& ) ;
+		void add_table_entry( entry_info&,
+				      size_t& ) ;
 
 		struct stat get_lstat( const string& ) ;
 		string moddate( const struct stat& ) ;
@@ -190,9 +298,6 @@ class pdiff0a : public pApplication
 		string isfile1  ;
 		string isdir1   ;
 
-		const char* patch_dir ;
-		const char* patch_file ;
-
 		string table    ;
 		string sel      ;
 		string entry    ;
@@ -58,6 +58,10 @@
 #include <vector>
 #include <queue>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include "../lspfall.h"
 #include "ehilight.cpp"
 #include "pedit01.h"
@@ -134,6 +138,10 @@ pedit01::pedit01()
 	edrec_done    = false ;
 	spfedit       = "SPFEDIT" ;
 	recvStatus    = RECV_STOPPED ;
+	findGen       = 0     ;
+	layoutGen     = 0     ;
+	findGenOn     = false ;
+	findPrefilter = false ;
 
 	langSpecials[ "ALL"     ] = "" ;
 	langSpecials[ "ASM"     ] = "+-*/=<>&|:,#" ;
@@ -1186,11 +1194,14 @@ void pedit01::readFile()
 	// 2)  If there is already an edit profile for this combination, the
 	//     file must contain at least 2 records, all be the same length and have no tabs.
 	//
+	// The whole file is read before the first screen is shown and lines always hold a copy of their
+	// data, for VIEW as well as EDIT.  Commands walk the data container without a lock so it cannot
+	// grow while the panel is in use, and automatic LRECL needs every record before it is decided.
+	//
 
 	TRACE_FUNCTION() ;
 
 	int i ;
-	int j ;
 	int p ;
 
 	int ver1 = 0 ;
@@ -1204,8 +1215,8 @@ void pedit01::readFile()
 	string t ;
 	string lnum ;
 	string infile ;
+	string rfile ;
 
-	size_t pos ;
 	size_t maxrecl = 0 ;
 
 	bool found ;
@@ -1233,12 +1244,33 @@ void pedit01::readFile()
 
 	RC = 0 ;
 
+	BOOST_SCOPE_EXIT( &rfile )
+	{
+		if ( rfile != "" )
+		{
+			unlink( rfile.c_str() ) ;
+		}
+	}
+	BOOST_SCOPE_EXIT_END
+
 	loadEditProfile( zedprof ) ;
 
 	if ( editRecovery )
 	{
 		infile      = zedbfile ;
 		fileChanged = true ;
+		if ( isRecoveryJournal( zedbfile ) )
+		{
+			rfile = unique_path( zedbfile + "-%%%%%.replay" ).native() ;
+			if ( !replayRecoveryJournal( zedbfile, rfile ) )
+			{
+				ZRESULT = "PSYS011E" ;
+				XRC     = 20 ;
+				XRSN    = 4 ;
+				return ;
+			}
+			infile = rfile ;
+		}
 	}
 	else
 	{
@@ -1303,22 +1335,9 @@ void pedit01::readFile()
 		return ;
 	}
 
-	std::ifstream fin ;
-	try
-	{
-		fin.open( infile.c_str() ) ;
-	}
-	catch ( const filesystem_error& ex )
-	{
-		set_dialogue_var( "ZVAL1", ex.what() ) ;
-		pcmd.set_msg( "PSYS012C", 12 ) ;
-		ZRESULT = "PSYS012C" ;
-		XRC     = 20 ;
-		XRSN    = 4 ;
-		return ;
-	}
+	fileReader fin ;
 
-	if ( !fin.is_open() )
+	if ( !fin.open( infile ) )
 	{
 		ZRESULT = "PSYS011E" ;
 		XRC     = 20 ;
@@ -1334,7 +1353,7 @@ void pedit01::readFile()
 	if ( zedproft == "Y" && edprof == "" )
 	{
 		i = 0 ;
-		while ( getline( fin, inLine ) && ( ++i < 100 ) )
+		while ( fin.getline( inLine ) && ( ++i < 100 ) )
 		{
 			if ( inLine.size() > MAXLEN )
 			{
@@ -1353,15 +1372,14 @@ void pedit01::readFile()
 			zedprof = t ;
 		}
 		loadEditProfile( zedprof ) ;
-		fin.close() ;
-		fin.open( infile.c_str() ) ;
+		fin.rewind() ;
 	}
 
 	data.push_back( new iline( taskid(), LN_TOD ), centre( tod, zareaw, '*' ) ) ;
 
 	topLine = data.top() ;
 
-	while ( getline( fin, inLine ) )
+	while ( fin.getline( inLine ) )
 	{
 		empty = false ;
 		if ( inLine.size() > MAXLEN )
@@ -1371,16 +1389,15 @@ void pedit01::readFile()
 			XRSN    = 4 ;
 			return ;
 		}
-		pos = inLine.find( '\t' ) ;
-		while ( pos != string::npos )
+		if ( inLine.find( '\t' ) != string::npos )
 		{
 			tabsOnRead = true ;
 			checklrcl  = false ;
 			lrecl      = 0 ;
-			if ( optNoConvTabs ) { break ; }
-			j   = profXTabz - ( pos % profXTabz ) ;
-			inLine.replace( pos, 1,  j, ' ' )  ;
-			pos = inLine.find( '\t', pos + 1 ) ;
+			if ( !optNoConvTabs )
+			{
+				convertiTabs( inLine ) ;
+			}
 		}
 		if ( caret && ( inLine.size() == 0 || inLine.back() != 0x0D ) )
 		{
@@ -1660,17 +1677,15 @@ bool pedit01::saveFile()
 
 	TRACE_FUNCTION() ;
 
-	uint i ;
+	size_t i ;
 
 	string* pt ;
 
 	string t1 ;
-	string f = zfile ;
-	string spaces = string( profXTabz, ' ' ) ;
 
-	std::ofstream fout( f.c_str() ) ;
+	fileWriter fout ;
 
-	if ( !fout.is_open() )
+	if ( !fout.open( zfile ) )
 	{
 		pcmd.set_msg( "PEDT011Q", 12 ) ;
 		return false ;
@@ -1688,36 +1703,30 @@ bool pedit01::saveFile()
 		if ( !optPreserve && reclen == 0 ) { ln.set_idata_trim() ; }
 		if ( profXTabs )
 		{
-			t1 = "" ;
-			for ( i = 0 ; i < pt->size() ; ++i )
-			{
-				if ( ( i % profXTabz == 0 )         &&
-				     pt->size() > ( i+profXTabz-1 ) &&
-				     pt->compare( i, profXTabz, spaces ) == 0 )
-				{
-					t1.push_back( '\t' )  ;
-					i = i + profXTabz - 1 ;
-				}
-				else if ( pt->at( i ) != ' ' ) { break ; }
-				else                           { t1.push_back( ' ' ) ; }
-
-			}
-			if ( i < pt->size() )
+			//
+			// Replace each complete tab-stop of leading spaces with a tab character.
+			//
+			i = pt->find_first_not_of( ' ' ) ;
+			if ( i == string::npos ) { i = pt->size() ; }
+			if ( i < profXTabz && reclen == 0 )
 			{
-				t1 += pt->substr( i ) ;
+				fout.write( *pt ) ;
+				continue ;
 			}
+			t1.assign( i / profXTabz, '\t' ) ;
+			t1.append( i % profXTabz, ' ' ) ;
+			t1.append( *pt, i, string::npos ) ;
 			if ( reclen > 0 ) { t1.resize( reclen, ' ' ) ; }
-			fout << t1 <<endl ;
+			fout.write( t1 ) ;
 		}
 		else
 		{
 			if ( reclen > 0 ) { pt->resize( reclen, ' ' ) ; }
-			fout << *pt <<endl ;
+			fout.write( *pt ) ;
 		}
 	}
 
-	fout.close() ;
-	if ( fout.fail() )
+	if ( !fout.commit() )
 	{
 		pcmd.set_msg( "PEDT011Q", 12 ) ;
 		return false ;
@@ -1924,7 +1933,6 @@ void pedit01::fill_dynamic_area()
 {
 	//
 	// Fill the dynamic area, ZAREA, from the data container.
-	//
 
 	TRACE_FUNCTION() ;
 
@@ -2045,7 +2053,7 @@ void pedit01::fill_dynamic_area()
 				it      = getFirstEX( it ) ;
 				topLine = itr2ptr( it ) ;
 			}
-			it += ( getDataBlockSize( it ) - 1 ) ;
+			it = getLastEX( it ) ;
 			fl = -1 ;
 			continue ;
 		}
@@ -4545,6 +4553,7 @@ void pedit01::actionPrimCommand3()
 			tCol = startCol ;
 			set_cursor = false ;
 			fcx_parms.set_change_counts( 0, 0 ) ;
+			findPrefilter = fcx_parms.f_chngall ;
 			while ( true )
 			{
 				actionFind() ;
@@ -4593,6 +4602,8 @@ void pedit01::actionPrimCommand3()
 			}
 			topLine  = tTop ;
 			startCol = tCol ;
+			findPrefilter = false ;
+			findGenOn     = false ;
 			if ( fcx_parms.f_ch_errs == 0 )
 			{
 				( fcx_parms.f_ch_occs > 0 ) ? setChangedMsg() : setNotFoundMsg() ;
@@ -8582,11 +8593,21 @@ void pedit01::sort_data( const string& cmd )
 	//
 	// Sort data between columns and ranges.
 	//
+	// The sort fields of each line are extracted once into a fixed-width key (see sort_run).
+	// Lines are collected into runs of up to SORT_MEMORY bytes.  If everything fits in one run it is
+	// sorted in storage and written back, otherwise each run is sorted and written to a work file
+	// and the runs are merged back into the data.
+	//
+	// Work files are created with mode 0600 and unlinked as soon as they are created, so they are
+	// removed however the sort ends.  Every run is read back and checked before the first line is
+	// replaced, so a work file error does not leave the data partly sorted.
+	//
+	// All changes are made at the current undo level so the sort is backed out in one step.
+	//
 	// Macro return codes:
 	//  0  Normal completion.
 	//  4  Lines were already in sort order.
 	//  8  No records to sort.
-	// 16  Not enough storage to sort.
 	// 20  Severe error.
 	//
 
@@ -8596,13 +8617,18 @@ void pedit01::sort_data( const string& cmd )
 	int ws ;
 	int rc ;
 
+	uint r ;
+
 	size_t s1 ;
 	size_t s2 ;
 	size_t ln ;
+	size_t n ;
+	size_t nr ;
 
 	bool sorted ;
 	bool only_x ;
 	bool only_nx ;
+	bool err ;
 
 	string wall ;
 
@@ -8610,9 +8636,6 @@ void pedit01::sort_data( const string& cmd )
 	string w2 ;
 	string w3 ;
 	string t1 ;
-	string t2 ;
-
-	vector<line_data> tdata ;
 
 	vector<bool>srt_asc ;
 
@@ -8620,10 +8643,66 @@ void pedit01::sort_data( const string& cmd )
 	vector<size_t>col_b ;
 	vector<size_t>col_l ;
 
+	string wfile ;
+
+	FILE* fp ;
+
+	vector<FILE*> files ;
+
+	vector<string> wfiles ;
+
+	vector<sort_reader*> readers ;
+
 	Data::Iterator it  = nullptr ;
 	Data::Iterator its = nullptr ;
 	Data::Iterator ite = nullptr ;
 
+	auto in_sort = [ &only_x, &only_nx ]( iline& a ) -> bool
+	{
+		return ( a.is_valid_file() &&
+		       ( ( !only_x && !only_nx ) ||
+			 (  only_x && a.is_excluded() ) ||
+			 (  only_nx && a.is_not_excluded() ) ) ) ;
+	} ;
+
+	auto work_file = [ this, &files, &wfiles, &wfile ]() -> FILE*
+	{
+		int fd ;
+		FILE* f ;
+		wfile = ( temp_directory_path() / ( zuser + "-" + zscreen + "-sort-XXXXXX" ) ).native() ;
+		vector<char> tname( wfile.begin(), wfile.end() ) ;
+		tname.push_back( 0x00 ) ;
+		fd = mkostemp( tname.data(), O_CLOEXEC ) ;
+		if ( fd == -1 )
+		{
+			return nullptr ;
+		}
+		wfile = tname.data() ;
+		unlink( tname.data() ) ;
+		f = fdopen( fd, "w+b" ) ;
+		if ( !f )
+		{
+			close( fd ) ;
+			return nullptr ;
+		}
+		files.push_back( f ) ;
+		wfiles.push_back( wfile ) ;
+		return f ;
+	} ;
+
+	BOOST_SCOPE_EXIT( &files, &readers )
+	{
+		for ( auto rd : readers )
+		{
+			delete rd ;
+		}
+		for ( auto fp : files )
+		{
+			fclose( fp ) ;
+		}
+	}
+	BOOST_SCOPE_EXIT_END
+
 	wall = strip( upper( subword( cmd, 2 ) ) ) ;
 
 	rc = extract_lptr( wall, its, ite, false ) ;
@@ -8754,9 +8833,18 @@ void pedit01::sort_data( const string& cmd )
 		col_b.push_back( ( s2 == string::npos ) ? string::npos : s2 - 1 ) ;
 	}
 
-	copyFileData( tdata, only_x, only_nx, its, ++ite, ln ) ;
+	++ite ;
+
+	for ( ln = 0, n = 0, it = its ; it != ite ; ++it )
+	{
+		if ( in_sort( *it ) )
+		{
+			ln = max( ln, size_t( it->get_idata_len() ) ) ;
+			++n ;
+		}
+	}
 
-	if ( tdata.empty() )
+	if ( n == 0 )
 	{
 		pcmd.set_msg( "PEDT018I", 8 ) ;
 		return ;
@@ -8766,6 +8854,7 @@ void pedit01::sort_data( const string& cmd )
 
 	for ( i = 0 ; i < col_a.size() ; ++i )
 	{
+		col_b[ i ] = max( col_a[ i ], col_b[ i ] ) ;
 		col_l.push_back( col_b[ i ] - col_a[ i ] + 1 ) ;
 	}
 
@@ -8790,72 +8879,100 @@ void pedit01::sort_data( const string& cmd )
 		}
 	}
 
-	stable_sort( tdata.begin(), tdata.end(),
-		[ &srt_asc, &col_a, &col_l ]( const line_data& a, const line_data& b )
+	sort_run run( col_a, col_l, srt_asc ) ;
+
+	for ( it = its ; it != ite ; ++it )
+	{
+		if ( !in_sort( *it ) ) { continue ; }
+		run.add( *it ) ;
+		if ( run.bytes > SORT_MEMORY )
 		{
-			for ( size_t i = 0 ; i < srt_asc.size() ; ++i )
+			run.sort() ;
+			fp = work_file() ;
+			if ( !fp || !run.write( fp ) )
 			{
-				size_t ca = col_a[ i ] ;
-				size_t cl = col_l[ i ] ;
-				if ( a.line_str.substr( ca, cl ) != b.line_str.substr( ca, cl ) )
-				{
-					if ( srt_asc[ i ] )
-					{
-						return a.line_str.substr( ca, cl ) < b.line_str.substr( ca, cl ) ;
-					}
-					else
-					{
-						return a.line_str.substr( ca, cl ) > b.line_str.substr( ca, cl ) ;
-					}
-				}
+				pcmd.set_msg( "PEDT018R", wfile, 20 ) ;
+				return ;
 			}
-			return false ;
-		} ) ;
+			run.clear() ;
+		}
+	}
 
 	sorted = true ;
 	it     = its ;
 
-	for ( i = 0 ; i < tdata.size() ; ++it )
+	if ( files.empty() )
 	{
-		if ( it->is_valid_file() &&
-		    ( (  !only_x  && !only_nx ) ||
-		      ( ( only_x  && it->is_excluded() ) ) ||
-		      ( ( only_nx && it->is_not_excluded() ) ) ) )
+		run.sort() ;
+		for ( n = 0 ; n < run.size() ; ++it )
 		{
-			line_data& ld = tdata.at( i ) ;
-			t1 = ld.get_string() ;
-			t2 = it->get_idata() ;
-			if ( RightBnd > 0 )
+			if ( in_sort( *it ) )
 			{
-				t1 = substr( t2, 1, LeftBnd-1 ) +
-				     substr( t1, LeftBnd, ( RightBnd - LeftBnd + 1 ) ) +
-				     substr( t2, RightBnd+1 ) ;
-				trim_right( t1 ) ;
+				sort_put_line( it, run.at( n++ ), sorted ) ;
+			}
+		}
+	}
+	else
+	{
+		if ( run.size() > 0 )
+		{
+			run.sort() ;
+			fp = work_file() ;
+			if ( !fp || !run.write( fp ) )
+			{
+				pcmd.set_msg( "PEDT018R", wfile, 20 ) ;
+				return ;
 			}
-			else if ( LeftBnd > 1 )
+		}
+		run.clear() ;
+		auto comp = []( const sort_reader* a, const sort_reader* b )
+		{
+			return *a > *b ;
+		} ;
+		priority_queue<sort_reader*, vector<sort_reader*>, decltype( comp )> pq( comp ) ;
+		for ( nr = 0, r = 0 ; r < files.size() ; ++r )
+		{
+			readers.push_back( new sort_reader( run.key_len(), r ) ) ;
+			if ( !readers.back()->open( files[ r ] ) || !readers.back()->check( nr ) )
 			{
-				t1 = substr( t2, 1, LeftBnd-1 ) +
-				     substr( t1, LeftBnd ) ;
+				pcmd.set_msg( "PEDT018R", wfiles[ r ], 20 ) ;
+				return ;
 			}
-			if ( it->put_idata( t1, level, ID_CHNGO ) )
+		}
+		if ( nr != n )
+		{
+			pcmd.set_msg( "PEDT018R", wfiles.front(), 20 ) ;
+			return ;
+		}
+		for ( auto rd : readers )
+		{
+			if ( rd->next() )
 			{
-				fileChanged = true  ;
-				sorted      = false ;
+				pq.push( rd ) ;
 			}
-			if ( ld.line_type != LS_NONE )
+		}
+		err = false ;
+		while ( !pq.empty() )
+		{
+			sort_reader* rd = pq.top() ;
+			pq.pop() ;
+			while ( !in_sort( *it ) ) { ++it ; }
+			sort_put_line( it, rd->rec, sorted ) ;
+			++it ;
+			if ( rd->next() )
 			{
-				it->set_condition( ld.line_type, level ) ;
+				pq.push( rd ) ;
 			}
-			if ( ld.line_label != "" )
+			else if ( rd->error() )
 			{
-				for ( auto itl = data.begin() ; itl != data.end() ; ++itl )
-				{
-					if ( itl->clearLabel( ld.line_label, level ) ) { break ; }
-				}
-				it->setLabel( ld.line_label, level ) ;
+				err = true ;
 			}
-			( ld.line_excl ) ? it->set_excluded( level ) : it->set_unexcluded( level ) ;
-			++i ;
+		}
+		if ( err )
+		{
+			pcmd.set_msg( "PEDT018R", wfiles.front(), 20 ) ;
+			rebuildZAREA = true ;
+			return ;
 		}
 	}
 
@@ -8870,6 +8987,50 @@ void pedit01::sort_data( const string& cmd )
 }
 
 
+void pedit01::sort_put_line( Data::Iterator it,
+			     line_data& ld,
+			     bool& sorted )
+{
+	//
+	// Replace the data within the bounds of line it with sorted line ld, and move the label,
+	// line condition and exclude status of ld to it.  sorted is set false if the data changes.
+	//
+
+	TRACE_FUNCTION() ;
+
+	string t1 = ld.get_string() ;
+	const string& t2 = it->get_idata() ;
+
+	if ( RightBnd > 0 )
+	{
+		t1 = substr( t2, 1, LeftBnd-1 ) +
+		     substr( t1, LeftBnd, ( RightBnd - LeftBnd + 1 ) ) +
+		     substr( t2, RightBnd+1 ) ;
+		trim_right( t1 ) ;
+	}
+	else if ( LeftBnd > 1 )
+	{
+		t1 = substr( t2, 1, LeftBnd-1 ) +
+		     substr( t1, LeftBnd ) ;
+	}
+	if ( it->put_idata( t1, level, ID_CHNGO ) )
+	{
+		fileChanged = true  ;
+		sorted      = false ;
+	}
+	it->set_condition( ld.line_type, level ) ;
+	if ( ld.line_label != "" )
+	{
+		for ( auto itl = data.begin() ; itl != data.end() ; ++itl )
+		{
+			if ( itl->clearLabel( ld.line_label, level ) ) { break ; }
+		}
+		it->setLabel( ld.line_label, level ) ;
+	}
+	( ld.line_excl ) ? it->set_excluded( level ) : it->set_unexcluded( level ) ;
+}
+
+
 int pedit01::get_datawidth()
 {
 	//
@@ -10737,18 +10898,7 @@ bool pedit01::setFindChangeExcl( char ftyp,
 
 	if ( t.f_regreq )
 	{
-		try
-		{
-			if ( t.f_asis )
-			{
-				t.f_regexp.assign( t.f_string ) ;
-			}
-			else
-			{
-				t.f_regexp.assign( t.f_string, boost::regex_constants::icase ) ;
-			}
-		}
-		catch ( boost::regex_error& e )
+		if ( !getFindRegex( t ) )
 		{
 			pcmd.set_msg( "PEDT014X", 20 ) ;
 			return false ;
@@ -10768,97 +10918,306 @@ bool pedit01::setFindChangeExcl( char ftyp,
 }
 
 
-void pedit01::hiliteFindPhrase()
+bool pedit01::getFindRegex( edit_find& t )
 {
 	//
-	// Hilite FIND phrase between normal limits (bounds, range) between first and last line on screen.
-	// c1,c2 are the column limits of the find, set by bnds, col, line length and initial cursor position.
+	// Set the compiled regex for the find string from the regex cache, compiling and adding it
+	// if not already there.  Return false if the regex is invalid.
+	//
+	// Also set the literal string every match must contain (if any) so lines that do not contain
+	// it can be skipped without running the regex.
 	//
 
 	TRACE_FUNCTION() ;
 
-	int i ;
-	int rc ;
-	int ln ;
-	int s1 ;
-
-	int c1 ;
-	int c2 ;
-
-	int scol ;
-	int ecol ;
-
-	iline* dl ;
-
-	size_t p1 ;
-
-	string ss ;
-
-	bool found ;
-
-	Data::Iterator it  = nullptr ;
-	Data::Iterator its = nullptr ;
-	Data::Iterator ite = nullptr ;
-
-	string::const_iterator itss ;
-	string::const_iterator itse ;
+	const size_t cache_max = 32 ;
 
-	boost::smatch results ;
+	string key = ( t.f_asis ) ? "A" + t.f_string : "I" + t.f_string ;
 
-	if ( fcx_parms.f_slab != "" )
+	auto it = regexCache.find( key ) ;
+	if ( it == regexCache.end() )
 	{
-		its = getLabelIterator( fcx_parms.f_slab, rc ) ;
-		if ( rc != 0 )
+		if ( regexCache.size() >= cache_max )
 		{
-			return ;
+			regexCache.clear() ;
 		}
-		ite = getLabelIterator( fcx_parms.f_elab, rc ) ;
-		if ( rc != 0 )
+		try
 		{
-			return ;
+			if ( t.f_asis )
+			{
+				it = regexCache.insert( make_pair( key, boost::regex( t.f_string ) ) ).first ;
+			}
+			else
+			{
+				it = regexCache.insert( make_pair( key, boost::regex( t.f_string, boost::regex_constants::icase ) ) ).first ;
+			}
+		}
+		catch ( boost::regex_error& e )
+		{
+			return false ;
 		}
 	}
-	else
+
+	t.f_regexp = it->second ;
+	t.f_rlit   = getRegexLiteral( t.f_string ) ;
+
+	if ( !t.f_asis )
 	{
-		its = topLine ;
-		ite = data.bottom() ;
+		iupper( t.f_rlit ) ;
 	}
 
-	scol = LeftBnd - 1 ;
-	ecol = ( RightBnd > 1 ) ? RightBnd - 1 : 0 ;
+	return true ;
+}
 
-	for ( i = 0 ; i < zlvline ; ++i )
-	{
-		ipos& tpos = s2data[ i ] ;
-		dl = tpos.ipos_addr ;
-		if ( !dl                  ||
-		     tpos.ipos_hex_line() ||
-		     data.lt( dl, its )   ||
-		     dl->not_valid_file() ||
-		     dl->is_excluded() )  { continue ; }
 
-		if ( data.gt( dl, ite ) ) { break ; }
+string pedit01::getRegexLiteral( const string& s )
+{
+	//
+	// Return a literal string that must be contained in every match of regex s, or a null string
+	// if one cannot be determined.
+	//
+	// Leading zero-width assertions, single-character atoms and groups are skipped, then the run of
+	// literal characters that follows is taken.  A character followed by a quantifier that allows
+	// zero occurences is not part of the literal.  \< \> \` and \' are word and buffer anchors, not
+	// escaped characters, so they are skipped in the same way as ^ and $ and end the literal.
+	//
+	// Return null for alternation at the outer level, inline modifiers, quoting and escapes that
+	// consume more than one character in the pattern as they cannot be handled this simply.
+	//
 
-		c1 = 0 ;
-		c2 = dl->get_idata_len() - 1 ;
+	TRACE_FUNCTION() ;
 
-		if ( scol > c1 )             { c1 = scol ; }
-		if ( ecol > 0 && ecol < c2 ) { c2 = ecol ; }
+	const string pass1 = "bB<>`'AzZGwWdDsShHvV" ;
+	const string zwid  = "<>`'" ;
+	const string quant = "*?{" ;
+	const string metas = ".[]()*+?{}|^$\\" ;
 
-		if ( c1 > c2 ) { continue ; }
+	int depth = 0 ;
 
-		if ( fcx_parms.f_regreq )
+	size_t i ;
+	size_t j ;
+
+	bool inclass = false ;
+
+	string lit ;
+
+	for ( i = 0 ; i < s.size() ; ++i )
+	{
+		if ( s[ i ] == '\\' )
 		{
-			itss = dl->get_idata_begin() + c1 ;
-			itse = itss + ( c2 - c1 + 1 ) ;
-			while ( regex_search( itss, itse, results, fcx_parms.f_regexp ) )
-			{
-				if ( fcx_parms.f_ocol && itss != results[ 0 ].first )
-				{
-					break ;
-				}
-				for ( p1 = c1 ; itss != results[ 0 ].first ; ++itss ) { ++p1 ; }
-				c1    = p1 + 1 ;
+			if ( ++i == s.size() ) { return "" ; }
+			if ( !inclass && ( s[ i ] == 'Q' || isdigit( s[ i ] ) ) ) { return "" ; }
+		}
+		else if ( inclass )
+		{
+			if ( s[ i ] == ']' ) { inclass = false ; }
+		}
+		else if ( s[ i ] == '[' )
+		{
+			inclass = true ;
+			if ( i + 1 < s.size() && s[ i + 1 ] == '^' ) { ++i ; }
+			if ( i + 1 < s.size() && s[ i + 1 ] == ']' ) { ++i ; }
+		}
+		else if ( s[ i ] == '(' )
+		{
+			if ( i + 1 < s.size() && s[ i + 1 ] == '?' ) { return "" ; }
+			++depth ;
+		}
+		else if ( s[ i ] == ')' )
+		{
+			--depth ;
+		}
+		else if ( s[ i ] == '|' && depth == 0 )
+		{
+			return "" ;
+		}
+	}
+
+	for ( i = 0 ; i < s.size() ; )
+	{
+		if ( s[ i ] == '^' || s[ i ] == '$' || s[ i ] == '.' )
+		{
+			++i ;
+		}
+		else if ( s[ i ] == '\\' )
+		{
+			if ( i + 1 == s.size() ) { return "" ; }
+			if ( pass1.find( s[ i + 1 ] ) != string::npos )
+			{
+				i += 2 ;
+			}
+			else if ( isalnum( s[ i + 1 ] ) )
+			{
+				return "" ;
+			}
+			else
+			{
+				break ;
+			}
+		}
+		else if ( s[ i ] == '[' )
+		{
+			j = i + 1 ;
+			if ( j < s.size() && s[ j ] == '^' ) { ++j ; }
+			if ( j < s.size() && s[ j ] == ']' ) { ++j ; }
+			for ( ; j < s.size() && s[ j ] != ']' ; ++j )
+			{
+				if ( s[ j ] == '\\' ) { ++j ; }
+			}
+			if ( j >= s.size() ) { return "" ; }
+			i = j + 1 ;
+		}
+		else if ( s[ i ] == '(' )
+		{
+			for ( depth = 1, j = i + 1 ; j < s.size() && depth > 0 ; ++j )
+			{
+				if      ( s[ j ] == '\\' ) { ++j ; }
+				else if ( s[ j ] == '(' )  { ++depth ; }
+				else if ( s[ j ] == ')' )  { --depth ; }
+			}
+			if ( depth > 0 ) { return "" ; }
+			i = j ;
+		}
+		else if ( s[ i ] == '*' || s[ i ] == '+' || s[ i ] == '?' )
+		{
+			++i ;
+		}
+		else if ( s[ i ] == '{' )
+		{
+			j = s.find( '}', i ) ;
+			if ( j == string::npos ) { return "" ; }
+			i = j + 1 ;
+		}
+		else
+		{
+			break ;
+		}
+	}
+
+	while ( i < s.size() )
+	{
+		if ( s[ i ] == '\\' )
+		{
+			if ( i + 1 == s.size() || isalnum( s[ i + 1 ] ) || ( s[ i + 1 ] & 0x80 ) ||
+			     zwid.find( s[ i + 1 ] ) != string::npos ) { break ; }
+			j = i + 1 ;
+		}
+		else if ( metas.find( s[ i ] ) != string::npos || ( s[ i ] & 0x80 ) )
+		{
+			break ;
+		}
+		else
+		{
+			j = i ;
+		}
+		if ( j + 1 < s.size() && quant.find( s[ j + 1 ] ) != string::npos )
+		{
+			break ;
+		}
+		lit.push_back( s[ j ] ) ;
+		if ( j + 1 < s.size() && s[ j + 1 ] == '+' )
+		{
+			break ;
+		}
+		i = j + 1 ;
+	}
+
+	return lit ;
+}
+
+
+void pedit01::hiliteFindPhrase()
+{
+	//
+	// Hilite FIND phrase between normal limits (bounds, range) between first and last line on screen.
+	// c1,c2 are the column limits of the find, set by bnds, col, line length and initial cursor position.
+	//
+
+	TRACE_FUNCTION() ;
+
+	int i ;
+	int rc ;
+	int ln ;
+	int s1 ;
+
+	int c1 ;
+	int c2 ;
+
+	int scol ;
+	int ecol ;
+
+	iline* dl ;
+
+	size_t p1 ;
+
+	string ss ;
+
+	bool found ;
+
+	Data::Iterator it  = nullptr ;
+	Data::Iterator its = nullptr ;
+	Data::Iterator ite = nullptr ;
+
+	string::const_iterator itss ;
+	string::const_iterator itse ;
+
+	boost::smatch results ;
+
+	if ( fcx_parms.f_slab != "" )
+	{
+		its = getLabelIterator( fcx_parms.f_slab, rc ) ;
+		if ( rc != 0 )
+		{
+			return ;
+		}
+		ite = getLabelIterator( fcx_parms.f_elab, rc ) ;
+		if ( rc != 0 )
+		{
+			return ;
+		}
+	}
+	else
+	{
+		its = topLine ;
+		ite = data.bottom() ;
+	}
+
+	scol = LeftBnd - 1 ;
+	ecol = ( RightBnd > 1 ) ? RightBnd - 1 : 0 ;
+
+	for ( i = 0 ; i < zlvline ; ++i )
+	{
+		ipos& tpos = s2data[ i ] ;
+		dl = tpos.ipos_addr ;
+		if ( !dl                  ||
+		     tpos.ipos_hex_line() ||
+		     data.lt( dl, its )   ||
+		     dl->not_valid_file() ||
+		     dl->is_excluded() )  { continue ; }
+
+		if ( data.gt( dl, ite ) ) { break ; }
+
+		c1 = 0 ;
+		c2 = dl->get_idata_len() - 1 ;
+
+		if ( scol > c1 )             { c1 = scol ; }
+		if ( ecol > 0 && ecol < c2 ) { c2 = ecol ; }
+
+		if ( c1 > c2 ) { continue ; }
+
+		if ( fcx_parms.f_regreq )
+		{
+			itss = dl->get_idata_begin() + c1 ;
+			itse = itss + ( c2 - c1 + 1 ) ;
+			if ( !fcx_parms.f_rlit_in( itss, itse ) ) { continue ; }
+			while ( regex_search( itss, itse, results, fcx_parms.f_regexp ) )
+			{
+				if ( fcx_parms.f_ocol && itss != results[ 0 ].first )
+				{
+					break ;
+				}
+				for ( p1 = c1 ; itss != results[ 0 ].first ; ++itss ) { ++p1 ; }
+				c1    = p1 + 1 ;
 				itss  = results[ 0 ].first ;
 				if ( itss == itse ) { break ; }
 				++itss ;
@@ -11112,6 +11471,11 @@ void pedit01::actionFind()
 	optFindPhrase = true  ;
 	found         = false ;
 
+	if ( ( fcx_parms.f_all() || findPrefilter ) && !findGenOn )
+	{
+		actionFind_prefilter( sdl, edl, scol, ecol ) ;
+	}
+
 	idecr( sdl ) ;
 	iincr( edl ) ;
 
@@ -11139,7 +11503,8 @@ void pedit01::actionFind()
 		if ( ecol > 0 && ecol < c2 ) { c2 = ecol ; }
 
 		fcx_parms.f_searched = true ;
-		if ( ( c2 == -1 && fcx_parms.f_word() ) || ( c2 > -1 && ( c1 > c2 || offset > c2 ) ) || ( fcx_parms.f_ocol && fcx_parms.f_scol <= c1 ) )
+		if ( ( c2 == -1 && fcx_parms.f_word() ) || ( c2 > -1 && ( c1 > c2 || offset > c2 ) ) || ( fcx_parms.f_ocol && fcx_parms.f_scol <= c1 ) ||
+		     ( findGenOn && dl->il_nfgen == findGen ) )
 		{
 			dl = ( fcx_parms.f_reverse() ) ? getPrevFileLine( dl ) : getNextFileLine( dl ) ;
 			offset = 0 ;
@@ -11176,10 +11541,140 @@ void pedit01::actionFind()
 
 	fcx_parms.f_success = found ;
 
-	if ( fcx_parms.f_all() && fcx_parms.f_occurs == 0 )
+	if ( fcx_parms.f_all() )
+	{
+		findGenOn = false ;
+		if ( fcx_parms.f_occurs == 0 )
+		{
+			fcx_parms.f_set_next() ;
+		}
+	}
+}
+
+
+void pedit01::actionFind_prefilter( iline* sdl,
+				    iline* edl,
+				    int scol,
+				    int ecol )
+{
+	//
+	// For ALL-type operations (FIND/EXCLUDE ALL and CHANGE ALL), split the file lines between
+	// sdl and edl into chunks and search them on separate threads.  Lines that cannot match are
+	// flagged with the current find generation so the sequential loop in actionFind() skips them.
+	//
+	// Lines that can match are still processed by actionFind_regex/actionFind_nonregex in file order,
+	// so counts, cursor position, first-found address and undo levels are as before.
+	//
+	// A line is only flagged if it cannot match when searched from offset 0.  This covers all lines
+	// visited by an ALL search, and CHANGE ALL as only lines that matched are changed.
+	//
+
+	TRACE_FUNCTION() ;
+
+	const size_t min_chunk = 4096 ;
+
+	vector<iline*> lines ;
+
+	if ( parallel_chunks( data.size(), min_chunk ) < 2 )
+	{
+		return ;
+	}
+
+	for ( iline* dl = sdl ; dl ; dl = ( dl == edl ) ? nullptr : getNextFileLine( dl ) )
+	{
+		if ( !dl->is_valid_file() || dl->get_idata_len() == 0 )
+		{
+			continue ;
+		}
+		if ( ( fcx_parms.f_x() && dl->is_not_excluded() ) || ( fcx_parms.f_nx() && dl->is_excluded() ) )
+		{
+			continue ;
+		}
+		lines.push_back( dl ) ;
+	}
+
+	if ( parallel_chunks( lines.size(), min_chunk ) < 2 )
+	{
+		return ;
+	}
+
+	if ( ++findGen == 0 ) { ++findGen ; }
+
+	parallel_ranges( lines.size(), min_chunk,
+		[ this, &lines, scol, ecol ]( size_t b, size_t e, uint c )
+		{
+			for ( ; b < e ; ++b )
+			{
+				if ( !actionFind_candidate( lines[ b ], scol, ecol ) )
+				{
+					lines[ b ]->il_nfgen = findGen ;
+				}
+			}
+		} ) ;
+
+	findGenOn = true ;
+}
+
+
+bool pedit01::actionFind_candidate( const iline* dl,
+				    int scol,
+				    int ecol )
+{
+	//
+	// Return true if line dl may contain a match when searched forward from offset 0.
+	// Runs on a worker thread so must not modify the line or fcx_parms.
+	//
+	// The regex column range is the one used by actionFind/actionFind_regex as the result of
+	// regex_search depends on where the range starts and ends (anchors and word boundaries).
+	// For non-regex finds, containing the string anywhere is sufficient.
+	//
+
+	int c1 = 0 ;
+	int c2 = dl->get_idata_len() - 1 ;
+
+	const string& str = dl->get_idata() ;
+	const string& fnd = fcx_parms.f_string ;
+
+	string::const_iterator itss ;
+	string::const_iterator itse ;
+
+	if ( scol > c1 )             { c1 = scol ; }
+	if ( ecol > 0 && ecol < c2 ) { c2 = ecol ; }
+
+	if ( c1 > c2 || ( fcx_parms.f_ocol && fcx_parms.f_scol <= c1 ) )
+	{
+		return false ;
+	}
+
+	if ( !fcx_parms.f_regreq )
 	{
-		fcx_parms.f_set_next() ;
+		if ( fcx_parms.f_asis )
+		{
+			return ( str.find( fnd ) != string::npos ) ;
+		}
+		return ( search( str.begin(), str.end(), fnd.begin(), fnd.end(),
+			[]( char a, char b )
+			{
+				return ( toupper( a ) == b ) ;
+			} ) != str.end() ) ;
+	}
+
+	if ( fcx_parms.f_prefix() )
+	{
+		if ( ( c2 + 1 ) < dl->get_idata_len() )
+		{
+			++c2 ;
+		}
+	}
+	else if ( fcx_parms.f_suffix() && c1 > 0 )
+	{
+		--c1 ;
 	}
+
+	itss = str.begin() + c1 ;
+	itse = ( fcx_parms.f_ocol ) ? str.end() : itss + ( c2 - c1 + 1 ) ;
+
+	return ( fcx_parms.f_rlit_in( itss, itse ) && regex_search( itss, itse, fcx_parms.f_regexp ) ) ;
 }
 
 
@@ -11233,6 +11728,11 @@ bool pedit01::actionFind_regex( iline* dl,
 		itse = itss + ( c2 - c1 + 1 ) ;
 	}
 
+	if ( !fcx_parms.f_rlit_in( itss, itse ) )
+	{
+		return false ;
+	}
+
 	if ( fcx_parms.f_prev() || fcx_parms.f_last() || fcx_parms.f_all() )
 	{
 		while ( regex_search( itss, itse, results, fcx_parms.f_regexp ) )
@@ -11350,7 +11850,7 @@ int pedit01::actionFind_regex_wps( iline* dl,
 
 	TRACE_FUNCTION() ;
 
-	const string wchars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_" ;
+	static const string wchars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_" ;
 
 	if ( fcx_parms.f_word_prefix() && c1 > 0 && itss == itrf )
 	{
@@ -12244,23 +12744,55 @@ int pedit01::getFileLine( Data::Iterator it1 )
 	// First file line is 1.
 	// Return 0 if none.
 	//
+	// Results are cached until lines are added, removed or deleted.  A new request
+	// counts back to the nearest cached line.
+	//
 
 	TRACE_FUNCTION() ;
 
 	int f = 0 ;
 
-	for ( auto it2 = data.begin() ; it2 != data.end() ; ++it2 )
+	Data::Iterator it2 = it1 ;
+
+	map<iline*, int>::iterator itf ;
+
+	if ( it1 == data.end() || itr2ptr( it1 ) == nullptr )
 	{
-		if ( it2->is_valid_file() ) { ++f ; }
-		if ( it2 == it1 ) { break ; }
+		for ( it2 = data.begin() ; it2 != data.end() ; ++it2 )
+		{
+			if ( it2->is_valid_file() ) { ++f ; }
+		}
+		return f ;
 	}
 
-	return f ;
-}
-
+	checkLayoutCache() ;
 
-Data::Iterator pedit01::getDataLine( int fl )
-{
+	while ( true )
+	{
+		itf = fileLines.find( itr2ptr( it2 ) ) ;
+		if ( itf != fileLines.end() )
+		{
+			f += itf->second ;
+			break ;
+		}
+		if ( it2->is_valid_file() ) { ++f ; }
+		if ( it2 == data.begin() )  { break ; }
+		--it2 ;
+	}
+
+	if ( fileLines.size() > 4096 )
+	{
+		fileLines.clear() ;
+	}
+
+	fileLines[ itr2ptr( it1 ) ] = f ;
+
+	return f ;
+}
+
+
+Data::Iterator pedit01::getDataLine( int fl )
+{
 	//
 	// Return the iterator that corresponts to line fl in the file.
 	// If not found, return bottom-of-data line.
@@ -12823,6 +13355,11 @@ int pedit01::getExclBlockSize( Data::Iterator it )
 
 	uint exlines = 0 ;
 
+	if ( !it->il_deleted && it->is_excluded() )
+	{
+		return getExclBlock( it ).xb_exlines ;
+	}
+
 	for ( ; it != data.begin() ; --it )
 	{
 		if ( it->il_deleted || it->is_excluded() ) { continue ; }
@@ -12852,6 +13389,15 @@ int pedit01::getDataBlockSize( Data::Iterator it )
 
 	int bklines = 0 ;
 
+	if ( !it->il_deleted && it->is_excluded() )
+	{
+		const xblock& xb = getExclBlock( it ) ;
+		if ( xb.xb_first == itr2ptr( it ) )
+		{
+			return xb.xb_bklines ;
+		}
+	}
+
 	for ( ; it != data.end() ; ++it )
 	{
 		if ( it->is_not_excluded() && !it->il_deleted ) { break ; }
@@ -12872,6 +13418,11 @@ Data::Iterator pedit01::getFirstEX( Data::Iterator it )
 
 	Data::Iterator iy = it ;
 
+	if ( !it->il_deleted && it->is_excluded() )
+	{
+		return getExclBlock( it ).xb_first ;
+	}
+
 	for ( ; it != data.begin() ; --it )
 	{
 		if ( it->il_deleted )    { continue ; }
@@ -12894,6 +13445,11 @@ Data::Iterator pedit01::getLastEX( Data::Iterator it )
 
 	Data::Iterator iy = it ;
 
+	if ( !it->il_deleted && it->is_excluded() )
+	{
+		return getExclBlock( it ).xb_last ;
+	}
+
 	for ( ; it != data.end() ; ++it )
 	{
 		if ( it->is_not_excluded() && !it->il_deleted ) { break ; }
@@ -12904,6 +13460,86 @@ Data::Iterator pedit01::getLastEX( Data::Iterator it )
 }
 
 
+const xblock& pedit01::getExclBlock( Data::Iterator it )
+{
+	//
+	// Return the extent of the excluded block containing iterator it ('it' must point to
+	// a non-deleted, excluded line).
+	//
+	// Blocks are cached by the line requested and by the first line in the block until
+	// lines are added, removed, deleted or their excluded status changes, so redisplaying
+	// a screen with large excluded blocks does not walk each block again.
+	//
+
+	TRACE_FUNCTION() ;
+
+	xblock xb ;
+
+	Data::Iterator ix = it ;
+
+	map<iline*, xblock>::iterator itx ;
+
+	checkLayoutCache() ;
+
+	itx = xblocks.find( itr2ptr( it ) ) ;
+	if ( itx != xblocks.end() )
+	{
+		return itx->second ;
+	}
+
+	if ( xblocks.size() > 1024 )
+	{
+		xblocks.clear() ;
+	}
+
+	xb.xb_first = itr2ptr( it ) ;
+	for ( ; ix != data.begin() ; --ix )
+	{
+		if ( ix->il_deleted )    { continue ; }
+		if ( ix->is_excluded() ) { xb.xb_first = itr2ptr( ix ) ; }
+		else                     { break ; }
+	}
+
+	itx = xblocks.find( xb.xb_first ) ;
+	if ( itx != xblocks.end() )
+	{
+		return xblocks[ itr2ptr( it ) ] = itx->second ;
+	}
+
+	for ( ix = xb.xb_first ; ix != data.end() ; ++ix )
+	{
+		if ( ix->is_not_excluded() && !ix->il_deleted ) { break ; }
+		xb.xb_last = itr2ptr( ix ) ;
+		++xb.xb_bklines ;
+		if ( !ix->il_deleted ) { ++xb.xb_exlines ; }
+	}
+
+	xblocks[ xb.xb_first ] = xb ;
+
+	return xblocks[ itr2ptr( it ) ] = xb ;
+}
+
+
+void pedit01::checkLayoutCache()
+{
+	//
+	// Clear cached excluded blocks and file line numbers if lines have been added, removed,
+	// deleted, excluded or shown since they were stored.
+	//
+
+	TRACE_FUNCTION() ;
+
+	uint gen = iline::get_layout_gen( taskid() ) ;
+
+	if ( gen != layoutGen )
+	{
+		xblocks.clear() ;
+		fileLines.clear() ;
+		layoutGen = gen ;
+	}
+}
+
+
 iline* pedit01::getNextSpecial( iline* tTop,
 				Data::Iterator sidx,
 				Data::Iterator eidx,
@@ -13532,6 +14168,7 @@ void pedit01::copyPrefix( Data::Iterator it,
 
 	it->il_type   = s.ip_type   ;
 	it->set_excluded( s.ip_excl, level ) ;
+	iline::set_layout_changed( taskid() ) ;
 	it->il_hex    = s.ip_hex    ;
 	it->il_prof   = s.ip_prof   ;
 	it->il_profln = s.ip_profln ;
@@ -14586,47 +15223,6 @@ void pedit01::cleanup_custom()
 }
 
 
-void pedit01::copyFileData( vector<line_data>& tdata,
-			    bool only_x,
-			    bool only_nx,
-			    Data::Iterator its,
-			    Data::Iterator ite,
-			    size_t& l )
-{
-	//
-	// Copy valid file entries between its and ite to vector tdata.  Pad all records with 0x00
-	// to the longest (used in sort so all records should be the same length).
-	//
-
-	TRACE_FUNCTION() ;
-
-	l = 0 ;
-
-	line_data t ;
-
-	for ( ; its != ite ; ++its )
-	{
-		if ( its->is_valid_file() )
-		{
-			if ( ( !only_x  && !only_nx ) ||
-			     (  only_x  && its->is_excluded() ) ||
-			     (  only_nx && its->is_not_excluded() ) )
-			{
-				t.set_string( *its ) ;
-				l = max( l, t.get_string_len() ) ;
-				its->set_condition( LS_NONE, level ) ;
-				tdata.push_back( t ) ;
-			}
-		}
-	}
-
-	for ( auto it = tdata.begin() ; it != tdata.end() ; ++it )
-	{
-		it->resize( l ) ;
-	}
-}
-
-
 void pedit01::reflowData( vector<string>& tdata1,
 			  int tf_col,
 			  int ind1,
@@ -14846,8 +15442,7 @@ bool pedit01::is_line_blank( const string& s )
 void pedit01::compare_files( string s )
 {
 	//
-	// Simple compare routine using output from the diff command.
-	// Compare edit version of file with entered file name.
+	// Compare edit version of file with entered file name using the lineDiff class.
 	//
 	// Differences displayed in browse or with INFO lines.
 	//    Special labels .Onnnn signify lines added to the edit file.
@@ -14861,32 +15456,17 @@ void pedit01::compare_files( string s )
 	Data::Iterator top = nullptr ;
 	Data::Iterator it  = nullptr ;
 
-	int rc ;
-
-	uint s1 ;
-	uint s2 ;
-	uint d1 ;
-	uint d2 ;
-
 	uint add = 0 ;
 	uint del = 0 ;
 
 	size_t i ;
-	size_t pos ;
-
-	char ltp ;
 
 	bool exclude = false ;
 
 	string t1 ;
-	string t2 ;
-	string cmd ;
-	string file ;
 	string vlist ;
 	string label ;
-	string dparms ;
-	string tname1 ;
-	string tname2 ;
+	string tname ;
 	string inLine ;
 
 	string cfile ;
@@ -14901,11 +15481,15 @@ void pedit01::compare_files( string s )
 
 	string* pt ;
 
-	string spaces = string( profXTabz, ' ' ) ;
+	vector<string> changes ;
+	vector<string> adata ;
+	vector<string> bdata ;
+
+	vector<iline*> alines ;
 
-	char buffer[ 2048 ] ;
+	diffOptions dopts ;
 
-	vector<string>changes ;
+	fileReader fin ;
 
 	vlist = "CFILE ECPBRDF ECPICAS ECPIREF ECPIBLK ECPITBE ECPNXNO ECPLPRE" ;
 
@@ -14987,18 +15571,24 @@ void pedit01::compare_files( string s )
 		return ;
 	}
 
-	if ( ecpbrdf == "/" && !macroRunning ) { dparms = " -y " ; }
+	dopts.icase   = ( ecpicas == "/" ) ;
+	dopts.ispace  = ( ecpiref == "/" ) ;
+	dopts.iblank  = ( ecpiblk == "/" ) ;
+	dopts.itabs   = ( ecpitbe == "/" ) ;
+	dopts.tabsize = profXTabz ;
 
-	if ( ecpicas == "/" ) { dparms += " -i " ; }
-	if ( ecpiref == "/" ) { dparms += " -b " ; }
-	if ( ecpiblk == "/" ) { dparms += " -B " ; }
-	if ( ecpitbe == "/" ) { dparms += " -E " ; }
-
-	tname1 = createTempName() ;
-	tname2 = createTempName() ;
+	if ( !fin.open( cfile ) )
+	{
+		pcmd.set_msg( "PEDT017M", 20 ) ;
+		vdelete( vlist ) ;
+		return ;
+	}
 
-	std::ofstream fout( tname1.c_str() ) ;
-	std::ofstream of ;
+	while ( fin.getline( inLine ) )
+	{
+		bdata.push_back( inLine ) ;
+	}
+	fin.close() ;
 
 	for ( it = data.begin() ; it != data.end() ; ++it )
 	{
@@ -15006,94 +15596,66 @@ void pedit01::compare_files( string s )
 		pt = it->get_idata_ptr() ;
 		if ( profXTabs )
 		{
-			t1 = "" ;
-			for ( i = 0 ; i < pt->size() ; ++i )
-			{
-				if ( (i % profXTabz == 0)         &&
-				     pt->size() > (i+profXTabz-1) &&
-				     pt->compare( i, profXTabz, spaces ) == 0 )
-				{
-					t1.push_back( '\t' ) ;
-					i = i + 7 ;
-				}
-				else if ( pt->at( i ) != ' ' ) { break ; }
-				else                           { t1.push_back( ' ' ) ; }
-
-			}
-			if ( i < pt->size() )
-			{
-				t1 += pt->substr( i ) ;
-			}
-			fout << t1 <<endl ;
+			//
+			// Compare the data as it would be saved.
+			//
+			i = pt->find_first_not_of( ' ' ) ;
+			if ( i == string::npos ) { i = pt->size() ; }
+			t1.assign( i / profXTabz, '\t' ) ;
+			t1.append( i % profXTabz, ' ' ) ;
+			t1.append( *pt, i, string::npos ) ;
+			adata.push_back( t1 ) ;
 		}
 		else
 		{
-			fout << *pt <<endl ;
-		}
-	}
-	fout.close() ;
-
-	cmd = "diff " + dparms + tname1 + " '" + cfile + "' 2>&1" ;
-	FILE* pipe{ popen( cmd.c_str(), "r" ) } ;
-	if ( !pipe )
-	{
-		llog( "E", "POPEN failed for command "<< cmd <<endl ) ;
-		pcmd.set_msg( "PEDT017L", 20 ) ;
-		remove( tname1 ) ;
-		remove( tname2 ) ;
-		vdelete( vlist ) ;
-		return ;
-	}
-
-	of.open( tname2 ) ;
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
-	{
-		file = buffer ;
-		if ( file != "" && file.back() == 0x0a )
-		{
-			file.pop_back() ;
+			adata.push_back( *pt ) ;
 		}
-		of << file << endl ;
+		alines.push_back( itr2ptr( it ) ) ;
 	}
 
-	rc = WEXITSTATUS( pclose( pipe ) ) ;
+	lineDiff ldiff( dopts ) ;
 
-	of.close() ;
-	remove( tname1 ) ;
+	ldiff.compare( adata, bdata ) ;
 
-	if ( rc == 0 )
+	if ( !ldiff.differ() )
 	{
 		pcmd.set_msg( "PEDT017J", 4, 0 ) ;
-		remove( tname2 ) ;
-		vdelete( vlist ) ;
-		return ;
-	}
-	else if ( rc > 1 )
-	{
-		pcmd.set_msg( "PEDT017M", 20 ) ;
-		std::ifstream fin( tname2.c_str() ) ;
-		while ( getline( fin, inLine ) )
-		{
-			llog( "E", inLine << endl) ;
-		}
-		fin.close() ;
-		remove( tname2 ) ;
 		vdelete( vlist ) ;
 		return ;
 	}
 
 	if ( ecpbrdf == "/" && !macroRunning )
 	{
+		ldiff.format( changes, diffFormat( DF_SIDE ) ) ;
+		tname = createTempName() ;
+		fileWriter fout ;
+		if ( !fout.open( tname ) )
+		{
+			pcmd.set_msg( "PEDT017M", 20 ) ;
+			vdelete( vlist ) ;
+			return ;
+		}
+		for ( const auto& ln : changes )
+		{
+			fout.write( ln ) ;
+		}
+		if ( !fout.commit() )
+		{
+			pcmd.set_msg( "PEDT017M", 20 ) ;
+			remove( tname ) ;
+			vdelete( vlist ) ;
+			return ;
+		}
 		set_dialogue_var( "ZBRALT", "COMPARE: NEW - OLD" ) ;
 		control( "ERRORS", "RETURN" ) ;
-		browse( tname2 ) ;
+		browse( tname ) ;
 		if ( RC == 12 )
 		{
 			pcmd.set_msg( "PEDT017J", 4 ) ;
 		}
 		control( "ERRORS", "CANCEL" ) ;
 		verase( "ZBRALT", SHARED ) ;
-		remove( tname2 ) ;
+		remove( tname ) ;
 		vdelete( vlist ) ;
 		return ;
 	}
@@ -15114,68 +15676,45 @@ void pedit01::compare_files( string s )
 
 	label = "." + ( ( ecplpre == "" ) ? "O" : ecplpre ) + "AAAA" ;
 
-	std::ifstream fin( tname2.c_str() ) ;
-	while ( getline( fin, inLine ) )
+	//
+	// Lines only in the edit data are labelled.  Lines only in the compare file
+	// are added as INFO lines before the next edit data line.
+	//
+
+	for ( const auto& h : ldiff.hunks() )
 	{
-		if ( inLine == "\\ No newline at end of file" ) { continue ; }
-		pos = inLine.find_first_of( "acd" ) ;
-		ltp = inLine[ pos ] ;
-		t1  = inLine.substr( 0, pos ) ;
-		t2  = inLine.substr( pos + 1 ) ;
-		pos = t1.find( ',' ) ;
-		s1  = ds2d( t1.substr( 0, pos ) ) ;
-		s2  = ( pos == string::npos ) ? s1 : ds2d( t1.substr( pos + 1 ) ) ;
-		pos = t2.find( ',' ) ;
-		d1  = ds2d( t2.substr( 0, pos ) ) ;
-		d2  = ( pos == string::npos ) ? d1 : ds2d( t2.substr( pos + 1 ) ) ;
-		if ( ltp == 'a' )
+		for ( i = 0 ; i < h.a_count ; ++i )
 		{
-			changes.clear() ;
-			for ( uint i = d1 ; i <= d2 ; ++i )
-			{
-				getline( fin, inLine ) ;
-				changes.push_back( convertTabs( inLine.substr( 2 ) ) ) ;
-				++del ;
-			}
-			auto it = getDataLine( s1+1 ) - 1 ;
-			if ( top == nullptr ) { top = it ; }
-			addSpecial( LN_INFO, it, changes ) ;
+			alines[ h.a_first + i ]->setLabel( label, level ) ;
+			label = genNextLabel( label ) ;
+			++add ;
 		}
-		else if ( ltp == 'd' )
+		if ( h.a_count > 0 && top == nullptr )
 		{
-			if ( top == nullptr ) { top = getDataLine( s1 ) ; }
-			for ( uint i = s1 ; i <= s2 ; ++i )
-			{
-				getline( fin, inLine ) ;
-				getDataLine( i )->setLabel( label, level ) ;
-				label = genNextLabel( label ) ;
-				++add ;
-			}
+			top = alines[ h.a_first ] ;
 		}
-		else if ( ltp == 'c' )
+		if ( h.b_count > 0 )
 		{
-			for ( uint i = s1 ; i <= s2 ; ++i )
-			{
-				getline( fin, inLine ) ;
-				getDataLine( i )->setLabel( label, level ) ;
-				label = genNextLabel( label ) ;
-				++add ;
-			}
-			getline( fin, inLine ) ;
 			changes.clear() ;
-			for ( uint i = d1 ; i <= d2 ; ++i )
+			for ( i = 0 ; i < h.b_count ; ++i )
 			{
-				getline( fin, inLine ) ;
-				changes.push_back( convertTabs( inLine.substr( 2 ) ) ) ;
+				changes.push_back( convertTabs( bdata[ h.b_first + i ] ) ) ;
 				++del ;
 			}
-			auto it = getDataLine( s1 ) ;
+			if ( h.a_first < alines.size() )
+			{
+				it = alines[ h.a_first ] ;
+			}
+			else
+			{
+				it = data.end() ;
+				--it ;
+			}
+			--it ;
 			if ( top == nullptr ) { top = it ; }
-			addSpecial( LN_INFO, --it, changes ) ;
+			addSpecial( LN_INFO, it, changes ) ;
 		}
 	}
-	fin.close() ;
-	remove( tname2 ) ;
 
 	pcmd.set_msg( "PEDT017K", d2ds( add ), d2ds( del ), 4, 0 ) ;
 
@@ -15504,18 +16043,32 @@ string& pedit01::convertiTabs( string& s )
 
 	TRACE_FUNCTION() ;
 
-	int j ;
+	size_t pos = s.find( '\t' ) ;
 
-	size_t pos ;
+	string t ;
 
-	pos = s.find( '\t' ) ;
-	while ( pos != string::npos )
+	if ( pos == string::npos )
 	{
-		j = profXTabz - ( pos % profXTabz ) ;
-		s.replace( pos, 1,  j, ' ' )  ;
-		pos = s.find( '\t', pos + 1 ) ;
+		return s ;
+	}
+
+	t.reserve( s.size() + 8 * profXTabz ) ;
+	t.assign( s, 0, pos ) ;
+
+	for ( ; pos < s.size() ; ++pos )
+	{
+		if ( s[ pos ] == '\t' )
+		{
+			t.append( profXTabz - ( t.size() % profXTabz ), ' ' ) ;
+		}
+		else
+		{
+			t.push_back( s[ pos ] ) ;
+		}
 	}
 
+	s.swap( t ) ;
+
 	return s ;
 }
 
@@ -18736,6 +19289,217 @@ void pedit01::isredit( const string& s )
 }
 
 
+void pedit01::isredit_get_lines( const string& lptr1,
+				 const string& lptr2,
+				 vector<string>& lines )
+{
+	//
+	// Bulk form of (var) = LINE lptr.  Return the data of file lines lptr1 to lptr2 in one call,
+	// so line pointers are resolved once rather than for every line.
+	//
+	// MACRO return codes:
+	// RC =  0 Normal completion.
+	// RC = 12 Invalid line number or line range.
+	// RC = 20 Severe error.
+	//
+	// Data does not include any COBOL or STD line numbers.
+	//
+
+	TRACE_FUNCTION() ;
+
+	int n ;
+
+	Data::Iterator it1 = nullptr ;
+	Data::Iterator it2 = nullptr ;
+
+	lines.clear() ;
+
+	if ( !bulkService( "LINE " + lptr1 + " " + lptr2 ) )
+	{
+		return ;
+	}
+
+	if ( getLinePtrIterator( upper( lptr1 ), it1 ) != 1 ||
+	     getLinePtrIterator( upper( lptr2 ), it2 ) != 1 )
+	{
+		return ;
+	}
+
+	n = getFileLine( it2 ) - getFileLine( it1 ) + ( it1->is_valid_file() ? 1 : 0 ) ;
+	if ( n < 1 )
+	{
+		miBlock.seterror( "PEDM013L", 12 ) ;
+		return ;
+	}
+
+	lines.reserve( n ) ;
+	for ( ; it1 != data.end() && lines.size() < size_t( n ) ; ++it1 )
+	{
+		if ( it1->is_valid_file() )
+		{
+			lines.push_back( it1->get_idata( lnumSize1, lnumS2pos ) ) ;
+		}
+	}
+}
+
+
+void pedit01::isredit_put_lines( const string& cmd,
+				 const string& lptr,
+				 const vector<string>& lines )
+{
+	//
+	// Bulk form of LINE, LINE_AFTER and LINE_BEFORE lptr = data.
+	//   LINE        - replace file lines starting at lptr.
+	//   LINE_AFTER  - add data lines after lptr.
+	//   LINE_BEFORE - add data lines before lptr.
+	//
+	// All changes use the undo level of the running macro so they are backed out together.
+	//
+	// MACRO return codes:
+	// RC =  0 Normal completion.
+	// RC =  4 Data truncated.
+	// RC = 12 Invalid line number.
+	// RC = 20 Severe error.
+	//
+	// Data does not include any COBOL or STD line numbers.
+	//
+
+	TRACE_FUNCTION() ;
+
+	int rc ;
+
+	string t ;
+
+	Data::Iterator it = nullptr ;
+
+	iline* pos ;
+
+	if ( !bulkService( cmd + " " + lptr + " = (lines)" ) )
+	{
+		return ;
+	}
+
+	if ( !findword( cmd, "LINE LINE_AFTER LINE_BEFORE" ) )
+	{
+		miBlock.seterror( "PEDM011P", 20 ) ;
+		return ;
+	}
+
+	rc = getLinePtrIterator( upper( lptr ), it ) ;
+	if ( rc == 0 && cmd == "LINE_AFTER" )
+	{
+		it = data.begin() ;
+		miBlock.setRC( 0 ) ;
+	}
+	else if ( rc != 1 )
+	{
+		return ;
+	}
+
+	if ( cmd == "LINE" )
+	{
+		if ( ( getFileLine( it ) - ( it->is_valid_file() ? 1 : 0 ) + int( lines.size() ) ) > getFileLine( data.end() ) )
+		{
+			miBlock.seterror( "PEDM011S", 12 ) ;
+			return ;
+		}
+		for ( const auto& l : lines )
+		{
+			while ( !it->is_valid_file() ) { ++it ; }
+			t = ( profCaps ) ? upper( l ) : l ;
+			if ( reclen > 0 )
+			{
+				if ( reclen < ( t.size() + lnumSize ) )
+				{
+					miBlock.setRC( 4 ) ;
+				}
+				t.resize( ( reclen - lnumSize ), ' ' ) ;
+			}
+			else if ( t.size() > MAXLEN )
+			{
+				t.resize( MAXLEN ) ;
+				miBlock.setRC( 4 ) ;
+			}
+			if ( it->put_idata( lnumSize1, lnumS2pos, t, level ) )
+			{
+				fileChanged = true ;
+				it->resetFileStatus() ;
+			}
+			it->update_lnummod( lnumSize1, lnumS2pos, lnummod ) ;
+			++it ;
+		}
+		return ;
+	}
+
+	if ( cmd == "LINE_AFTER" )
+	{
+		it = getNextDataLine( it ) ;
+	}
+
+	//
+	// Inserting before the same line keeps the new lines in order.
+	//
+
+	pos = itr2ptr( it ) ;
+
+	for ( const auto& l : lines )
+	{
+		t = ( profCaps ) ? upper( l ) : l ;
+		if ( reclen > 0 && reclen < ( t.size() + lnumSize ) )
+		{
+			miBlock.setRC( 4 ) ;
+		}
+		if ( lnumSize1 > 0 )
+		{
+			t = string( lnumSize1, ' ' ) + t ;
+		}
+		if ( lnumSize2 > 0 )
+		{
+			t.resize( ( lnumS2pos + lnumSize2 ), ' ' ) ;
+		}
+		if ( reclen > 0 )
+		{
+			t.resize( reclen, ' ' ) ;
+		}
+		else if ( t.size() > MAXLEN )
+		{
+			t.resize( MAXLEN ) ;
+			miBlock.setRC( 4 ) ;
+		}
+		data.insert( pos, new iline( taskid(), LN_FILE, lnumSize ) )->put_idata( t, level ) ;
+		fileChanged = true ;
+	}
+}
+
+
+bool pedit01::bulkService( const string& s )
+{
+	//
+	// Setup the macro interface block for a bulk line service as isredit() does after parsing.
+	// s is the statement shown if an error occurs.
+	//
+
+	TRACE_FUNCTION() ;
+
+	if ( miBlock.eended )
+	{
+		miBlock.seterror( "PEDM013D", 12 ) ;
+		miBlock.eended = false ;
+		return false ;
+	}
+
+	miBlock.reset() ;
+	miBlock.sttment = s ;
+
+	miBlock.setRC( 0 ) ;
+	pcmd.clear() ;
+
+	clr_zedimsgs() ;
+
+	return true ;
+}
+
+
 void pedit01::clr_zedimsgs()
 {
 	TRACE_FUNCTION() ;
@@ -18861,6 +19625,12 @@ void pedit01::updateRecoveryData()
 	// environment, this only runs while the edit screen is being displayed.  This should
 	// be enough time for even very large files.
 	//
+	// The recovery file is a journal.  A full checkpoint of the data is written first, then
+	// only the lines that have changed are appended at each update (see writeRecoveryJournal).
+	// A new checkpoint is written when the appended data exceeds the size of the last
+	// checkpoint, if an update was interrupted or failed, or if settings that affect
+	// the output have changed.
+	//
 	// Subtask will be started with the RECOVERY ON command and stopped with the RECOVERY OFF command.
 	//
 	// Don't access anything updated by the display service (namely variable RC) in this procedure.
@@ -18868,27 +19638,23 @@ void pedit01::updateRecoveryData()
 
 	TRACE_FUNCTION() ;
 
-	string tfile ;
-	string dfile ;
-
-	bool aborted = false ;
-
+	int rc ;
 	int fileLevel = 0 ;
 
-	path temp = unique_path( backupLoc + zuser + "-" + zscreen + "-isredit-%%%%%.recov" ) ;
+	uint nextId = 0 ;
 
-	bfile = temp.native() ;
-	tfile = bfile + ".swp" ;
-	dfile = bfile + ".del" ;
+	size_t bytes ;
+	size_t ckptBytes  = 0 ;
+	size_t deltaBytes = 0 ;
 
-	uint i ;
+	bool full = true ;
 
-	string* pt ;
+	string settings ;
+	string t ;
 
-	string t1 ;
-	string spaces = string( profXTabz, ' ' ) ;
+	path temp = unique_path( backupLoc + zuser + "-" + zscreen + "-isredit-%%%%%.recov" ) ;
 
-	std::ofstream fout ;
+	bfile = temp.native() ;
 
 	boost::mutex mutex ;
 
@@ -18901,75 +19667,309 @@ void pedit01::updateRecoveryData()
 		lk.unlock() ;
 		if ( recvStatus == RECV_RUNNING && !recovSusp && canBackup && iline::get_Global_File_level( taskid() ) != fileLevel )
 		{
-			fout.open( tfile.c_str() ) ;
-			if ( !fout.is_open() )
+			t = d2ds( profXTabs ? profXTabz : 0 ) + "." + d2ds( optPreserve ) + "." + d2ds( reclen ) ;
+			if ( t != settings || deltaBytes > ckptBytes || !exists( bfile ) )
 			{
-				recovSusp = true ;
-				llog( "E", "File "<< tfile <<" cannot be opened.  RECOVERY suspended."<<endl ) ;
-				break ;
+				settings = t ;
+				full     = true ;
 			}
-			for ( auto& ln : data )
+			rc = writeRecoveryJournal( full, nextId, bytes ) ;
+			if ( rc == 0 )
 			{
-				if ( !canBackup )
-				{
-					aborted = true ;
-					break ;
-				}
-				if ( ln.not_valid_file() ) { continue ; }
-				pt = ln.get_idata_ptr() ;
-				if ( !optPreserve && reclen == 0 ) { ln.set_idata_trim() ; }
-				if ( profXTabs )
+				fileLevel = iline::get_Global_File_level( taskid() ) ;
+				if ( full )
 				{
-					t1 = "" ;
-					for ( i = 0 ; i < pt->size() ; ++i )
-					{
-						if ( ( i % profXTabz == 0 )         &&
-						     pt->size() > ( i+profXTabz-1 ) &&
-						     pt->compare( i, profXTabz, spaces ) == 0 )
-						{
-							t1.push_back( '\t' )  ;
-							i = i + profXTabz - 1 ;
-						}
-						else if ( pt->at( i ) != ' ' ) { break ; }
-						else                           { t1.push_back( ' ' ) ; }
-
-					}
-					if ( i < pt->size() )
-					{
-						t1 += pt->substr( i ) ;
-					}
-					fout << t1 <<endl ;
+					ckptBytes  = bytes ;
+					deltaBytes = 0 ;
+					full       = false ;
 				}
 				else
 				{
-					fout << *pt <<endl ;
+					deltaBytes += bytes ;
 				}
 			}
-			fout.close() ;
-			if ( fout.fail() )
+			else if ( rc == 4 )
 			{
-				recovSusp = true ;
-				llog( "E", "File "<< tfile <<" close error.  RECOVERY suspended."<<endl ) ;
+				full = true ;
 			}
-			if ( aborted )
+			else if ( full )
 			{
-				remove( tfile ) ;
-				aborted = false ;
+				recovSusp = true ;
+				llog( "E", "File "<< bfile <<" cannot be written.  RECOVERY suspended."<<endl ) ;
+				break ;
 			}
 			else
 			{
-				fileLevel = iline::get_Global_File_level( taskid() ) ;
-				if ( exists( bfile ) )
+				full = true ;
+			}
+		}
+	}
+
+	recvStatus = RECV_STOPPED ;
+}
+
+
+int pedit01::writeRecoveryJournal( bool full,
+				   uint& nextId,
+				   size_t& bytes )
+{
+	//
+	// Write a record to the recovery journal.
+	//
+	// Journal format (all records are terminated by a newline):
+	//   LSPF-EDREC 1           header, at the start of the file.
+	//   C                      start of a checkpoint.  Line ids restart at 1.
+	//   D                      start of a delta.
+	//   K first last           keep lines first to last from the previous state.
+	//   N len data             new line.  Assigned the next line id.
+	//   E count                end of record with count of K/N entries.
+	//
+	// A checkpoint contains only N entries and replaces the journal file.  A delta is appended
+	// and lists the full file as ranges of unchanged lines and new lines.  A line is unchanged if
+	// it has a line id and the hash of its data matches that when the id was assigned.
+	// Line ids are only valid after the record is complete so the next record must be a
+	// checkpoint if this is interrupted or fails.  A checkpoint also clears the ids of deleted
+	// lines kept for UNDO, as the id would name a different line if the line were restored.
+	//
+	// Lines are written as for SAVE, with trailing spaces removed and leading spaces compressed
+	// to tabs if XTABS is on.
+	//
+	// RC = 0  Okay.  bytes set to the size of the record.
+	// RC = 4  Interrupted as the edit screen is no longer being displayed.
+	// RC = 8  Write error.
+	//
+
+	TRACE_FUNCTION() ;
+
+	uint runf  = 0 ;
+	uint runl  = 0 ;
+	uint count = 0 ;
+
+	size_t h ;
+	size_t i ;
+
+	bool trim = ( !optPreserve && reclen == 0 ) ;
+
+	string* pt ;
+
+	string t1 ;
+	string t2 ;
+
+	std::hash<string> hasher ;
+
+	fileWriter fout ;
+
+	bytes = 0 ;
+
+	if ( full )
+	{
+		if ( !fout.open( bfile ) ) { return 8 ; }
+		fout.write( "LSPF-EDREC 1" ) ;
+		fout.write( "C" ) ;
+		nextId = 0 ;
+		bytes += 15 ;
+	}
+	else
+	{
+		if ( !fout.open_append( bfile ) ) { return 8 ; }
+		fout.write( "D" ) ;
+		bytes += 2 ;
+	}
+
+	for ( auto& ln : data )
+	{
+		if ( !canBackup )
+		{
+			fout.abort() ;
+			return 4 ;
+		}
+		if ( ln.not_valid_file() )
+		{
+			if ( full ) { ln.il_jid = 0 ; }
+			continue ;
+		}
+		pt = ln.get_idata_ptr() ;
+		h  = hasher( *pt ) ;
+		if ( !full && ln.il_jid > 0 && ln.il_jhash == h )
+		{
+			if ( runf > 0 && ln.il_jid == runl + 1 )
+			{
+				runl = ln.il_jid ;
+				continue ;
+			}
+			if ( runf > 0 )
+			{
+				t2 = "K " + d2ds( runf ) + " " + d2ds( runl ) ;
+				fout.write( t2 ) ;
+				bytes += t2.size() + 1 ;
+				++count ;
+			}
+			runf = ln.il_jid ;
+			runl = ln.il_jid ;
+			continue ;
+		}
+		if ( runf > 0 )
+		{
+			t2 = "K " + d2ds( runf ) + " " + d2ds( runl ) ;
+			fout.write( t2 ) ;
+			bytes += t2.size() + 1 ;
+			++count ;
+			runf = 0 ;
+		}
+		i  = ( trim ) ? pt->find_last_not_of( ' ' ) + 1 : pt->size() ;
+		t1 = pt->substr( 0, i ) ;
+		if ( profXTabs )
+		{
+			i = t1.find_first_not_of( ' ' ) ;
+			if ( i == string::npos ) { i = t1.size() ; }
+			if ( i >= profXTabz )
+			{
+				t1.replace( 0, i - ( i % profXTabz ), i / profXTabz, '\t' ) ;
+			}
+		}
+		t2 = "N " + d2ds( t1.size() ) + " " + t1 ;
+		fout.write( t2 ) ;
+		bytes += t2.size() + 1 ;
+		++count ;
+		ln.il_jid   = ++nextId ;
+		ln.il_jhash = h ;
+	}
+
+	if ( runf > 0 )
+	{
+		t2 = "K " + d2ds( runf ) + " " + d2ds( runl ) ;
+		fout.write( t2 ) ;
+		bytes += t2.size() + 1 ;
+		++count ;
+	}
+
+	t2 = "E " + d2ds( count ) ;
+	fout.write( t2 ) ;
+	bytes += t2.size() + 1 ;
+
+	return ( fout.commit() ) ? 0 : 8 ;
+}
+
+
+bool pedit01::isRecoveryJournal( const string& jfile )
+{
+	//
+	// Return true if the recovery file is a journal written by writeRecoveryJournal().
+	// Recovery files from earlier releases contain the file data only.
+	//
+
+	TRACE_FUNCTION() ;
+
+	string inLine ;
+
+	std::ifstream fin( jfile.c_str() ) ;
+
+	return ( getline( fin, inLine ) && inLine == "LSPF-EDREC 1" ) ;
+}
+
+
+bool pedit01::replayRecoveryJournal( const string& jfile,
+				     const string& ofile )
+{
+	//
+	// Rebuild the file data from a recovery journal and write to ofile.
+	//
+	// The data for each line id is kept in lines (id-1) and the current file is held as a list of ids.
+	// Records are applied in order up to the last complete one.  A record that is truncated or
+	// inconsistent (eg. the system failed during the write) is ignored along with anything following it.
+	//
+
+	TRACE_FUNCTION() ;
+
+	uint i ;
+	uint first ;
+	uint last ;
+	uint count ;
+
+	size_t p ;
+	size_t nlines ;
+
+	bool valid = true ;
+
+	string inLine ;
+
+	vector<string> lines ;
+	vector<uint> cur ;
+	vector<uint> pend ;
+
+	std::ifstream fin( jfile.c_str() ) ;
+
+	fileWriter fout ;
+
+	getline( fin, inLine ) ;
+
+	while ( valid && getline( fin, inLine ) )
+	{
+		if ( inLine == "C" )
+		{
+			lines.clear() ;
+		}
+		else if ( inLine != "D" )
+		{
+			break ;
+		}
+		nlines = lines.size() ;
+		count  = 0 ;
+		valid  = false ;
+		pend.clear() ;
+		while ( getline( fin, inLine ) && inLine.size() > 2 && inLine[ 1 ] == ' ' )
+		{
+			if ( inLine[ 0 ] == 'N' )
+			{
+				p = inLine.find( ' ', 2 ) ;
+				if ( p == string::npos || !isnumeric( inLine.substr( 2, p - 2 ) ) ||
+				     inLine.size() - p - 1 != size_t( ds2d( inLine.substr( 2, p - 2 ) ) ) ) { break ; }
+				lines.push_back( inLine.substr( p + 1 ) ) ;
+				pend.push_back( lines.size() ) ;
+			}
+			else if ( inLine[ 0 ] == 'K' )
+			{
+				p = inLine.find( ' ', 2 ) ;
+				if ( p == string::npos ||
+				     !isnumeric( inLine.substr( 2, p - 2 ) ) ||
+				     !isnumeric( inLine.substr( p + 1 ) ) ) { break ; }
+				first = ds2d( inLine.substr( 2, p - 2 ) ) ;
+				last  = ds2d( inLine.substr( p + 1 ) ) ;
+				if ( first == 0 || first > last || last > nlines ) { break ; }
+				for ( i = first ; i <= last ; ++i )
 				{
-					rename( bfile, dfile ) ;
+					pend.push_back( i ) ;
 				}
-				rename( tfile, bfile ) ;
-				remove( dfile ) ;
 			}
+			else if ( inLine[ 0 ] == 'E' )
+			{
+				valid = ( isnumeric( inLine.substr( 2 ) ) && uint( ds2d( inLine.substr( 2 ) ) ) == count ) ;
+				break ;
+			}
+			else
+			{
+				break ;
+			}
+			++count ;
+		}
+		if ( valid )
+		{
+			cur.swap( pend ) ;
+		}
+		else
+		{
+			lines.resize( nlines ) ;
 		}
 	}
 
-	recvStatus = RECV_STOPPED ;
+	if ( !fout.open( ofile ) ) { return false ; }
+
+	for ( auto id : cur )
+	{
+		fout.write( lines[ id - 1 ] ) ;
+	}
+
+	return fout.commit() ;
 }
 
 
@@ -39,6 +39,9 @@ using namespace boost::filesystem ;
 #define ID_TFTS    0b00000001000010000000000000000000
 #define ID_RENUM   0b00000001000001000000000000000000
 
+// Storage used by a SORT run before it is written to a work file and merged.
+#define SORT_MEMORY ( 256 * 1024 * 1024 )
+
 
 enum RECV_STATUS
 {
@@ -1129,6 +1132,8 @@ class iline
 		static map<int, string>dst_file ;
 		static map<int, bool>file_changed ;
 		static map<int, bool>file_inserts ;
+		static map<int, uint>layout_gen ;
+		static boost::mutex layout_mtx ;
 
 		static void init_Globals( int task,
 					  bool vmode,
@@ -1142,6 +1147,8 @@ class iline
 			file_inserts[ task ]   = false ;
 			changed_ilabel[ task ] = false ;
 			changed_xclud[ task ]  = false ;
+			boost::mutex::scoped_lock lk( layout_mtx ) ;
+			layout_gen.insert( make_pair( task, 0 ) ) ;
 		}
 
 		static void set_Globals( int task,
@@ -1332,6 +1339,27 @@ class iline
 			return changed_xclud[ task ] ;
 		}
 
+		static uint get_layout_gen( int task )
+		{
+			//
+			// Generation number that changes whenever a line is added, removed, deleted, excluded
+			// or shown, or has its type changed.  Used to invalidate cached block sizes and line numbers.
+			//
+			// The map is shared by all edit sessions, which run on different threads, so access
+			// is serialised.  Entries are created by init_Globals() and are never reset as a
+			// session may still hold a cached generation from an earlier edit.
+			//
+
+			boost::mutex::scoped_lock lk( layout_mtx ) ;
+			return layout_gen[ task ] ;
+		}
+
+		static void set_layout_changed( int task )
+		{
+			boost::mutex::scoped_lock lk( layout_mtx ) ;
+			++layout_gen[ task ] ;
+		}
+
 		static void status_put( int task,
 					SS_TYPE type,
 					const profile& prof,
@@ -1525,6 +1553,9 @@ class iline
 			il_vShadow  = false  ;
 			il_wShadow  = false  ;
 			il_nsect    = false  ;
+			il_nfgen    = 0      ;
+			il_jid      = 0      ;
+			il_jhash    = 0      ;
 			il_xclud.push( iexcl() ) ;
 		}
 
@@ -1552,14 +1583,21 @@ class iline
 		bool     il_vShadow ;
 		bool     il_wShadow ;
 		bool     il_nsect   ;
-		stack  <icond>  il_cond ;
-		stack  <icond>  il_cond_redo ;
-		stack  <iexcl>  il_xclud ;
-		stack  <iexcl>  il_xclud_redo ;
-		stack  <ilabel> il_label ;
-		stack  <ilabel> il_label_redo ;
-		stack  <idata>  il_idata ;
-		stack  <idata>  il_idata_redo ;
+		uint     il_nfgen   ;
+		uint     il_jid     ;
+		size_t   il_jhash   ;
+		//
+		// Use vectors for the undo stacks.  Most lines only ever have one entry and an empty
+		// deque allocates several hundred bytes which is significant for very large files.
+		//
+		stack  <icond,  vector<icond>>  il_cond ;
+		stack  <icond,  vector<icond>>  il_cond_redo ;
+		stack  <iexcl,  vector<iexcl>>  il_xclud ;
+		stack  <iexcl,  vector<iexcl>>  il_xclud_redo ;
+		stack  <ilabel, vector<ilabel>> il_label ;
+		stack  <ilabel, vector<ilabel>> il_label_redo ;
+		stack  <idata,  vector<idata>>  il_idata ;
+		stack  <idata,  vector<idata>>  il_idata_redo ;
 
 		void set_file_insert( int lnumSize )
 		{
@@ -1705,6 +1743,7 @@ class iline
 		{
 			if ( il_xclud.top().ix_excl != b )
 			{
+				set_layout_changed( il_taskid ) ;
 				if ( setUNDO[ il_taskid ] )
 				{
 					il_xclud.push( iexcl( b, lvl ) ) ;
@@ -2657,6 +2696,7 @@ class iline
 		{
 			if ( !is_tod_or_bod() && !il_deleted )
 			{
+				set_layout_changed( il_taskid ) ;
 				if ( setUNDO[ il_taskid ] )
 				{
 					put_idata( "", level, 0, false ) ;
@@ -2679,6 +2719,7 @@ class iline
 			// Add file status ID_ISRT | ID_OWRITE.
 			//
 			il_type = LN_FILE ;
+			set_layout_changed( il_taskid ) ;
 			il_idata.top().add_status( ID_ISRT | ID_OWRITE ) ;
 			if ( !is_File_save( il_taskid ) )
 			{
@@ -2769,6 +2810,7 @@ class iline
 				{
 					il_deleted = false ;
 				}
+				set_layout_changed( il_taskid ) ;
 				il_idata_redo.push( il_idata.top() ) ;
 				il_idata.pop() ;
 				if ( il_idata.empty() )
@@ -2784,6 +2826,7 @@ class iline
 			if ( setUNDO[ il_taskid ] )
 			{
 				il_deleted = il_idata_redo.top().id_delete ;
+				set_layout_changed( il_taskid ) ;
 				il_idata.push( il_idata_redo.top() ) ;
 				il_idata_redo.pop() ;
 			}
@@ -2833,6 +2876,7 @@ class iline
 			{
 				il_xclud_redo.push( il_xclud.top() ) ;
 				il_xclud.pop() ;
+				set_layout_changed( il_taskid ) ;
 				Redo_other[ il_taskid ] = true ;
 			}
 		}
@@ -2843,6 +2887,7 @@ class iline
 			{
 				il_xclud.push( il_xclud_redo.top() ) ;
 				il_xclud_redo.pop() ;
+				set_layout_changed( il_taskid ) ;
 			}
 		}
 
@@ -3385,6 +3430,11 @@ class Data
 
 	void clear()
 	{
+		if ( ln_bottom )
+		{
+			iline::set_layout_changed( ln_bottom->il_taskid ) ;
+		}
+
 		for ( iline* i = ln_end->il_prev ; i ; i = i->il_prev )
 		{
 			delete i->il_next ;
@@ -3432,6 +3482,8 @@ class Data
 
 		ln_bottom = ln_new ;
 
+		iline::set_layout_changed( ln_new->il_taskid ) ;
+
 		if ( ln_new->il_prev )
 		{
 			ln_new->il_seqn = ln_new->il_prev->il_seqn + 1000 ;
@@ -3457,6 +3509,8 @@ class Data
 		ln_new->il_next = ln_isrt ;
 		ln_new->il_prev = ln_prev ;
 
+		iline::set_layout_changed( ln_new->il_taskid ) ;
+
 		if ( !reseq )
 		{
 			diff = ( ln_isrt->il_seqn - ln_prev->il_seqn ) / 2 ;
@@ -3480,6 +3534,8 @@ class Data
 
 		ln_curr->il_next->il_prev = ln_curr->il_prev ;
 		ln_curr->il_prev->il_next = ln_curr->il_next ;
+
+		iline::set_layout_changed( ln_curr->il_taskid ) ;
 	}
 
 	void resequence()
@@ -3613,6 +3669,8 @@ map<int, bool> iline::file_inserts ;
 map<int, bool> iline::changed_icond ;
 map<int, bool> iline::changed_ilabel ;
 map<int, bool> iline::changed_xclud ;
+map<int, uint> iline::layout_gen ;
+boost::mutex iline::layout_mtx ;
 
 
 class ipos
@@ -3719,6 +3777,33 @@ class ipos
 } ;
 
 
+class xblock
+{
+	//
+	// Extent of a block of excluded lines.
+	//
+	// xb_first   - first non-deleted line in the block.
+	// xb_last    - last line in the block (may be a deleted line).
+	// xb_exlines - number of non-deleted lines in the block.
+	// xb_bklines - number of lines from xb_first to xb_last, including deleted lines.
+	//
+
+	public:
+		xblock()
+		{
+			xb_first   = nullptr ;
+			xb_last    = nullptr ;
+			xb_exlines = 0 ;
+			xb_bklines = 0 ;
+		}
+
+		iline* xb_first   ;
+		iline* xb_last    ;
+		int    xb_exlines ;
+		int    xb_bklines ;
+} ;
+
+
 class cmd_range
 {
 	private:
@@ -3774,6 +3859,7 @@ class edit_find
 			f_ostring  = ""    ;
 			f_cstring  = ""    ;
 			f_rstring  = ""    ;
+			f_rlit     = ""    ;
 			f_success  = true  ;
 			f_error    = false ;
 			f_top      = false ;
@@ -3849,6 +3935,31 @@ class edit_find
 			if ( f_rstring == "" ) { f_rstring = s ; }
 		}
 
+		bool f_rlit_in( string::const_iterator itss,
+				string::const_iterator itse ) const
+		{
+			//
+			// Return true if the literal every regex match must contain is in the range,
+			// or there is no such literal.
+			//
+
+			if ( f_rlit == "" )
+			{
+				return true ;
+			}
+			if ( f_asis )
+			{
+				return ( itse >= itss && size_t( itse - itss ) >= f_rlit.size() &&
+					 memmem( &( *itss ), itse - itss, f_rlit.data(), f_rlit.size() ) != nullptr ) ;
+			}
+
+			return ( search( itss, itse, f_rlit.begin(), f_rlit.end(),
+				[]( char a, char b )
+				{
+					return ( toupper( a ) == b ) ;
+				} ) != itse ) ;
+		}
+
 		void f_set_match( const string& s )
 		{
 			f_mtch = s.front() ;
@@ -4158,6 +4269,7 @@ class edit_find
 		string f_ostring ;
 		string f_cstring ;
 		string f_rstring ;
+		string f_rlit    ;
 		bool   f_success ;
 		bool   f_error   ;
 		bool   f_top     ;
@@ -6459,6 +6571,334 @@ class Del
 } ;
 
 
+class fileWriter
+{
+	//
+	// Buffered output file for SAVE and the edit recovery journal.
+	//
+	// Data is collected in a large buffer and written with write(2) when full.  The file is written
+	// to a temporary file in the same directory, synced to disk and renamed over the target so a
+	// failure part way through leaves the original file intact.  Permissions and ownership of an
+	// existing file are copied to the temporary file before the rename.  Ownership is set first as
+	// fchown clears the setuid and setgid bits.  If the file is ours only the group need be set.
+	//
+	// A new file, or one with multiple hard links, is written in place.  This is also done if the
+	// directory is not writable or ownership cannot be preserved.  Symbolic links are resolved so
+	// the link itself is kept.
+	//
+	// open_append() adds to the end of an existing file in place.  commit() syncs the data.
+	//
+
+	public:
+		fileWriter( size_t sz = 1048576 )
+		{
+			fd     = -1 ;
+			bufsz  = sz ;
+			failed = false ;
+			buf.reserve( bufsz + 4096 ) ;
+		}
+
+		~fileWriter()
+		{
+			abort() ;
+		}
+
+		bool open( const string& f )
+		{
+			int fdt ;
+
+			struct stat st ;
+
+			char* rp ;
+
+			string dir ;
+			string tmp ;
+
+			bool exists ;
+
+			target = f ;
+			tfile  = "" ;
+			failed = false ;
+
+			if ( lstat( target.c_str(), &st ) == 0 && S_ISLNK( st.st_mode ) )
+			{
+				rp = realpath( target.c_str(), nullptr ) ;
+				if ( rp )
+				{
+					target = rp ;
+					free( rp ) ;
+				}
+			}
+
+			exists = ( stat( target.c_str(), &st ) == 0 ) ;
+
+			if ( exists && st.st_nlink == 1 )
+			{
+				size_t p = target.find_last_of( '/' ) ;
+				dir = ( p == string::npos ) ? "." : ( p == 0 ) ? "/" : target.substr( 0, p ) ;
+				tmp = ( p == string::npos ) ? "." + target : dir + "/." + target.substr( p + 1 ) ;
+				tmp += ".lspf.XXXXXX" ;
+				vector<char> tname( tmp.begin(), tmp.end() ) ;
+				tname.push_back( 0x00 ) ;
+				fdt = mkostemp( tname.data(), O_CLOEXEC ) ;
+				if ( fdt != -1 )
+				{
+					if ( ( fchown( fdt, st.st_uid, st.st_gid ) != 0 &&
+					     ( st.st_uid != geteuid() || fchown( fdt, -1, st.st_gid ) != 0 ) ) ||
+					       fchmod( fdt, st.st_mode & 07777 ) != 0 )
+					{
+						close( fdt ) ;
+						unlink( tname.data() ) ;
+					}
+					else
+					{
+						fd    = fdt ;
+						tfile = tname.data() ;
+						tdir  = dir ;
+						return true ;
+					}
+				}
+			}
+
+			fd = ::open( target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 ) ;
+
+			return ( fd != -1 ) ;
+		}
+
+		bool open_append( const string& f )
+		{
+			target = f ;
+			tfile  = "" ;
+			failed = false ;
+
+			fd = ::open( target.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC ) ;
+
+			return ( fd != -1 ) ;
+		}
+
+		void write( const string& s )
+		{
+			buf += s ;
+			buf.push_back( '\n' ) ;
+			if ( buf.size() >= bufsz )
+			{
+				flush() ;
+			}
+		}
+
+		bool commit()
+		{
+			//
+			// Write out any buffered data, sync the file, and rename the temporary file over the target.
+			//
+
+			int dfd ;
+
+			flush() ;
+
+			if ( failed || fsync( fd ) != 0 )
+			{
+				abort() ;
+				return false ;
+			}
+
+			if ( close( fd ) != 0 )
+			{
+				fd = -1 ;
+				abort() ;
+				return false ;
+			}
+
+			fd = -1 ;
+
+			if ( tfile != "" )
+			{
+				if ( rename( tfile.c_str(), target.c_str() ) != 0 )
+				{
+					abort() ;
+					return false ;
+				}
+				tfile = "" ;
+				dfd   = ::open( tdir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ;
+				if ( dfd != -1 )
+				{
+					fsync( dfd ) ;
+					close( dfd ) ;
+				}
+			}
+
+			return true ;
+		}
+
+		void abort()
+		{
+			if ( fd != -1 )
+			{
+				close( fd ) ;
+				fd = -1 ;
+			}
+			if ( tfile != "" )
+			{
+				unlink( tfile.c_str() ) ;
+				tfile = "" ;
+			}
+			buf.clear() ;
+		}
+
+	private:
+		void flush()
+		{
+			size_t p = 0 ;
+
+			ssize_t n ;
+
+			while ( !failed && p < buf.size() )
+			{
+				n = ::write( fd, buf.data() + p, buf.size() - p ) ;
+				if ( n < 0 )
+				{
+					if ( errno == EINTR ) { continue ; }
+					failed = true ;
+					break ;
+				}
+				p += n ;
+			}
+
+			buf.clear() ;
+		}
+
+		int    fd     ;
+		size_t bufsz  ;
+		bool   failed ;
+		string buf    ;
+		string target ;
+		string tfile  ;
+		string tdir   ;
+} ;
+
+
+class fileReader
+{
+	//
+	// Input file for EDIT/VIEW.
+	//
+	// The file is read with read(2) into a buffer and each line is copied from the buffer.  Regular
+	// files are not mapped as a file truncated by another process while it is being read would
+	// raise SIGBUS.  The kernel is told the file is read sequentially so readahead is increased.
+	//
+	// getline() behaves like std::getline.  A final line without a newline is returned.
+	//
+
+	public:
+		fileReader( size_t sz = 1048576 )
+		{
+			fd    = -1 ;
+			bufsz = sz ;
+			pos   = 0 ;
+			eof   = false ;
+		}
+
+		~fileReader()
+		{
+			close() ;
+		}
+
+		bool open( const string& f )
+		{
+			close() ;
+
+			fd = ::open( f.c_str(), O_RDONLY | O_CLOEXEC ) ;
+			if ( fd == -1 )
+			{
+				return false ;
+			}
+
+			posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL ) ;
+
+			return true ;
+		}
+
+		bool is_open() const
+		{
+			return ( fd != -1 ) ;
+		}
+
+		bool getline( string& s )
+		{
+			const char* p ;
+
+			while ( true )
+			{
+				p = static_cast<const char*>( memchr( buf.data() + pos, '\n', buf.size() - pos ) ) ;
+				if ( p )
+				{
+					s.assign( buf.data() + pos, p - buf.data() - pos ) ;
+					pos = p - buf.data() + 1 ;
+					return true ;
+				}
+				if ( eof )
+				{
+					if ( pos >= buf.size() )
+					{
+						return false ;
+					}
+					s.assign( buf, pos, string::npos ) ;
+					pos = buf.size() ;
+					return true ;
+				}
+				fill() ;
+			}
+		}
+
+		void rewind()
+		{
+			lseek( fd, 0, SEEK_SET ) ;
+			buf.clear() ;
+			pos = 0 ;
+			eof = false ;
+		}
+
+		void close()
+		{
+			if ( fd != -1 )
+			{
+				::close( fd ) ;
+				fd = -1 ;
+			}
+			buf.clear() ;
+			pos = 0 ;
+			eof = false ;
+		}
+
+	private:
+		void fill()
+		{
+			ssize_t n ;
+
+			buf.erase( 0, pos ) ;
+			pos = buf.size() ;
+			buf.resize( pos + bufsz ) ;
+
+			while ( ( n = ::read( fd, &buf[ pos ], bufsz ) ) < 0 && errno == EINTR ) {}
+
+			if ( n <= 0 )
+			{
+				n   = 0 ;
+				eof = true ;
+			}
+
+			buf.resize( pos + n ) ;
+			pos = 0 ;
+		}
+
+		int    fd    ;
+		size_t bufsz ;
+		size_t pos   ;
+		bool   eof   ;
+		string buf   ;
+} ;
+
+
 class line_data
 {
 	public:
@@ -6507,6 +6947,309 @@ class line_data
 } ;
 
 
+class sort_run
+{
+	//
+	// A run of lines for SORT.
+	//
+	// Each line has a fixed-width key made from the sort fields, padded with 0x00 and complemented
+	// for descending fields, so lines compare with memcmp.  The first 8 bytes of the key are held as
+	// an integer with the line number in the run so most compares do not touch the key data.
+	//
+	// sort() sorts the run in parallel chunks which are then merged.  Lines with equal keys keep
+	// their original order.
+	//
+	// write() appends the lines in sorted order to a work file for sort_reader to merge.
+	//
+
+	public:
+		sort_run( const vector<size_t>& a,
+			  const vector<size_t>& l,
+			  const vector<bool>& asc ) : col_a( a ), col_l( l ), srt_asc( asc )
+		{
+			klen  = 0 ;
+			bytes = 0 ;
+			for ( auto n : l )
+			{
+				klen += n ;
+			}
+		}
+
+		void add( iline& d )
+		{
+			size_t i ;
+			size_t j ;
+			size_t n ;
+			size_t p = keys.size() ;
+
+			line_data t ;
+
+			t.set_string( d ) ;
+
+			const string& s = t.line_str ;
+
+			keys.resize( p + klen, 0x00 ) ;
+			for ( i = 0 ; i < col_a.size() ; ++i )
+			{
+				if ( col_a[ i ] < s.size() )
+				{
+					n = min( col_l[ i ], s.size() - col_a[ i ] ) ;
+					keys.replace( p, n, s, col_a[ i ], n ) ;
+				}
+				if ( !srt_asc[ i ] )
+				{
+					for ( j = p ; j < p + col_l[ i ] ; ++j )
+					{
+						keys[ j ] = ~keys[ j ] ;
+					}
+				}
+				p += col_l[ i ] ;
+			}
+
+			bytes += sizeof( line_data ) + s.capacity() + t.line_label.size() + klen + sizeof( pair<uint64_t, uint32_t> ) ;
+			recs.push_back( std::move( t ) ) ;
+		}
+
+		void sort()
+		{
+			size_t i ;
+			size_t j ;
+
+			uint w ;
+			uint chunks ;
+
+			uint64_t pfx ;
+
+			const size_t min_chunk = 16384 ;
+
+			const unsigned char* k ;
+
+			ord.resize( recs.size() ) ;
+			for ( i = 0 ; i < recs.size() ; ++i )
+			{
+				k   = reinterpret_cast<const unsigned char*>( keys.data() + i * klen ) ;
+				pfx = 0 ;
+				for ( j = 0 ; j < 8 ; ++j )
+				{
+					pfx = ( pfx << 8 ) | ( ( j < klen ) ? k[ j ] : 0 ) ;
+				}
+				ord[ i ] = make_pair( pfx, uint32_t( i ) ) ;
+			}
+
+			auto comp = [ this ]( const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b )
+			{
+				if ( a.first != b.first )
+				{
+					return a.first < b.first ;
+				}
+				if ( klen > 8 )
+				{
+					int c = memcmp( keys.data() + a.second * klen + 8,
+							keys.data() + b.second * klen + 8,
+							klen - 8 ) ;
+					if ( c != 0 ) { return c < 0 ; }
+				}
+				return a.second < b.second ;
+			} ;
+
+			auto bound = [ this, &chunks ]( size_t c )
+			{
+				return ord.begin() + ord.size() * c / chunks ;
+			} ;
+
+			chunks = parallel_ranges( ord.size(), min_chunk,
+				[ this, &comp ]( size_t b, size_t e, uint c )
+				{
+					std::sort( ord.begin() + b, ord.begin() + e, comp ) ;
+				} ) ;
+
+			for ( w = 1 ; w < chunks ; w *= 2 )
+			{
+				parallel_ranges( ( chunks + 2 * w - 1 ) / ( 2 * w ), 1,
+					[ &comp, &bound, chunks, w ]( size_t b, size_t e, uint c )
+					{
+						for ( ; b < e ; ++b )
+						{
+							size_t c1 = b * 2 * w ;
+							if ( c1 + w < chunks )
+							{
+								inplace_merge( bound( c1 ),
+									       bound( c1 + w ),
+									       bound( min( size_t( c1 + 2 * w ), size_t( chunks ) ) ),
+									       comp ) ;
+							}
+						}
+					} ) ;
+			}
+		}
+
+		bool write( FILE* fp )
+		{
+			uint32_t l1 ;
+			uint32_t l2 ;
+
+			char c[ 2 ] ;
+
+			for ( const auto& o : ord )
+			{
+				const line_data& r = recs[ o.second ] ;
+				l1     = r.line_str.size() ;
+				l2     = r.line_label.size() ;
+				c[ 0 ] = char( r.line_type ) ;
+				c[ 1 ] = char( r.line_excl ) ;
+				fwrite( keys.data() + o.second * klen, 1, klen, fp ) ;
+				fwrite( &l1, sizeof( l1 ), 1, fp ) ;
+				fwrite( r.line_str.data(), 1, l1, fp ) ;
+				fwrite( &l2, sizeof( l2 ), 1, fp ) ;
+				fwrite( r.line_label.data(), 1, l2, fp ) ;
+				fwrite( c, 1, 2, fp ) ;
+			}
+
+			return ( fflush( fp ) == 0 && !ferror( fp ) ) ;
+		}
+
+		void clear()
+		{
+			keys.clear() ;
+			recs.clear() ;
+			ord.clear() ;
+			bytes = 0 ;
+		}
+
+		size_t size() const
+		{
+			return recs.size() ;
+		}
+
+		size_t key_len() const
+		{
+			return klen ;
+		}
+
+		line_data& at( size_t i )
+		{
+			return recs[ ord[ i ].second ] ;
+		}
+
+		size_t bytes ;
+
+	private:
+		const vector<size_t>& col_a ;
+		const vector<size_t>& col_l ;
+		const vector<bool>& srt_asc ;
+
+		size_t klen ;
+
+		string keys ;
+
+		vector<line_data> recs ;
+
+		vector<pair<uint64_t, uint32_t>> ord ;
+} ;
+
+
+class sort_reader
+{
+	//
+	// Read back the lines of a sorted run written by sort_run::write().
+	// Readers compare on key then run number, so equal keys from earlier runs come first.
+	//
+	// check() reads the whole run so a work file error is found before any data is replaced.
+	// The work file is not closed by the reader.
+	//
+
+	public:
+		sort_reader( size_t l,
+			     uint r )
+		{
+			klen   = l ;
+			run    = r ;
+			rerror = false ;
+			fp     = nullptr ;
+		}
+
+		bool open( FILE* f )
+		{
+			fp     = f ;
+			rerror = false ;
+			return ( fseek( fp, 0, SEEK_SET ) == 0 ) ;
+		}
+
+		bool check( size_t& n )
+		{
+			while ( next() ) { ++n ; }
+
+			return ( !rerror && open( fp ) ) ;
+		}
+
+		bool next()
+		{
+			uint32_t l ;
+
+			char c[ 2 ] ;
+
+			size_t n ;
+
+			key.resize( klen ) ;
+			n = fread( &key[ 0 ], 1, klen, fp ) ;
+			if ( n < klen )
+			{
+				rerror = ( n > 0 || ferror( fp ) ) ;
+				return false ;
+			}
+
+			rerror = true ;
+
+			if ( !get( &l, sizeof( l ) ) ) { return false ; }
+			rec.line_str.resize( l ) ;
+			if ( !get( &rec.line_str[ 0 ], l ) ) { return false ; }
+			rec.line_len = l ;
+
+			if ( !get( &l, sizeof( l ) ) ) { return false ; }
+			rec.line_label.resize( l ) ;
+			if ( !get( &rec.line_label[ 0 ], l ) ) { return false ; }
+
+			if ( !get( c, 2 ) ) { return false ; }
+			rec.line_type = LS_TYPE( c[ 0 ] ) ;
+			rec.line_excl = ( c[ 1 ] != 0 ) ;
+
+			rerror = false ;
+
+			return true ;
+		}
+
+		bool error() const
+		{
+			return rerror ;
+		}
+
+		bool operator > ( const sort_reader& rhs ) const
+		{
+			int c = key.compare( rhs.key ) ;
+			return ( c > 0 || ( c == 0 && run > rhs.run ) ) ;
+		}
+
+		line_data rec ;
+
+	private:
+		bool get( void* p,
+			  size_t n )
+		{
+			return ( fread( p, 1, n, fp ) == n ) ;
+		}
+
+		size_t klen ;
+
+		uint run ;
+
+		bool rerror ;
+
+		string key ;
+
+		FILE* fp ;
+} ;
+
+
 class pedit01 : public pApplication
 {
 	public:
@@ -6516,6 +7259,14 @@ class pedit01 : public pApplication
 
 		void isredit( const string& ) ;
 
+		void isredit_get_lines( const string&,
+					const string&,
+					vector<string>& ) ;
+
+		void isredit_put_lines( const string&,
+					const string&,
+					const vector<string>& ) ;
+
 		map<string, stack<defName>> defNames ;
 		cmdblock pcmd ;
 
@@ -6575,6 +7326,9 @@ class pedit01 : public pApplication
 		void startRecoveryTask()  ;
 		void stopRecoveryTask()   ;
 		void updateRecoveryData() ;
+		int  writeRecoveryJournal( bool, uint&, size_t& ) ;
+		bool isRecoveryJournal( const string& ) ;
+		bool replayRecoveryJournal( const string&, const string& ) ;
 		void fill_dynamic_area()  ;
 		void fill_hilight_shadow();
 		void clr_hilight_shadow() ;
@@ -6614,6 +7368,9 @@ class pedit01 : public pApplication
 
 		void hiliteFindPhrase() ;
 
+		bool getFindRegex( edit_find& ) ;
+		string getRegexLiteral( const string& ) ;
+
 		void actionFind() ;
 		bool actionFind_regex( iline*,
 				       int,
@@ -6631,6 +7388,15 @@ class pedit01 : public pApplication
 					  int,
 					  int ) ;
 
+		void actionFind_prefilter( iline*,
+					   iline*,
+					   int,
+					   int ) ;
+
+		bool actionFind_candidate( const iline*,
+					   int,
+					   int ) ;
+
 		void actionChange() ;
 
 		void check_delete( Del& ) ;
@@ -6664,6 +7430,7 @@ class pedit01 : public pApplication
 
 		void actionService() ;
 		void querySetting() ;
+		bool bulkService( const string& ) ;
 
 		void clr_zedimsgs() ;
 		void set_zedimsgs() ;
@@ -6696,6 +7463,8 @@ class pedit01 : public pApplication
 		Data::Iterator getLastEX( Data::Iterator ) ;
 		int  getExclBlockSize( Data::Iterator ) ;
 		int  getDataBlockSize( Data::Iterator ) ;
+		const xblock& getExclBlock( Data::Iterator ) ;
+		void checkLayoutCache() ;
 
 		iline* getLastADDR( Data::Iterator, int ) ;
 
@@ -6753,13 +7522,6 @@ class pedit01 : public pApplication
 
 		string& convertiTabs( string& ) ;
 
-		void copyFileData( vector<line_data>&,
-				   bool,
-				   bool,
-				   Data::Iterator,
-				   Data::Iterator,
-				   size_t& ) ;
-
 		void reflowData( vector<string>&,
 				 int,
 				 int,
@@ -6935,6 +7697,9 @@ class pedit01 : public pApplication
 		string getMaskLine2() ;
 
 		void sort_data( const string& ) ;
+		void sort_put_line( Data::Iterator,
+				    line_data&,
+				    bool& ) ;
 
 		string rshiftCols( int,
 				   const string* ) ;
@@ -7186,6 +7951,16 @@ class pedit01 : public pApplication
 		edit_find fcx_parms ;
 		hilight hlight      ;
 
+		map<string, boost::regex> regexCache ;
+
+		map<iline*, xblock> xblocks ;
+		map<iline*, int> fileLines ;
+		uint layoutGen ;
+
+		uint findGen        ;
+		bool findGenOn      ;
+		bool findPrefilter  ;
+
 		bool rebuildZAREA  ;
 		bool rebuildShadow ;
 		bool fileChanged   ;
@@ -34,6 +34,10 @@
 #include <boost/regex.hpp>
 #include <list>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include "../lspfall.h"
 
 #include "ehilight.cpp"
@@ -290,6 +294,66 @@ void pedmcp1::isredit( const string& s )
 }
 
 
+void pedmcp1::isredit_get_lines( const string& lptr1,
+				 const string& lptr2,
+				 vector<string>& lines )
+{
+	//
+	// Return the data of file lines lptr1 to lptr2 in one call.
+	//
+
+	if ( mibptr->fatal )
+	{
+		RC = mibptr->RC ;
+		return ;
+	}
+
+	pedit01* editAppl = static_cast<pedit01*>( mibptr->editAppl ) ;
+
+	editAppl->isredit_get_lines( lptr1, lptr2, lines ) ;
+
+	if ( mibptr->fatal )
+	{
+		mibptr->isrError = true ;
+		macroError() ;
+	}
+	else
+	{
+		RC = mibptr->RC ;
+	}
+}
+
+
+void pedmcp1::isredit_put_lines( const string& cmd,
+				 const string& lptr,
+				 const vector<string>& lines )
+{
+	//
+	// Replace (LINE) or add (LINE_AFTER, LINE_BEFORE) lines at lptr in one call.
+	//
+
+	if ( mibptr->fatal )
+	{
+		RC = mibptr->RC ;
+		return ;
+	}
+
+	pedit01* editAppl = static_cast<pedit01*>( mibptr->editAppl ) ;
+
+	editAppl->isredit_put_lines( upper( cmd ), lptr, lines ) ;
+
+	if ( mibptr->fatal )
+	{
+		mibptr->isrError = true ;
+		macroError() ;
+	}
+	else
+	{
+		RC = mibptr->RC ;
+	}
+}
+
+
 bool pedmcp1::is_pgmmacro( miblock* mibptr )
 {
 	//
@@ -24,6 +24,15 @@ class pedmcp1 : public pApplication
 		virtual ~pedmcp1() {}
 
 		void isredit( const string& ) ;
+
+		void isredit_get_lines( const string&,
+					const string&,
+					vector<string>& ) ;
+
+		void isredit_put_lines( const string&,
+					const string&,
+					const vector<string>& ) ;
+
 		virtual void start_pgm() = 0 ;
 
 	private:
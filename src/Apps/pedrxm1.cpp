@@ -48,6 +48,10 @@
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include "../lspfall.h"
 
 #include "../pTSOenv.h"
@@ -95,6 +99,25 @@ int setRexxVariable( string,
 int getAllRexxVariables( pApplication* ) ;
 int setAllRexxVariables( pApplication* ) ;
 
+int getRexxStem( const string&,
+		 vector<string>& ) ;
+
+int setRexxStem( const string&,
+		 const vector<string>& ) ;
+
+int editStemLines( miblock*,
+		   const string&,
+		   const string&,
+		   const string&,
+		   const string&,
+		   const string& ) ;
+
+bool is_stemlines( const string&,
+		   string&,
+		   string&,
+		   string&,
+		   string& ) ;
+
 bool is_pgmmacro( miblock* ) ;
 
 
@@ -711,6 +734,11 @@ RexxObjectPtr RexxEntry editServiceHandler( RexxExitContext* context,
 	void* vptr ;
 	miblock* mibptr ;
 
+	string cmd ;
+	string stem ;
+	string lptr1 ;
+	string lptr2 ;
+
 	string s = context->CString( command ) ;
 
 	vptr   = context->GetApplicationData() ;
@@ -723,6 +751,11 @@ RexxObjectPtr RexxEntry editServiceHandler( RexxExitContext* context,
 		return context->WholeNumber( 28 ) ;
 	}
 
+	if ( s.find( '&' ) == string::npos && is_stemlines( s, cmd, stem, lptr1, lptr2 ) )
+	{
+		return context->WholeNumber( editStemLines( mibptr, s, cmd, stem, lptr1, lptr2 ) ) ;
+	}
+
 	getAllRexxVariables( macAppl ) ;
 
 	editAppl->isredit( macAppl->sub_vars( s ) ) ;
@@ -817,6 +850,139 @@ RexxObjectPtr RexxEntry editServiceHandler( RexxExitContext* context,
 }
 
 
+int editStemLines( miblock* mibptr,
+		   const string& s,
+		   const string& cmd,
+		   const string& stem,
+		   const string& lptr1,
+		   const string& lptr2 )
+{
+	//
+	// Transfer a range of lines between the edit data and a REXX stem in one call.
+	//   (STEM.) = LINE lptr1 lptr2      - set STEM.1 to STEM.n and STEM.0 to n.
+	//   LINE lptr = (STEM.)             - replace lines starting at lptr with STEM.1 to STEM.n.
+	//   LINE_AFTER lptr = (STEM.)       - add STEM.1 to STEM.n after lptr.
+	//   LINE_BEFORE lptr = (STEM.)      - add STEM.1 to STEM.n before lptr.
+	//
+	// The stem is read/written directly in the REXX variable pool, so the function pool is
+	// not synchronised with all REXX variables as for other edit commands.
+	//
+
+	TRACE_FUNCTION() ;
+
+	vector<string> lines ;
+
+	pedit01* editAppl = static_cast<pedit01*>( mibptr->editAppl ) ;
+	pedrxm1* macAppl  = static_cast<pedrxm1*>( mibptr->macAppl  ) ;
+
+	if ( cmd == "" )
+	{
+		editAppl->isredit_get_lines( lptr1, lptr2, lines ) ;
+		if ( !mibptr->fatal && setRexxStem( stem, lines ) != RXSHV_OK )
+		{
+			mibptr->seterror( "PEDM013M", stem, 20 ) ;
+		}
+	}
+	else if ( getRexxStem( stem, lines ) == RXSHV_OK )
+	{
+		editAppl->isredit_put_lines( cmd, lptr1, lines ) ;
+	}
+	else
+	{
+		mibptr->reset() ;
+		mibptr->seterror( "PEDM013M", stem, 20 ) ;
+	}
+
+	if ( mibptr->fatal )
+	{
+		mibptr->sttment  = s ;
+		mibptr->isrError = true ;
+		macAppl->macroError() ;
+		setAllRexxVariables( macAppl ) ;
+	}
+	else if ( mibptr->messageOn )
+	{
+		setRexxVariable( "ZEDMSGNO", "" ) ;
+		setRexxVariable( "ZEDISMSG", "" ) ;
+		setRexxVariable( "ZEDILMSG", "" ) ;
+	}
+
+	return mibptr->RC ;
+}
+
+
+bool is_stemlines( const string& s,
+		   string& cmd,
+		   string& stem,
+		   string& lptr1,
+		   string& lptr2 )
+{
+	//
+	// Return true if s is a bulk LINE statement using a stem variable (name ending in a period).
+	// cmd is blank for the assignment form (STEM.) = LINE lptr1 lptr2.
+	//
+
+	TRACE_FUNCTION() ;
+
+	size_t ws ;
+
+	string t ;
+	string w1 ;
+
+	for ( auto c : s )
+	{
+		if ( c == '(' || c == ')' || c == '=' )
+		{
+			t += ' ' ;
+			t += c ;
+			t += ' ' ;
+		}
+		else
+		{
+			t += c ;
+		}
+	}
+
+	if ( upper( word( t, 1 ) ) == "ISREDIT" )
+	{
+		idelword( t, 1, 1 ) ;
+	}
+
+	ws = words( t ) ;
+	w1 = upper( word( t, 1 ) ) ;
+
+	if ( ws == 7 && w1 == "(" && word( t, 3 ) == ")" && word( t, 4 ) == "=" && upper( word( t, 5 ) ) == "LINE" )
+	{
+		cmd   = "" ;
+		stem  = upper( word( t, 2 ) ) ;
+		lptr1 = word( t, 6 ) ;
+		lptr2 = word( t, 7 ) ;
+	}
+	else if ( findword( w1, "LINE LINE_AFTER LINE_BEFORE" ) && word( t, 3 ) == "=" )
+	{
+		if ( w1 != "LINE" && ws == 7 && upper( word( t, 4 ) ) == "DATALINE" )
+		{
+			idelword( t, 4, 1 ) ;
+			--ws ;
+		}
+		if ( ws != 6 || word( t, 4 ) != "(" || word( t, 6 ) != ")" )
+		{
+			return false ;
+		}
+		cmd   = w1 ;
+		stem  = upper( word( t, 5 ) ) ;
+		lptr1 = word( t, 2 ) ;
+		lptr2 = "" ;
+	}
+	else
+	{
+		return false ;
+	}
+
+	return ( stem.size() > 1 && stem.find( '.' ) == stem.size() - 1 ) ;
+}
+
+
 RexxObjectPtr RexxEntry TSOServiceHandler( RexxExitContext* context,
 					   RexxStringObject address,
 					   RexxStringObject command )
@@ -993,6 +1159,132 @@ int setRexxVariable( string n,
 	return RexxVariablePool( &var ) ;
 }
 
+
+int getRexxStem( const string& stem,
+		 vector<string>& lines )
+{
+	//
+	// Get stem.1 to stem.n from the Rexx variable pool, where n is the value of stem.0.
+	// The variables are chained so the pool is called once for all lines.
+	//
+	// Return RXSHV_OK if all variables have been retrieved.
+	//
+
+	TRACE_FUNCTION() ;
+
+	int rc ;
+
+	size_t i ;
+	size_t n ;
+
+	string v ;
+	string name = stem + "0" ;
+
+	vector<string> names ;
+	vector<SHVBLOCK> vars ;
+
+	SHVBLOCK var ;
+
+	lines.clear() ;
+
+	var.shvcode = RXSHV_SYFET ;
+	var.shvret  = 0 ;
+	var.shvnext = nullptr ;
+	var.shvvalue.strptr    = nullptr ;
+	var.shvvalue.strlength = 0 ;
+	var.shvvaluelen        = 0 ;
+	MAKERXSTRING( var.shvname, name.c_str(), name.size() ) ;
+
+	rc = RexxVariablePool( &var ) ;
+	if ( var.shvvalue.strptr )
+	{
+		v = string( var.shvvalue.strptr, var.shvvalue.strlength ) ;
+		RexxFreeMemory( var.shvvalue.strptr ) ;
+	}
+
+	trim( v ) ;
+	if ( rc != RXSHV_OK || !isnumeric( v ) )
+	{
+		return RXSHV_BADN ;
+	}
+
+	n = ds2d( v ) ;
+	if ( n == 0 )
+	{
+		return RXSHV_OK ;
+	}
+
+	names.reserve( n ) ;
+	vars.resize( n ) ;
+
+	for ( i = 0 ; i < n ; ++i )
+	{
+		names.push_back( stem + d2ds( i + 1 ) ) ;
+		vars[ i ].shvnext            = ( i + 1 < n ) ? &vars[ i + 1 ] : nullptr ;
+		vars[ i ].shvcode            = RXSHV_SYFET ;
+		vars[ i ].shvret             = 0 ;
+		vars[ i ].shvvalue.strptr    = nullptr ;     /* let REXX allocate the memory */
+		vars[ i ].shvvalue.strlength = 0 ;
+		vars[ i ].shvvaluelen        = 0 ;
+		MAKERXSTRING( vars[ i ].shvname, names[ i ].c_str(), names[ i ].size() ) ;
+	}
+
+	rc = RexxVariablePool( &vars[ 0 ] ) & ~( RXSHV_NEWV | RXSHV_LVAR ) ;
+
+	lines.reserve( n ) ;
+	for ( i = 0 ; i < n ; ++i )
+	{
+		if ( vars[ i ].shvvalue.strptr )
+		{
+			if ( rc == RXSHV_OK )
+			{
+				lines.push_back( string( vars[ i ].shvvalue.strptr, vars[ i ].shvvalue.strlength ) ) ;
+			}
+			RexxFreeMemory( vars[ i ].shvvalue.strptr ) ;
+		}
+	}
+
+	return rc ;
+}
+
+
+int setRexxStem( const string& stem,
+		 const vector<string>& lines )
+{
+	//
+	// Set stem.1 to stem.n in the Rexx variable pool and stem.0 to n, in one call to the pool.
+	//
+	// Return RXSHV_OK if all variables have been set.
+	//
+
+	TRACE_FUNCTION() ;
+
+	size_t i ;
+	size_t n = lines.size() + 1 ;
+
+	string count = d2ds( lines.size() ) ;
+
+	vector<string> names ;
+	vector<SHVBLOCK> vars( n ) ;
+
+	names.reserve( n ) ;
+
+	for ( i = 0 ; i < n ; ++i )
+	{
+		const string& v = ( i == 0 ) ? count : lines[ i - 1 ] ;
+		names.push_back( stem + d2ds( i ) ) ;
+		vars[ i ].shvnext = ( i + 1 < n ) ? &vars[ i + 1 ] : nullptr ;
+		vars[ i ].shvcode = RXSHV_SYSET ;
+		vars[ i ].shvret  = 0 ;
+		MAKERXSTRING( vars[ i ].shvname, names[ i ].c_str(), names[ i ].size() ) ;
+		MAKERXSTRING( vars[ i ].shvvalue, (char*)v.c_str(), v.size() ) ;
+		vars[ i ].shvvaluelen = v.size() ;
+	}
+
+	return RexxVariablePool( &vars[ 0 ] ) & ~( RXSHV_NEWV | RXSHV_LVAR ) ;
+}
+
+
 bool is_pgmmacro( miblock* mibptr )
 {
 	//
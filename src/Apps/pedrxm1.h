@@ -39,5 +39,11 @@ class pedrxm1 : public TSOENV
 	friend RexxObjectPtr RexxEntry editServiceHandler( RexxExitContext*,
 							   RexxStringObject,
 							   RexxStringObject ) ;
+	friend int editStemLines( miblock*,
+				  const string&,
+				  const string&,
+				  const string&,
+				  const string&,
+				  const string& ) ;
 	friend bool is_pgmmacro( miblock* ) ;
 } ;
@@ -57,10 +57,15 @@
 #include <boost/regex.hpp>
 #include <boost/circular_buffer.hpp>
 #include <vector>
+#include <unordered_set>
 
 #include <sys/sysmacros.h>
 #include <sys/stat.h>
-#include <utime.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
 #include <sys/xattr.h>
 #include <pwd.h>
 #include <grp.h>
@@ -77,6 +82,8 @@ using namespace std ;
 using namespace boost ;
 using namespace boost::filesystem ;
 
+dir_cache pflst0a::Global_dir_cache ;
+
 LSPF_APP_MAKER( pflst0a )
 
 
@@ -109,6 +116,8 @@ pflst0a::pflst0a()
 	rebuild2  = false ;
 	include   = true  ;
 	initsort  = true  ;
+	showacc   = false ;
+	filters_ok = false ;
 	log_error = "OFF" ;
 	sort_parm = "(ENTRY,C,A)" ;
 }
@@ -285,11 +294,17 @@ void pflst0a::application()
 		if ( zverb == "LEFT" && ppos > 0 )
 		{
 			--ppos ;
+			showacc = false ;
 			continue ;
 		}
 		else if ( zverb == "RIGHT" && ppos < 5 )
 		{
 			++ppos ;
+			if ( ppos == 5 )
+			{
+				showacc  = true ;
+				rebuild1 = true ;
+			}
 			continue ;
 		}
 		if ( RCode == 4 )
@@ -993,6 +1008,28 @@ void pflst0a::actionLineCommand( const string& entry1,
 		break ;
 
 	case LN_TREE:
+		RC = 0 ;
+		if ( !is_directory( entry1, ec ) )
+		{
+			msg = "FLST012K" ;
+			tbput( dslist ) ;
+			break ;
+		}
+		control( "ERRORS", "RETURN" ) ;
+		control( "DISPLAY", "SAVE" ) ;
+		set_scrname( "BROWSE" ) ;
+		browseTree( entry1 ) ;
+		control( "DISPLAY", "RESTORE" ) ;
+		if ( RC > 0 )
+		{
+			msg     = "FLST012H" ;
+			message = rsn ;
+			tbput( dslist ) ;
+		}
+		control( "ERRORS", "CANCEL" ) ;
+		restore_scrname() ;
+		break ;
+
 	case LN_TTREE:
 		RC = 0 ;
 		string tname = get_tempname() ;
@@ -1030,10 +1067,6 @@ void pflst0a::actionLineCommand( const string& entry1,
 			{
 				of << copies( "|   ", dIt.depth()) << "|-- " ;
 				of << current.filename().string() << endl ;
-				if ( it->second == LN_TREE )
-				{
-					of << current.string() << endl ;
-				}
 			}
 			dIt.increment( ec ) ;
 			if ( ec )
@@ -1045,7 +1078,7 @@ void pflst0a::actionLineCommand( const string& entry1,
 		control( "ERRORS", "RETURN" ) ;
 		control( "DISPLAY", "SAVE" ) ;
 		set_scrname( "BROWSE" ) ;
-		( it->second == LN_TREE ) ? browseTree( tname ) : browse( tname ) ;
+		browse( tname ) ;
 		control( "DISPLAY", "RESTORE" ) ;
 		if ( RC > 0 )
 		{
@@ -1064,15 +1097,27 @@ void pflst0a::actionLineCommand( const string& entry1,
 
 void pflst0a::create_filelist1( bool keepMessages )
 {
+	//
+	// Entries are filtered on name first.  If stats are required, the remaining entries are
+	// lstat'ed in parallel before the rows are added to the table.
+	//
+	// Cached lstat results are not used when access dates are shown or sorted on, as access times
+	// are not watched.
+	//
+
 	bool hide ;
 	bool match ;
+	bool uncached ;
 
+	size_t i  ;
 	size_t p1 ;
 
 	string entry1 ;
 
 	map<string, string> messages ;
 
+	const size_t min_chunk = 256 ;
+
 	if ( keepMessages )
 	{
 		control( "ERRORS", "RETURN" ) ;
@@ -1098,6 +1143,12 @@ void pflst0a::create_filelist1( bool keepMessages )
 
 	vector<path> v ;
 
+	vector<string> paths ;
+	vector<string> entries ;
+
+	vector<struct stat> stv ;
+	vector<char> stok ;
+
 	sel     = "" ;
 	message = "" ;
 	ztdsels = 0  ;
@@ -1105,6 +1156,10 @@ void pflst0a::create_filelist1( bool keepMessages )
 	affull  = ( afsfull  == "/" ) ;
 	hide    = ( afhidden != "/" ) ;
 
+	uncached = showacc || sort_parm.compare( 0, 10, "(ACCDATES," ) == 0 ;
+
+	Global_dir_cache.refresh() ;
+
 	load_path_vector( v ) ;
 
 	auto itp = find( pnames.begin(), pnames.end(), zpath ) ;
@@ -1123,7 +1178,6 @@ void pflst0a::create_filelist1( bool keepMessages )
 			msg = "FLST013E" ;
 			break ;
 		}
-		tbvclear( dslist ) ;
 		entry = p.string() ;
 		p1    = ( recursv ) ? zpath.size() : entry.find_last_of( '/' ) + 1 ;
 		entry.erase( 0, p1 ) ;
@@ -1132,11 +1186,7 @@ void pflst0a::create_filelist1( bool keepMessages )
 		{
 			continue ;
 		}
-		match = match_filter_i( ( useList || affull ) ? p.string() : entry ) ;
-		if ( match_filter_x( ( useList || affull ) ? p.string() : entry ) )
-		{
-			match = false ;
-		}
+		match = match_filters( ( useList || affull ) ? p.string() : entry ) ;
 		if ( !excludeList.empty() )
 		{
 			if ( excludeList.find( entry1 ) != excludeList.end() )
@@ -1149,16 +1199,53 @@ void pflst0a::create_filelist1( bool keepMessages )
 		{
 			continue ;
 		}
-		if ( stats && lstat( p.string().c_str(), &results ) == 0 )
-		{
-			getFileAttributes() ;
-			getFilePermissions() ;
-		}
+		paths.push_back( p.string() ) ;
+		entries.push_back( ( affull ) ? p.string() : entry1 ) ;
+	}
+
+	if ( stats )
+	{
+		stv.resize( paths.size() ) ;
+		stok.resize( paths.size() ) ;
+		parallel_ranges( paths.size(), min_chunk,
+			[ &paths, &stv, &stok, uncached ]( size_t b, size_t e, uint c )
+			{
+				size_t p ;
+				string d ;
+				string n ;
+				for ( ; b < e ; ++b )
+				{
+					p = paths[ b ].find_last_of( '/' ) + 1 ;
+					d = paths[ b ].substr( 0, p ) ;
+					n = paths[ b ].substr( p ) ;
+					if ( !uncached && Global_dir_cache.get_stat( d, n, stv[ b ] ) )
+					{
+						stok[ b ] = true ;
+						continue ;
+					}
+					stok[ b ] = ( lstat( paths[ b ].c_str(), &stv[ b ] ) == 0 ) ;
+					if ( stok[ b ] )
+					{
+						Global_dir_cache.put_stat( d, n, stv[ b ] ) ;
+					}
+				}
+			} ) ;
+	}
+
+	for ( i = 0 ; i < paths.size() ; ++i )
+	{
+		tbvclear( dslist ) ;
 		if ( stats )
 		{
+			if ( stok[ i ] )
+			{
+				results = stv[ i ] ;
+				getFileAttributes() ;
+				getFilePermissions() ;
+			}
 			getFileUIDGID() ;
 		}
-		entry = ( affull ) ? p.string() : entry1 ;
+		entry = entries[ i ] ;
 		if ( keepMessages )
 		{
 			auto it = messages.find( entry ) ;
@@ -1167,7 +1254,7 @@ void pflst0a::create_filelist1( bool keepMessages )
 				vreplace( "MESSAGE", it->second ) ;
 			}
 		}
-		tbadd( dslist ) ;
+		tbadd( dslist, "", "", min( paths.size(), size_t( 65535 ) ) ) ;
 	}
 
 	if ( initsort )
@@ -1191,11 +1278,7 @@ void pflst0a::updateFileList1()
 	while ( RC == 0 )
 	{
 		entry1 = ( useList || affull ) ? entry : full_name( zpath, entry ) ;
-		match  = match_filter_i( ( useList || affull ) ? entry1 : entry ) ;
-		if ( match_filter_x( ( useList || affull ) ? entry1 : entry ) )
-		{
-			match = false ;
-		}
+		match  = match_filters( ( useList || affull ) ? entry1 : entry ) ;
 		if ( !search.empty() )
 		{
 			if ( searchList.find( entry1 ) == searchList.end() )
@@ -1254,7 +1337,7 @@ void pflst0a::load_path_vector( vector<path>& v )
 
 	map<int, regex> nodes_filter ;
 
-	vector<string> results ;
+	subProcess proc ;
 
 	regex expression ;
 
@@ -1349,25 +1432,40 @@ void pflst0a::load_path_vector( vector<path>& v )
 			affull = true ;
 			return ;
 		}
-		cmd = w1 + " " + subword( tpath, 2 ) + " 2>&1" ;
-		execute_cmd( rc, cmd, results ) ;
-		for ( auto& t : results )
+		cmd = w1 + " " + subword( tpath, 2 ) ;
+		if ( !proc.start( cmd ) )
 		{
-			if ( t.size() > 0 && t.front() == '/' )
-			{
-				v.push_back( t ) ;
-			}
-			else if ( t.size() > 1 && t.compare( 0, 2, "./" ) == 0 )
+			llog( "E", "Command " << cmd << " could not be started.  " << strerror( proc.error() ) << endl ) ;
+			setmsg( "FLST013I" ) ;
+			return ;
+		}
+		interrupted = false ;
+		proc.run( [ &v, &wd, &mtext ]( const string& t, bool e )
 			{
-				v.push_back( wd.string() + t.substr( 1 ) ) ;
-			}
-			else if ( rc != 0 && mtext == "" )
+				if ( !e && t.size() > 0 && t.front() == '/' )
+				{
+					v.push_back( t ) ;
+				}
+				else if ( !e && t.size() > 1 && t.compare( 0, 2, "./" ) == 0 )
+				{
+					v.push_back( wd.string() + t.substr( 1 ) ) ;
+				}
+				else if ( mtext == "" )
+				{
+					mtext = "(" + t + ")." ;
+				}
+				return true ;
+			}, 0, [ this ]()
 			{
-				mtext = "(" + t + ")." ;
-			}
-		}
+				return interrupted ;
+			} ) ;
+		rc = proc.status() ;
 		affull = true ;
-		if ( rc != 0 )
+		if ( interrupted )
+		{
+			setmsg( "FLST013E" ) ;
+		}
+		else if ( rc != 0 )
 		{
 			vreplace( "ZVAL1", mtext ) ;
 			msg = "FLST012Z" ;
@@ -1576,37 +1674,145 @@ void pflst0a::load_path_vector( vector<path>& v )
 			return ;
 		}
 		zpath = full_dir( zpath ) ;
-		if ( recursv )
+		read_directory( zpath, recursv, v ) ;
+	}
+	catch ( const filesystem_error& ex )
+	{
+		log_filesystem_error( ex ) ;
+		msg = "FLST012X" ;
+	}
+}
+
+
+void pflst0a::read_directory( const string& dir,
+			      bool recurse,
+			      vector<path>& v )
+{
+	//
+	// Add the entries of directory dir to v.  If recurse is true, sub-directories (but not symbolic
+	// links to directories) are also read, one level at a time with the directories of each level
+	// spread over several threads.
+	//
+
+	uint c ;
+	uint chunks ;
+
+	vector<string> level( 1, dir ) ;
+	vector<string> next ;
+
+	interrupted = false ;
+	while ( !level.empty() )
+	{
+		if ( interrupted )
 		{
-			recursive_directory_iterator dIt( zpath, ec ) ;
-			recursive_directory_iterator eIt ;
-			interrupted = false ;
-			while ( dIt != eIt )
+			msg = "FLST013E" ;
+			break ;
+		}
+		chunks = parallel_chunks( level.size(), 1 ) ;
+		vector<vector<string>> ents( chunks ) ;
+		vector<vector<string>> dirs( chunks ) ;
+		vector<vector<string>> errs( chunks ) ;
+		parallel_ranges( level.size(), 1,
+			[ this, &level, &ents, &dirs, &errs, recurse ]( size_t b, size_t e, uint c )
 			{
-				if ( interrupted )
+				for ( ; b < e && !interrupted ; ++b )
 				{
-					msg = "FLST013E" ;
-					break ;
+					read_dents( level[ b ], ents[ c ], ( recurse ) ? &dirs[ c ] : nullptr, errs[ c ] ) ;
 				}
-				path curr( *dIt ) ;
-				v.push_back( curr.string() ) ;
-				dIt.increment( ec ) ;
-				if ( ec )
+			} ) ;
+		next.clear() ;
+		for ( c = 0 ; c < chunks ; ++c )
+		{
+			v.insert( v.end(), ents[ c ].begin(), ents[ c ].end() ) ;
+			next.insert( next.end(), dirs[ c ].begin(), dirs[ c ].end() ) ;
+			for ( const auto& p : errs[ c ] )
+			{
+				log_filesystem_error( p ) ;
+				msg = "FLST012X" ;
+			}
+		}
+		level.swap( next ) ;
+	}
+}
+
+
+void pflst0a::read_dents( const string& dir,
+			  vector<string>& ents,
+			  vector<string>* dirs,
+			  vector<string>& errs )
+{
+	//
+	// Read directory dir with getdents64 into a large buffer so big directories need few system calls.
+	// If dirs is not null, sub-directories are added to it using the type returned in the directory
+	// entry (lstat is only needed if the file system does not return a type).
+	//
+	// The names are taken from the directory cache if the directory has not changed since it was
+	// last read.  The watch is added before reading so no change can be missed.
+	//
+	// Runs on a worker thread so must not update the application.
+	//
+
+	int fd ;
+
+	long i ;
+	long n ;
+
+	string p ;
+
+	const string pfx = full_dir( dir ) ;
+
+	struct dirent64* d ;
+	struct stat st ;
+	struct stat dst ;
+
+	vector<pair<string, unsigned char>> names ;
+
+	fd = open( dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ;
+	if ( fd == -1 || fstat( fd, &dst ) != 0 )
+	{
+		if ( fd != -1 ) { close( fd ) ; }
+		errs.push_back( dir ) ;
+		return ;
+	}
+
+	if ( !Global_dir_cache.get_names( pfx, dst, names ) )
+	{
+		Global_dir_cache.watch( pfx ) ;
+		vector<char> buf( 65536 ) ;
+		while ( ( n = syscall( SYS_getdents64, fd, buf.data(), buf.size() ) ) > 0 )
+		{
+			for ( i = 0 ; i < n ; i += d->d_reclen )
+			{
+				d = reinterpret_cast<struct dirent64*>( buf.data() + i ) ;
+				if ( d->d_name[ 0 ] == '.' &&
+				   ( d->d_name[ 1 ] == 0x00 || ( d->d_name[ 1 ] == '.' && d->d_name[ 2 ] == 0x00 ) ) )
 				{
-					log_filesystem_error( ec, curr.string() ) ;
-					msg = "FLST012X" ;
+					continue ;
 				}
+				names.push_back( make_pair( string( d->d_name ), d->d_type ) ) ;
 			}
 		}
+		if ( n < 0 )
+		{
+			errs.push_back( dir ) ;
+		}
 		else
 		{
-			copy( directory_iterator( zpath ), directory_iterator(), back_inserter( v ) ) ;
+			Global_dir_cache.put_names( pfx, dst, names ) ;
 		}
 	}
-	catch ( const filesystem_error& ex )
+
+	close( fd ) ;
+
+	for ( auto& e : names )
 	{
-		log_filesystem_error( ex ) ;
-		msg = "FLST012X" ;
+		p = pfx + e.first ;
+		if ( dirs && ( e.second == DT_DIR ||
+			     ( e.second == DT_UNKNOWN && lstat( p.c_str(), &st ) == 0 && S_ISDIR( st.st_mode ) ) ) )
+		{
+			dirs->push_back( p ) ;
+		}
+		ents.push_back( std::move( p ) ) ;
 	}
 }
 
@@ -1661,134 +1867,66 @@ void pflst0a::add_paths( const string& pth,
 void pflst0a::createSearchList()
 {
 	//
-	// Create a list of files that contain string 'search'.
+	// Create a list of files that contain all the strings in 'search'.
+	//
+	// If the search takes more than half a second, its progress and the latest match are shown
+	// on panel PFLST0AW every half second.
+	// If the search is interrupted, the search strings are cleared so the list is not filtered.
 	//
 
-	int rc ;
-
-	string cmd ;
-
-	bool empty = true ;
+	bool popup = false ;
 
-	string tname = get_tempname() ;
+	string last ;
 
-	vector<string> results ;
+	boost::posix_time::ptime next ;
 
-	std::ofstream of ;
+	vector<string> files ;
 
 	searchList.clear() ;
 
 	tbtop( dslist ) ;
 	tbskip( dslist ) ;
 
-	of.open( tname ) ;
-
 	while ( RC == 0 )
 	{
-		if ( !useList && !affull )
-		{
-			entry = full_name( zpath, entry ) ;
-		}
-		try
-		{
-			if ( !is_regular_file( entry ) )
-			{
-				tbskip( dslist ) ;
-				continue ;
-			}
-		}
-		catch ( const filesystem_error& ex )
-		{
-			tbskip( dslist ) ;
-			continue ;
-		}
-		of << " \"" + entry + "\"" << endl ;
+		files.push_back( ( !useList && !affull ) ? full_name( zpath, entry ) : entry ) ;
 		tbskip( dslist ) ;
-		empty = false ;
-	}
-
-	of.close() ;
-
-	if ( empty )
-	{
-		tbtop( dslist ) ;
-		tbskip( dslist, ztdtop ) ;
-		return ;
 	}
 
-	cmd = "xargs grep -i -l -s -F -e \"" + search[ 0 ] + "\" < " + tname + " 2>&1" ;
-	execute_cmd( rc, cmd, results ) ;
-	load_searchList( results ) ;
-
-	for ( uint i = 1 ; i < search.size() ; ++i )
+	if ( !files.empty() )
 	{
-		empty = true ;
-		of.open( tname ) ;
-		for ( auto it = searchList.begin() ; it != searchList.end() ; ++it )
+		file_search fs( search ) ;
+		interrupted = false ;
+		next = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds( 500 ) ;
+		fs.run( files, [ this, &last ]( const string& f )
+			{
+				searchList.insert( f ) ;
+				last = f ;
+				return !interrupted ;
+			},
+			[ this, &files, &last, &next, &popup ]( size_t n )
+			{
+				if ( !interrupted && boost::posix_time::microsec_clock::universal_time() >= next )
+				{
+					search_progress( n, files.size(), last, popup ) ;
+					next = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds( 500 ) ;
+				}
+				return !interrupted ;
+			} ) ;
+		if ( popup )
 		{
-			of << " \"" << *it << "\"" << endl ;
-			empty = false ;
+			rempop() ;
 		}
-		of.close() ;
-		if ( empty ) { break ; }
-		cmd = "xargs grep -i -l -s -F -e \"" + search[ i ] + "\" < " + tname + " 2>&1" ;
-		execute_cmd( rc, cmd, results ) ;
-		load_searchList( results ) ;
-	}
-
-	remove( tname ) ;
-
-	tbtop( dslist ) ;
-	tbskip( dslist, ztdtop ) ;
-}
-
-
-void pflst0a::execute_cmd( int& rc,
-			   const string& cmd,
-			   vector<string>& results )
-{
-	string line ;
-
-	char buffer[ 8192 ] ;
-
-	results.clear() ;
-
-	FILE* pipe { popen( cmd.c_str(), "r" ) } ;
-
-	if ( !pipe )
-	{
-		llog( "E", "POPEN failed.  Command string size="<< cmd.size() << endl ) ;
-		setmsg( "FLST013I" ) ;
-		return ;
-	}
-
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
-	{
-		line = buffer ;
-		if ( line != "" )
+		if ( interrupted )
 		{
-			if ( line.back() == 0x0a )
-			{
-				line.pop_back() ;
-			}
-			results.push_back( line ) ;
+			clear_search() ;
+			searchList.clear() ;
+			msg = "FLST013E" ;
 		}
 	}
 
-	rc = WEXITSTATUS( pclose( pipe ) ) ;
-}
-
-
-void pflst0a::load_searchList( vector<string>& results )
-{
-	searchList.clear() ;
-
-	for ( auto& r : results )
-	{
-		searchList.insert( r ) ;
-	}
-
-	results.clear() ;
+	tbtop( dslist ) ;
+	tbskip( dslist, ztdtop ) ;
 }
 
 
@@ -1976,6 +2114,11 @@ int pflst0a::action_Sort()
 	initsort  = true ;
 	sort_parm = "(" + w2 + "," + numchar + "," + w3 + ")" ;
 
+	if ( w2 == "ACCDATES" && !showacc )
+	{
+		rebuild1 = true ;
+	}
+
 	tbsort( dslist, sort_parm ) ;
 
 	return 4 ;
@@ -2578,6 +2721,7 @@ int pflst0a::action_Reset()
 				filter_i_regex.erase( it ) ;
 			}
 			filter_i.pop_back() ;
+			filters_ok = false ;
 			create_filelist1() ;
 		}
 		else if ( !filter_i.empty() )
@@ -2598,6 +2742,7 @@ int pflst0a::action_Reset()
 				filter_x_regex.erase( it ) ;
 			}
 			filter_x.pop_back() ;
+			filters_ok = false ;
 			create_filelist1() ;
 		}
 		else if ( !filter_x.empty() )
@@ -3260,10 +3405,23 @@ int pflst0a::action_Block_Rename( const string& entry1 )
 void pflst0a::delete_entry( const string& entry1,
 			    bool& terminat )
 {
+	//
+	// Non-empty directories are deleted in parallel by a tree_op, showing progress on panel PFLST0AV.
+	// If the application is interrupted, the entries already deleted stay deleted.
+	//
+
 	int num ;
 
 	bool del ;
 	bool delokay = false ;
+	bool popup   = false ;
+
+	uint64_t n ;
+	uint64_t b ;
+
+	string last ;
+
+	struct stat st ;
 
 	string zcmd1   ;
 	string confoff ;
@@ -3295,7 +3453,47 @@ void pflst0a::delete_entry( const string& entry1,
 	if ( del )
 	{
 		vcopy( "NEMPTOK", nemptok, MOVE ) ;
-		if ( nemptok == "/" )
+		if ( nemptok == "/" && lstat( entry1.c_str(), &st ) == 0 && S_ISDIR( st.st_mode ) )
+		{
+			tree_op op ;
+			interrupted = false ;
+			op.remove( entry1, [ this, &op, &popup ]()
+				{
+					return tree_progress( op, "Delete", popup ) ;
+				} ) ;
+			if ( popup )
+			{
+				rempop() ;
+			}
+			op.status( n, b, last ) ;
+			for ( const auto& e : op.errors )
+			{
+				llog( "E", e << endl ) ;
+			}
+			if ( interrupted )
+			{
+				rsn      = to_string( n ) + " file(s) deleted" ;
+				message  = "Interrupted (SIGUSR1)" ;
+				setmsg( "FLST013E" ) ;
+				terminat = true ;
+			}
+			else if ( op.errors.empty() )
+			{
+				delokay = true ;
+				rsn     = to_string( n ) + " file(s) deleted" ;
+				setmsg( "FLST011N" ) ;
+				tbdelete( dslist ) ;
+			}
+			else
+			{
+				msg     = "FLST011O" ;
+				rsn     = op.errors.front() ;
+				message = "Errors" ;
+				llog( "E", "Delete of "+ entry1 +" failed."<< endl ) ;
+				llog( "E", n << " file(s) deleted "<< endl ) ;
+			}
+		}
+		else if ( nemptok == "/" )
 		{
 			num = remove_all( entry1.c_str(), ec ) ;
 			if ( ec.value() == boost::system::errc::success )
@@ -4119,24 +4317,49 @@ void pflst0a::modify_entry( const string& p,
 
 void pflst0a::getFileAttributes()
 {
-	char buf[ 20 ] ;
-
-	struct tm* time_info ;
-
 	size      = to_string( results.st_size ) ;
 	moddates  = to_string( results.st_mtime ) ;
 	accdates  = to_string( results.st_atime ) ;
 	stcdates  = to_string( results.st_ctime ) ;
 
-	time_info = gmtime( &(results.st_mtime) ) ;
-	strftime( buf, sizeof(buf), "%d/%m/%Y %H:%M:%S", time_info ) ;
-	moddate   = buf ;
-	time_info = gmtime( &(results.st_atime) ) ;
-	strftime( buf, sizeof(buf), "%d/%m/%Y %H:%M:%S", time_info ) ;
-	accdate   = buf ;
-	time_info = gmtime( &(results.st_ctime) ) ;
-	strftime( buf, sizeof(buf), "%d/%m/%Y %H:%M:%S", time_info ) ;
-	stcdate   = buf ;
+	moddate   = format_time( results.st_mtime ) ;
+	accdate   = format_time( results.st_atime ) ;
+	stcdate   = format_time( results.st_ctime ) ;
+}
+
+
+string pflst0a::format_time( time_t t )
+{
+	//
+	// Return t as dd/mm/yyyy hh:mm:ss (UTC).
+	// The date part is kept per day as most entries in a list share a small number of days.
+	//
+
+	char buf[ 20 ] ;
+
+	struct tm time_info ;
+
+	time_t day = t / 86400 ;
+	time_t sec = t % 86400 ;
+
+	if ( t < 0 )
+	{
+		gmtime_r( &t, &time_info ) ;
+		strftime( buf, sizeof( buf ), "%d/%m/%Y %H:%M:%S", &time_info ) ;
+		return buf ;
+	}
+
+	auto it = date_cache.find( day ) ;
+	if ( it == date_cache.end() )
+	{
+		gmtime_r( &t, &time_info ) ;
+		strftime( buf, sizeof( buf ), "%d/%m/%Y ", &time_info ) ;
+		it = date_cache.insert( make_pair( day, string( buf ) ) ).first ;
+	}
+
+	snprintf( buf, sizeof( buf ), "%02d:%02d:%02d", int( sec / 3600 ), int( sec / 60 % 60 ), int( sec % 60 ) ) ;
+
+	return it->second + buf ;
 }
 
 
@@ -4170,20 +4393,26 @@ void pflst0a::getFilePermissions()
 
 void pflst0a::getFileUIDGID()
 {
-	owner = "" ;
-	group = "" ;
+	//
+	// User and group names are kept as getpwuid/getgrgid can be slow (eg. with a remote directory service).
+	//
 
-	struct passwd* pw = getpwuid( results.st_uid ) ;
-	if ( pw )
+	auto itu = owner_cache.find( results.st_uid ) ;
+	if ( itu == owner_cache.end() )
 	{
-		owner = pw->pw_name ;
+		struct passwd* pw = getpwuid( results.st_uid ) ;
+		itu = owner_cache.insert( make_pair( results.st_uid, string( ( pw ) ? pw->pw_name : "" ) ) ).first ;
 	}
 
-	struct group* gr = getgrgid( results.st_gid ) ;
-	if ( gr )
+	auto itg = group_cache.find( results.st_gid ) ;
+	if ( itg == group_cache.end() )
 	{
-		group = gr->gr_name ;
+		struct group* gr = getgrgid( results.st_gid ) ;
+		itg = group_cache.insert( make_pair( results.st_gid, string( ( gr ) ? gr->gr_name : "" ) ) ).first ;
 	}
+
+	owner = itu->second ;
+	group = itg->second ;
 }
 
 
@@ -4271,66 +4500,55 @@ void pflst0a::list_entry_recursive( const string& entry1,
 }
 
 
-void pflst0a::browseTree( const string& tname )
+void pflst0a::browseTree( const string& dir )
 {
-	int i ;
+	//
+	// Show directory dir as a tree.  Directories are expanded and collapsed with line command X
+	// (or S) and only read when first expanded.  Directory sizes are added up in the background
+	// and the table is rebuilt on the next interaction when more are known.
+	//
+
 	int csrrow ;
 	int crpx   ;
 
+	uint i ;
+
 	bool terminat ;
+	bool rebuild  ;
+
+	size_t sizes ;
 
 	string tsel   ;
 	string tfile  ;
 	string tentry ;
+	string tsize  ;
+	string tidx   ;
 	string panel  ;
 	string cursor ;
 	string tab    ;
-	string line   ;
 	string msgloc ;
 
-	const string vlist1 = "TSEL TFILE TENTRY ZDIR" ;
+	dir_tree tree ;
+
+	const string vlist1 = "TSEL TFILE TENTRY TSIZE TIDX ZDIR" ;
 	const string vlist2 = "CRP" ;
 
-	std::ifstream fin ;
-	fin.open( tname.c_str() ) ;
-	if ( !fin.is_open() )
+	if ( !tree.open( dir, rsn ) )
 	{
-		RC   = 16 ;
-		llog( "E", "Error opening file " << tname << endl ) ;
+		RC = 16 ;
+		llog( "E", "Error reading directory " << dir << ".  " << rsn << endl ) ;
 		return ;
 	}
 
-	vdefine( vlist1, &tsel, &tfile, &tentry, &zdir ) ;
+	vdefine( vlist1, &tsel, &tfile, &tentry, &tsize, &tidx, &zdir ) ;
 	vdefine( vlist2, &crp ) ;
 
-	tab = "FTR" + d2ds( taskid(), 5 ) ;
-
-	tbcreate( tab,
-		  "",
-		  "(TSEL,TFILE,TENTRY)",
-		  NOWRITE ) ;
-
+	tab  = "FTR" + d2ds( taskid(), 5 ) ;
+	zdir = dir ;
 	tsel = "" ;
-	i    = 1  ;
-	while ( getline( fin, line ) )
-	{
-		if ( i == 1 )
-		{
-			zdir = strip( line ) ;
-		}
-		else if ( i % 2 )
-		{
-			tfile = strip( line ) ;
-			tbadd( tab ) ;
-		}
-		else
-		{
-			tentry  = strip( line ) ;
-		}
-		++i ;
 
-	}
-	tbtop( tab ) ;
+	sizes = tree.sizes_known() ;
+	browseTree_build( tab, tree, tfile, tentry, tsize, tidx ) ;
 
 	ztdvrows  = 1 ;
 	ztdsels   = 0 ;
@@ -4340,6 +4558,7 @@ void pflst0a::browseTree( const string& tname )
 	msgloc    = "" ;
 	msg       = "" ;
 	cursor    = "ZCMD" ;
+	rebuild   = false ;
 
 	while ( true )
 	{
@@ -4399,7 +4618,24 @@ void pflst0a::browseTree( const string& tname )
 		msgloc = "" ;
 		crpx   = crp;
 		csrrow = 0  ;
-		if ( tsel == "S" )
+		i      = ( tidx == "" ) ? 0 : ds2d( tidx ) ;
+		if ( tsel == "X" && !tree.entry( i ).dir )
+		{
+			msg = "FLST012K" ;
+		}
+		else if ( tsel == "X" || ( tsel == "S" && tree.entry( i ).dir ) )
+		{
+			if ( tree.entry( i ).expanded )
+			{
+				tree.collapse( i ) ;
+			}
+			else if ( !tree.expand( i, rsn ) )
+			{
+				msg = "FLST012H" ;
+			}
+			rebuild = true ;
+		}
+		else if ( tsel == "S" )
 		{
 			set_scrname( "BROWSE" ) ;
 			control( "ERRORS", "RETURN" ) ;
@@ -4436,6 +4672,12 @@ void pflst0a::browseTree( const string& tname )
 			control( "ERRORS", "CANCEL" ) ;
 			restore_scrname() ;
 		}
+		if ( ztdsels < 2 && ( rebuild || tree.sizes_known() != sizes ) )
+		{
+			sizes   = tree.sizes_known() ;
+			rebuild = false ;
+			browseTree_build( tab, tree, tfile, tentry, tsize, tidx ) ;
+		}
 	}
 
 	tbend( tab ) ;
@@ -4443,6 +4685,43 @@ void pflst0a::browseTree( const string& tname )
 }
 
 
+void pflst0a::browseTree_build( const string& tab,
+				dir_tree& tree,
+				string& tfile,
+				string& tentry,
+				string& tsize,
+				string& tidx )
+{
+	//
+	// (Re)build the tree table from the entries currently visible.
+	//
+
+	uint64_t sz ;
+
+	vector<uint> v ;
+
+	tree.visible( v ) ;
+
+	tbcreate( tab,
+		  "",
+		  "(TSEL,TFILE,TENTRY,TSIZE,TIDX)",
+		  NOWRITE,
+		  REPLACE ) ;
+
+	for ( auto i : v )
+	{
+		tbvclear( tab ) ;
+		tfile  = tree.entry( i ).path ;
+		tentry = tree.line( i ) ;
+		tsize  = ( tree.get_size( i, sz ) ) ? strip( d2size( sz, 1 ) ) : "..." ;
+		tidx   = d2ds( i ) ;
+		tbadd( tab ) ;
+	}
+
+	tbtop( tab ) ;
+}
+
+
 int pflst0a::editRecovery( const string& zvmode )
 {
 	string msg   ;
@@ -5586,33 +5865,24 @@ void pflst0a::clear_filter_i()
 
 	filter_i.clear() ;
 	filter_i_regex.clear() ;
+	filters_ok = false ;
 }
 
 
 bool pflst0a::match_filter_i( const string& e1 )
 {
 	//
-	// Return false if e1 matches any of the include filters set.
+	// Return false if e1 does not match all the include filters set.
 	//
 
-	for ( uint i = 0 ; i < filter_i.size() ; ++i )
-	{
-		const string& t = filter_i[ i ] ;
-		auto it = filter_i_regex.find( t ) ;
-		if ( it != filter_i_regex.end() )
-		{
-			if ( !regex_match( e1.begin(), e1.end(), it->second ) )
-			{
-				return false ;
-			}
-		}
-		else if ( pos( t, upper( e1 ) ) == 0 )
-		{
-			return false ;
-		}
-	}
+	bool inc ;
+	bool exc ;
 
-	return true ;
+	if ( !filters_ok ) { compile_filters() ; }
+
+	cfilters.classify( e1, inc, exc ) ;
+
+	return inc ;
 }
 
 
@@ -5634,33 +5904,48 @@ void pflst0a::clear_filter_x()
 
 	filter_x.clear() ;
 	filter_x_regex.clear() ;
+	filters_ok = false ;
+}
+
+
+bool pflst0a::match_filters( const string& e1 )
+{
+	//
+	// Return true if e1 matches all the include filters and none of the exclude filters.
+	//
+
+	bool inc ;
+	bool exc ;
+
+	if ( !filters_ok ) { compile_filters() ; }
+
+	cfilters.classify( e1, inc, exc ) ;
+
+	return ( inc && !exc ) ;
 }
 
 
-bool pflst0a::match_filter_x( const string& e1 )
+void pflst0a::compile_filters()
 {
 	//
-	// Return true if e1 matches any of the exclude filters set.
+	// Rebuild the compiled filter set from the include and exclude filters.
 	//
 
-	for ( size_t i = 0 ; i < filter_x.size() ; ++i )
+	cfilters.clear() ;
+
+	for ( const auto& t : filter_i )
+	{
+		auto it = filter_i_regex.find( t ) ;
+		cfilters.add( t, ( it == filter_i_regex.end() ) ? nullptr : &it->second, true ) ;
+	}
+
+	for ( const auto& t : filter_x )
 	{
-		const string& t = filter_x[ i ] ;
 		auto it = filter_x_regex.find( t ) ;
-		if ( it != filter_x_regex.end() )
-		{
-			if ( regex_match( e1.begin(), e1.end(), it->second ) )
-			{
-				return true ;
-			}
-		}
-		else if ( pos( t, upper( e1 ) ) > 0 )
-		{
-			return true ;
-		}
+		cfilters.add( t, ( it == filter_x_regex.end() ) ? nullptr : &it->second, false ) ;
 	}
 
-	return false ;
+	filters_ok = true ;
 }
 
 
@@ -5709,6 +5994,8 @@ void pflst0a::set_filter( const string& str,
 	{
 		filter.push_back( upper( str ) ) ;
 	}
+
+	filters_ok = false ;
 }
 
 
@@ -6111,7 +6398,7 @@ int pflst0a::copy_entry( const string& entry1,
 		{
 			if ( prattrs == "/" )
 			{
-				copy_file_attributes( entry1, entry2 ) ;
+				tree_op::copy_attributes( entry1, entry2 ) ;
 			}
 			setmsg( "FLST011U" ) ;
 			message = "Copied" ;
@@ -6154,12 +6441,16 @@ void pflst0a::copy_directory( const string& src,
 	// frepl     - replace file if it already exists.
 	// prattrs   - copy attributes.
 	//
+	// The copy is done in parallel by a tree_op, showing progress on panel PFLST0AV.
+	// It is stopped if the application is interrupted.
+	//
 
-	string lsrc ;
-	string ldest ;
+	bool popup = false ;
 
 	boost::system::error_code ec ;
 
+	tree_op op( recursive, frepl, prattrs ) ;
+
 	if ( interrupted )
 	{
 		return ;
@@ -6187,180 +6478,103 @@ void pflst0a::copy_directory( const string& src,
 		return ;
 	}
 
+	op.copy( src, dest, [ this, &op, &popup ]()
+		{
+			return tree_progress( op, "Copy", popup ) ;
+		} ) ;
 
-	for ( directory_iterator file( src, ec ) ; file != directory_iterator() ; ++file )
+	if ( popup )
 	{
-		if ( interrupted )
-		{
-			setmsg( "FLST013E" ) ;
-			break ;
-		}
-		if ( ec.value() != boost::system::errc::success )
-		{
-			errs = true ;
-			llog( "E", "Listing directory " << src << " failed." << endl ) ;
-			llog( "E", ec.message() << endl ) ;
-			return ;
-		}
-		path current( file->path() ) ;
-		lsrc  = current.string() ;
-		ldest = dest + "/" + current.filename().string() ;
-		if ( is_directory( current ) )
-		{
-			if ( recursive )
-			{
-				copy_directory( lsrc,
-						ldest,
-						recursive,
-						frepl,
-						prattrs,
-						skipped,
-						errs ) ;
-			}
-			else
-			{
-				if ( !exists( ldest ) )
-				{
-					create_directory( ldest, lsrc, ec ) ;
-					if ( ec.value() != boost::system::errc::success )
-					{
-						errs = true ;
-						llog( "E", "Copy of directory " << current.filename() <<
-							   " failed." << endl ) ;
-						llog( "E", ec.message() << endl ) ;
-					}
-				}
-				if ( prattrs )
-				{
-					copy_file_attributes( lsrc, ldest ) ;
-				}
-			}
-			continue ;
-		}
-		if ( !frepl && exists( ldest ) )
-		{
-			skipped = true ;
-			continue ;
-		}
-		if ( is_regular_file( current ) )
-		{
-			copy_file( lsrc, ldest, copy_options::overwrite_existing, ec ) ;
-			if ( ec.value() != boost::system::errc::success )
-			{
-				errs = true ;
-				llog( "E", "Copy of file " << current.filename() << " failed." << endl ) ;
-				llog( "E", ec.message() << endl ) ;
-			}
-			else if ( prattrs )
-			{
-				copy_file_attributes( lsrc, ldest ) ;
-			}
-		}
-		else if ( is_symlink( current ) )
-		{
-			copy_symlink( lsrc, ldest, ec ) ;
-			if ( ec.value() != boost::system::errc::success )
-			{
-				errs = true ;
-				llog( "E", "Copy of symlink " << current.filename() << " failed." << endl ) ;
-				llog( "E", ec.message() << endl ) ;
-			}
-			else if ( prattrs )
-			{
-				copy_file_attributes( lsrc, ldest ) ;
-			}
-		}
-		else
-		{
-			errs = true ;
-			llog( "E", "Ignoring entry " << current.filename() << endl ) ;
-			llog( "E", "Not a regular file, directory or symlink" << endl ) ;
-		}
+		rempop() ;
+	}
+
+	for ( const auto& e : op.errors )
+	{
+		llog( "E", e << endl ) ;
 	}
 
-	if ( prattrs )
+	if ( !op.errors.empty() )
 	{
-		copy_file_attributes( src, dest ) ;
+		errs = true ;
+	}
+
+	if ( op.skipped )
+	{
+		skipped = true ;
 	}
 }
 
 
-void pflst0a::copy_file_attributes( const string& file1,
-				    const string& file2 )
+bool pflst0a::tree_progress( tree_op& op,
+			     const string& oper,
+			     bool& popup )
 {
 	//
-	// Copy mode, ownership, timestamps and xattr from file1 to file2.
+	// Show the progress of a tree copy or delete on panel PFLST0AV.
+	// Return false to stop the operation if the application has been interrupted.
 	//
 
-	ssize_t buflen ;
-	ssize_t vallen ;
-	ssize_t keylen ;
+	uint64_t n ;
+	uint64_t b ;
 
-	int flags = 0 ;
+	string toper ;
+	string tentry ;
+	string tentries ;
+	string tbytes ;
 
-	char* buf ;
-	char* key ;
-	char* val ;
+	const string vlist = "TOPER TENTRY TENTRIES TBYTES" ;
 
-	const char* fl1 = file1.c_str() ;
-	const char* fl2 = file2.c_str() ;
+	op.status( n, b, tentry ) ;
 
-	struct utimbuf newtime ;
+	toper    = oper ;
+	tentries = to_string( n ) ;
+	tbytes   = d2size( b ) ;
 
-	struct passwd* pwd ;
-	struct group*  grp ;
+	if ( !popup )
+	{
+		addpop( "", 5, 5 ) ;
+		popup = true ;
+	}
 
-	struct stat fl1_stats ;
+	vdefine( vlist, &toper, &tentry, &tentries, &tbytes ) ;
+	control( "DISPLAY", "LOCK" ) ;
+	display( "PFLST0AV" ) ;
+	vdelete( vlist ) ;
 
-	uid_t uid ;
-	gid_t gid ;
+	return !interrupted ;
+}
 
-	if ( lstat( fl1, &fl1_stats ) == 0 )
-	{
-		newtime.modtime = fl1_stats.st_mtime;
-		newtime.actime  = fl1_stats.st_atime;
-		utime( fl2, &newtime ) ;
-		pwd = getpwuid( fl1_stats.st_uid ) ;
-		if ( pwd )
-		{
-			uid = pwd->pw_uid ;
-			chown( fl2, uid, -1 ) ;
-		}
-		grp = getgrgid( fl1_stats.st_gid ) ;
-		if ( grp )
-		{
-			gid = grp->gr_gid ;
-			chown( fl2, -1, gid ) ;
-		}
-		chmod( fl2, fl1_stats.st_mode ) ;
-	}
 
+void pflst0a::search_progress( size_t n,
+				size_t total,
+				const string& last,
+				bool& popup )
+{
+	//
+	// Show the progress of a file search on panel PFLST0AW.
+	// n files of total have been started, and last is the most recent match.
+	//
+
+	string tfiles ;
+	string tfound ;
+	string tentry ;
+
+	const string vlist = "TFILES TFOUND TENTRY" ;
 
-	buflen = listxattr( fl1, nullptr, 0 ) ;
-	if ( buflen > 0 )
+	tfiles = to_string( n ) + " of " + to_string( total ) ;
+	tfound = to_string( searchList.size() ) ;
+	tentry = last ;
+
+	if ( !popup )
 	{
-		buf    = new char[ buflen ] ;
-		key    = buf ;
-		buflen = listxattr( fl1, key, buflen ) ;
-		while ( buflen > 0 )
-		{
-			vallen = getxattr( fl1, key, nullptr, 0 ) ;
-			if ( vallen >= 0 )
-			{
-				val    = new char[ vallen ] ;
-				vallen = getxattr( fl1, key, val, vallen ) ;
-				if ( vallen >= 0 )
-				{
-					setxattr( fl2, key, val, vallen, flags ) ;
-				}
-				delete[] val ;
-			}
-			keylen = strlen( key ) + 1 ;
-			key    = key + keylen ;
-			buflen = buflen - keylen ;
-		}
-		delete[] buf ;
+		addpop( "", 5, 5 ) ;
+		popup = true ;
 	}
+
+	vdefine( vlist, &tfiles, &tfound, &tentry ) ;
+	control( "DISPLAY", "LOCK" ) ;
+	display( "PFLST0AW" ) ;
+	vdelete( vlist ) ;
 }
 
 
@@ -6723,3 +6937,1985 @@ string pflst0a::qstring1( int& rc,
 
 	return r ;
 }
+
+
+/**************************************************************************************************************/
+/**********************************              FILE SEARCH              *************************************/
+/**************************************************************************************************************/
+
+file_search::file_search( const vector<string>& words )
+{
+	//
+	// Build the automaton.  State 0 is the root.  outputs[ s ] lists the words that end at
+	// state s, including those ending at its failure states.
+	//
+
+	uint i ;
+	uint s ;
+	uint t ;
+	uint f ;
+
+	const uint none = UINT_MAX ;
+
+	vector<uint> fail ;
+
+	std::deque<uint> q ;
+
+	for ( i = 0 ; i < 256 ; ++i )
+	{
+		fold[ i ] = ( i < 128 ) ? tolower( i ) : i ;
+	}
+
+	nwords = words.size() ;
+
+	delta.assign( 256, none ) ;
+	outputs.resize( 1 ) ;
+
+	for ( i = 0 ; i < nwords ; ++i )
+	{
+		s = 0 ;
+		for ( unsigned char c : words[ i ] )
+		{
+			c = fold[ c ] ;
+			if ( delta[ s * 256 + c ] == none )
+			{
+				delta[ s * 256 + c ] = outputs.size() ;
+				delta.resize( delta.size() + 256, none ) ;
+				outputs.resize( outputs.size() + 1 ) ;
+			}
+			s = delta[ s * 256 + c ] ;
+		}
+		outputs[ s ].push_back( i ) ;
+	}
+
+	fail.assign( outputs.size(), 0 ) ;
+
+	for ( i = 0 ; i < 256 ; ++i )
+	{
+		t = delta[ i ] ;
+		if ( t == none )
+		{
+			delta[ i ] = 0 ;
+		}
+		else
+		{
+			q.push_back( t ) ;
+		}
+	}
+
+	while ( !q.empty() )
+	{
+		s = q.front() ;
+		q.pop_front() ;
+		outputs[ s ].insert( outputs[ s ].end(), outputs[ fail[ s ] ].begin(), outputs[ fail[ s ] ].end() ) ;
+		for ( i = 0 ; i < 256 ; ++i )
+		{
+			t = delta[ s * 256 + i ] ;
+			f = delta[ fail[ s ] * 256 + i ] ;
+			if ( t == none )
+			{
+				delta[ s * 256 + i ] = f ;
+			}
+			else
+			{
+				fail[ t ] = f ;
+				q.push_back( t ) ;
+			}
+		}
+	}
+}
+
+
+bool file_search::run( const vector<string>& files,
+		       const std::function<bool(const string&)>& f,
+		       const std::function<bool(size_t)>& progress )
+{
+	//
+	// Search files, calling f for each file that matches.  Return false if the search was stopped.
+	// progress is called on each wait with the number of files started, so the search can be
+	// stopped even when nothing is being found.
+	//
+	// Check the pool is idle before taking the results so nothing found by the last task can be missed.
+	//
+
+	bool done    = false ;
+	bool stopped = false ;
+
+	size_t next = 0 ;
+	size_t n ;
+
+	vector<string> batch ;
+
+	for ( uint i = 0 ; i < pool.size() ; ++i )
+	{
+		pool.submit( [ this, &files, &next ]()
+			{
+				size_t j ;
+				while ( !pool.cancelled() )
+				{
+					{
+						boost::lock_guard<boost::mutex> lock( mtx ) ;
+						if ( next >= files.size() ) { return ; }
+						j = next++ ;
+					}
+					if ( search_file( files[ j ] ) )
+					{
+						boost::lock_guard<boost::mutex> lock( mtx ) ;
+						results.push_back( files[ j ] ) ;
+						cond.notify_one() ;
+					}
+				}
+			} ) ;
+	}
+
+	while ( !done )
+	{
+		done = pool.idle() ;
+		{
+			boost::unique_lock<boost::mutex> lock( mtx ) ;
+			if ( !done && results.empty() )
+			{
+				cond.timed_wait( lock, boost::posix_time::milliseconds( 50 ) ) ;
+			}
+			batch.swap( results ) ;
+			n = next ;
+		}
+		for ( const auto& file : batch )
+		{
+			if ( !stopped && !f( file ) )
+			{
+				stopped = true ;
+				pool.cancel() ;
+			}
+		}
+		batch.clear() ;
+		if ( !stopped && !progress( n ) )
+		{
+			stopped = true ;
+			pool.cancel() ;
+		}
+	}
+
+	pool.wait() ;
+
+	return !stopped ;
+}
+
+
+bool file_search::search_file( const string& file )
+{
+	//
+	// Return true if regular file 'file' contains all the words.
+	// Runs on a worker thread.  The file is read 1MB at a time and the cancel flag is checked
+	// after each block.  The file is not mapped as truncating it during the search would raise SIGBUS.
+	//
+	// Anything that is not a regular file is skipped before it is opened, as opening a FIFO would
+	// block the worker.  It is also opened non-blocking and checked again in case it is replaced.
+	//
+
+	int fd ;
+
+	uint s     = 0 ;
+	uint found = 0 ;
+
+	size_t i ;
+	size_t n ;
+
+	ssize_t r ;
+
+	bool first = true ;
+
+	const size_t block = 1048576 ;
+
+	struct stat st ;
+
+	vector<char> seen( nwords, 0 ) ;
+
+	vector<unsigned char> buf ;
+
+	if ( nwords == 0 ) { return true ; }
+
+	if ( stat( file.c_str(), &st ) != 0 || !S_ISREG( st.st_mode ) ) { return false ; }
+
+	fd = open( file.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC ) ;
+	if ( fd == -1 ) { return false ; }
+
+	if ( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) || st.st_size == 0 )
+	{
+		close( fd ) ;
+		return false ;
+	}
+
+	posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL ) ;
+
+	buf.resize( min( size_t( st.st_size ), block ) ) ;
+
+	while ( found < nwords && !pool.cancelled() )
+	{
+		for ( n = 0 ; n < buf.size() ; n += r )
+		{
+			r = read( fd, buf.data() + n, buf.size() - n ) ;
+			if ( r < 0 && errno == EINTR ) { r = 0 ; continue ; }
+			if ( r <= 0 ) { break ; }
+		}
+		if ( n == 0 ) { break ; }
+		if ( first )
+		{
+			if ( memchr( buf.data(), 0x00, min( n, size_t( 4096 ) ) ) ) { break ; }
+			first = false ;
+		}
+		for ( i = 0 ; i < n ; ++i )
+		{
+			s = delta[ s * 256 + fold[ buf[ i ] ] ] ;
+			if ( !outputs[ s ].empty() )
+			{
+				for ( auto w : outputs[ s ] )
+				{
+					if ( !seen[ w ] )
+					{
+						seen[ w ] = 1 ;
+						++found ;
+					}
+				}
+				if ( found == nwords ) { break ; }
+			}
+		}
+		if ( n < buf.size() ) { break ; }
+	}
+
+	close( fd ) ;
+
+	return ( found == nwords ) ;
+}
+
+
+/**************************************************************************************************************/
+/**********************************            DIRECTORY CACHE            *************************************/
+/**************************************************************************************************************/
+
+dir_cache::dir_cache()
+{
+	clock = 0 ;
+	bytes = 0 ;
+	ifd   = inotify_init1( IN_NONBLOCK | IN_CLOEXEC ) ;
+}
+
+
+dir_cache::~dir_cache()
+{
+	if ( ifd != -1 )
+	{
+		close( ifd ) ;
+	}
+}
+
+
+void dir_cache::refresh()
+{
+	//
+	// Apply the inotify events received since the last call.
+	//
+	// A change to a name drops its lstat result and the lstat result of the directory itself in its
+	// parent (as its times change).  Creating, deleting or renaming also invalidates the names.
+	// If the event queue overflowed, everything is dropped.
+	//
+
+	ssize_t n ;
+	ssize_t i ;
+
+	const struct inotify_event* ev ;
+
+	char buf[ 65536 ] __attribute__ ( ( aligned( __alignof__( struct inotify_event ) ) ) ) ;
+
+	if ( ifd == -1 ) { return ; }
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	while ( ( n = read( ifd, buf, sizeof( buf ) ) ) > 0 )
+	{
+		for ( i = 0 ; i < n ; i += sizeof( struct inotify_event ) + ev->len )
+		{
+			ev = reinterpret_cast<const struct inotify_event*>( buf + i ) ;
+			if ( ev->mask & IN_Q_OVERFLOW )
+			{
+				while ( !dirs.empty() )
+				{
+					drop( dirs.begin() ) ;
+				}
+				continue ;
+			}
+			auto itw = wds.find( ev->wd ) ;
+			if ( itw == wds.end() )
+			{
+				continue ;
+			}
+			set<string> keys = itw->second ;
+			for ( const auto& key : keys )
+			{
+				auto it = dirs.find( key ) ;
+				if ( it == dirs.end() )
+				{
+					continue ;
+				}
+				if ( ev->mask & ( IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT ) )
+				{
+					drop_parent_stat( key ) ;
+					drop( it ) ;
+					continue ;
+				}
+				if ( ev->len > 0 )
+				{
+					drop_stat( it->second, ev->name ) ;
+				}
+				if ( ev->mask & ( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO ) )
+				{
+					it->second.names_ok = false ;
+					drop_parent_stat( key ) ;
+				}
+			}
+		}
+	}
+}
+
+
+void dir_cache::watch( const string& dir )
+{
+	//
+	// Start watching directory dir for changes.  Without a watch, only the names are cached.
+	// If the watch limit has been reached, stop watching the least recently used directory first.
+	//
+
+	int wd ;
+
+	if ( ifd == -1 ) { return ; }
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	dcache_dir& d = dirs[ dir ] ;
+	if ( d.wd != -1 ) { return ; }
+
+	d.used = ++clock ;
+
+	if ( wds.size() >= DIR_CACHE_WATCHES )
+	{
+		auto itl = dirs.end() ;
+		for ( auto it = dirs.begin() ; it != dirs.end() ; ++it )
+		{
+			if ( it->second.wd != -1 && ( itl == dirs.end() || it->second.used < itl->second.used ) )
+			{
+				itl = it ;
+			}
+		}
+		if ( itl != dirs.end() )
+		{
+			unwatch( itl ) ;
+		}
+	}
+
+	wd = inotify_add_watch( ifd,
+				dir.c_str(),
+				IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE |
+				IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+				IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR ) ;
+	if ( wd != -1 )
+	{
+		d.wd = wd ;
+		wds[ wd ].insert( dir ) ;
+	}
+}
+
+
+bool dir_cache::get_names( const string& dir,
+			   const struct stat& st,
+			   vector<pair<string, unsigned char>>& names )
+{
+	//
+	// Return the cached names of directory dir if its stat st matches the one when the names were stored.
+	//
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	auto it = dirs.find( dir ) ;
+	if ( it == dirs.end() )
+	{
+		return false ;
+	}
+
+	dcache_dir& d = it->second ;
+	if ( !d.names_ok ||
+	     d.dev != st.st_dev ||
+	     d.ino != st.st_ino ||
+	     d.mtim.tv_sec  != st.st_mtim.tv_sec  ||
+	     d.mtim.tv_nsec != st.st_mtim.tv_nsec ||
+	     d.ctim.tv_sec  != st.st_ctim.tv_sec  ||
+	     d.ctim.tv_nsec != st.st_ctim.tv_nsec )
+	{
+		return false ;
+	}
+
+	d.used = ++clock ;
+	names  = d.names ;
+
+	return true ;
+}
+
+
+void dir_cache::put_names( const string& dir,
+			   const struct stat& st,
+			   const vector<pair<string, unsigned char>>& names )
+{
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	dcache_dir& d = dirs[ dir ] ;
+
+	bytes   -= d.bytes ;
+	d.bytes  = sizeof( dcache_dir ) + dir.size() ;
+	for ( const auto& s : d.stats )
+	{
+		d.bytes += sizeof( struct stat ) + s.first.size() + 64 ;
+	}
+	for ( const auto& e : names )
+	{
+		d.bytes += sizeof( e ) + e.first.size() ;
+	}
+	bytes += d.bytes ;
+
+	d.names    = names ;
+	d.names_ok = true ;
+	d.dev      = st.st_dev ;
+	d.ino      = st.st_ino ;
+	d.mtim     = st.st_mtim ;
+	d.ctim     = st.st_ctim ;
+	d.used     = ++clock ;
+
+	if ( bytes > DIR_CACHE_SIZE )
+	{
+		trim() ;
+	}
+}
+
+
+bool dir_cache::get_stat( const string& dir,
+			  const string& name,
+			  struct stat& st )
+{
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	auto it = dirs.find( dir ) ;
+	if ( it == dirs.end() )
+	{
+		return false ;
+	}
+
+	auto its = it->second.stats.find( name ) ;
+	if ( its == it->second.stats.end() )
+	{
+		return false ;
+	}
+
+	it->second.used = ++clock ;
+	st = its->second ;
+
+	return true ;
+}
+
+
+void dir_cache::put_stat( const string& dir,
+			  const string& name,
+			  const struct stat& st )
+{
+	//
+	// Keep the lstat result for name in directory dir, if dir is being watched.
+	// Directories are not kept as a change inside one is not reported by the watch on dir.
+	//
+
+	size_t l ;
+
+	if ( S_ISDIR( st.st_mode ) ) { return ; }
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	auto it = dirs.find( dir ) ;
+	if ( it == dirs.end() || it->second.wd == -1 )
+	{
+		return ;
+	}
+
+	if ( it->second.stats.insert( make_pair( name, st ) ).second )
+	{
+		l = sizeof( struct stat ) + name.size() + 64 ;
+		it->second.bytes += l ;
+		bytes += l ;
+		if ( bytes > DIR_CACHE_SIZE )
+		{
+			trim() ;
+		}
+	}
+}
+
+
+void dir_cache::drop( map<string, dcache_dir>::iterator it )
+{
+	//
+	// Remove a directory from the cache, and its watch if no other name refers to it.
+	//
+
+	unwatch( it ) ;
+
+	bytes -= it->second.bytes ;
+	dirs.erase( it ) ;
+}
+
+
+void dir_cache::unwatch( map<string, dcache_dir>::iterator it )
+{
+	//
+	// Stop watching a directory, removing the inotify watch if no other name refers to it.
+	// The lstat results are dropped as changes to them are no longer seen.  The names are kept
+	// as they are checked against the directory times.
+	//
+
+	dcache_dir& d = it->second ;
+
+	if ( d.wd == -1 ) { return ; }
+
+	auto itw = wds.find( d.wd ) ;
+	if ( itw != wds.end() )
+	{
+		itw->second.erase( it->first ) ;
+		if ( itw->second.empty() )
+		{
+			inotify_rm_watch( ifd, d.wd ) ;
+			wds.erase( itw ) ;
+		}
+	}
+
+	d.wd = -1 ;
+
+	for ( const auto& s : d.stats )
+	{
+		d.bytes -= sizeof( struct stat ) + s.first.size() + 64 ;
+		bytes   -= sizeof( struct stat ) + s.first.size() + 64 ;
+	}
+	d.stats.clear() ;
+}
+
+
+void dir_cache::drop_stat( dcache_dir& d,
+			   const string& name )
+{
+	auto it = d.stats.find( name ) ;
+	if ( it != d.stats.end() )
+	{
+		d.bytes -= sizeof( struct stat ) + name.size() + 64 ;
+		bytes   -= sizeof( struct stat ) + name.size() + 64 ;
+		d.stats.erase( it ) ;
+	}
+}
+
+
+void dir_cache::drop_parent_stat( const string& dir )
+{
+	//
+	// Drop the lstat result for directory dir (ending in '/') held in its parent.
+	//
+
+	size_t p ;
+
+	if ( dir.size() < 2 ) { return ; }
+
+	p = dir.find_last_of( '/', dir.size() - 2 ) ;
+	if ( p == string::npos ) { return ; }
+
+	auto it = dirs.find( dir.substr( 0, p + 1 ) ) ;
+	if ( it != dirs.end() )
+	{
+		drop_stat( it->second, dir.substr( p + 1, dir.size() - p - 2 ) ) ;
+	}
+}
+
+
+void dir_cache::trim()
+{
+	//
+	// Drop the least recently used directories until the cache is at 3/4 of its limit.
+	//
+
+	vector<pair<uint64_t, string>> lru ;
+
+	for ( const auto& d : dirs )
+	{
+		lru.push_back( make_pair( d.second.used, d.first ) ) ;
+	}
+
+	sort( lru.begin(), lru.end() ) ;
+
+	for ( const auto& e : lru )
+	{
+		if ( bytes <= DIR_CACHE_SIZE / 4 * 3 ) { break ; }
+		drop( dirs.find( e.second ) ) ;
+	}
+}
+
+
+/**************************************************************************************************************/
+/**********************************              FILTER SET               *************************************/
+/**************************************************************************************************************/
+
+#define TK_ANYNB 256
+#define TK_ANY   257
+#define TK_STAR  258
+#define TK_END   259
+
+#define FS_MAX_STATES 4096
+
+
+filter_set::filter_set()
+{
+	for ( uint i = 0 ; i < 256 ; ++i )
+	{
+		fold[ i ] = ( i < 128 ) ? tolower( i ) : i ;
+	}
+
+	clear() ;
+}
+
+
+void filter_set::clear()
+{
+	pats.clear() ;
+	tok.clear() ;
+	ticase.clear() ;
+	tbit.clear() ;
+	starts.clear() ;
+
+	inc_mask = 0 ;
+	exc_mask = 0 ;
+	nglobs   = 0 ;
+
+	reset_dfa() ;
+}
+
+
+void filter_set::add( const string& f,
+		      const boost::regex* rx,
+		      bool include )
+{
+	//
+	// Add filter f.  rx is the filter's regex, or null for a plain (upper case) string.
+	//
+
+	size_t n ;
+
+	string t ;
+
+	filter_pattern p ;
+
+	const string regex_chars = "\\^$+{}[]()|" ;
+
+	p.include = include ;
+	p.icase   = false ;
+
+	if ( !rx )
+	{
+		p.kind = FP_SUBSTR ;
+		p.str  = f ;
+		pats.push_back( p ) ;
+		return ;
+	}
+
+	p.icase = ( rx->flags() & boost::regex_constants::icase ) ;
+
+	for ( size_t i = 0 ; i < f.size() ; ++i )
+	{
+		if ( f[ i ] == '*' && i > 0 && f[ i - 1 ] == '*' ) { continue ; }
+		t.push_back( ( p.icase ) ? fold[ (unsigned char)f[ i ] ] : f[ i ] ) ;
+	}
+
+	n = count( t.begin(), t.end(), '*' ) ;
+
+	if ( t.find_first_of( regex_chars ) != string::npos || ( n > 1 && nglobs == 64 ) )
+	{
+		p.kind = FP_REGEX ;
+		p.rx   = *rx ;
+		pats.push_back( p ) ;
+		return ;
+	}
+
+	if ( n == 0 )
+	{
+		p.kind = FP_EXACT ;
+		p.str  = t ;
+		pats.push_back( p ) ;
+		return ;
+	}
+
+	if ( n == 1 && t.back() == '*' )
+	{
+		p.kind = FP_PREFIX ;
+		p.str  = t.substr( 0, t.size() - 1 ) ;
+		pats.push_back( p ) ;
+		return ;
+	}
+
+	if ( n == 1 && t.front() == '*' )
+	{
+		p.kind = FP_SUFFIX ;
+		p.str  = t.substr( 1 ) ;
+		pats.push_back( p ) ;
+		return ;
+	}
+
+	starts.push_back( tok.size() ) ;
+	for ( unsigned char c : t )
+	{
+		tok.push_back( ( c == '?' ) ? TK_ANYNB :
+			       ( c == '.' ) ? TK_ANY   :
+			       ( c == '*' ) ? TK_STAR  : c ) ;
+		ticase.push_back( p.icase ) ;
+		tbit.push_back( nglobs ) ;
+	}
+	tok.push_back( TK_END ) ;
+	ticase.push_back( p.icase ) ;
+	tbit.push_back( nglobs ) ;
+
+	if ( include )
+	{
+		inc_mask |= ( uint64_t( 1 ) << nglobs ) ;
+	}
+	else
+	{
+		exc_mask |= ( uint64_t( 1 ) << nglobs ) ;
+	}
+
+	++nglobs ;
+
+	reset_dfa() ;
+}
+
+
+void filter_set::classify( const string& e,
+			   bool& inc,
+			   bool& exc )
+{
+	//
+	// Set inc if name e matches all the include filters and exc if it matches any exclude filter.
+	//
+
+	int t ;
+
+	bool m ;
+
+	uint s ;
+
+	size_t l ;
+
+	string ue ;
+
+	uint64_t mask ;
+
+	inc = true  ;
+	exc = false ;
+
+	for ( const auto& p : pats )
+	{
+		if ( ( p.include && !inc ) || ( !p.include && exc ) )
+		{
+			continue ;
+		}
+		l = p.str.size() ;
+		switch ( p.kind )
+		{
+		case FP_SUBSTR:
+			if ( ue.size() != e.size() ) { ue = upper( e ) ; }
+			m = ( ue.find( p.str ) != string::npos ) ;
+			break ;
+
+		case FP_EXACT:
+			m = ( e.size() == l && match_literal( e, 0, p ) ) ;
+			break ;
+
+		case FP_PREFIX:
+			m = ( e.size() >= l && match_literal( e, 0, p ) && e.find_first_of( " \t", l ) == string::npos ) ;
+			break ;
+
+		case FP_SUFFIX:
+			m = ( e.size() >= l && match_literal( e, e.size() - l, p ) && e.find_first_of( " \t" ) >= e.size() - l ) ;
+			break ;
+
+		case FP_REGEX:
+			m = regex_match( e.begin(), e.end(), p.rx ) ;
+			break ;
+
+		default:
+			m = false ;
+		}
+		if ( p.include && !m )
+		{
+			inc = false ;
+		}
+		else if ( !p.include && m )
+		{
+			exc = true ;
+		}
+	}
+
+	if ( nglobs == 0 || ( !inc && ( exc || exc_mask == 0 ) ) )
+	{
+		return ;
+	}
+
+	s = 0 ;
+	for ( unsigned char c : e )
+	{
+		t = trans[ s * 256 + c ] ;
+		s = ( t < 0 ) ? next_state( s, c ) : t ;
+	}
+
+	mask = masks[ s ] ;
+
+	if ( ( mask & inc_mask ) != inc_mask )
+	{
+		inc = false ;
+	}
+
+	if ( mask & exc_mask )
+	{
+		exc = true ;
+	}
+}
+
+
+bool filter_set::match_literal( const string& e,
+				size_t o,
+				const filter_pattern& p ) const
+{
+	//
+	// Match the part of a generic filter without a * against e at offset o.
+	//
+
+	unsigned char c ;
+
+	for ( size_t i = 0 ; i < p.str.size() ; ++i )
+	{
+		c = e[ o + i ] ;
+		switch ( p.str[ i ] )
+		{
+		case '.':
+			break ;
+
+		case '?':
+			if ( c == ' ' || c == '\t' ) { return false ; }
+			break ;
+
+		default:
+			if ( ( ( p.icase ) ? fold[ c ] : c ) != (unsigned char)p.str[ i ] ) { return false ; }
+		}
+	}
+
+	return true ;
+}
+
+
+void filter_set::closure( vector<uint>& v ) const
+{
+	//
+	// Add the positions following a * (which can match nothing), then sort and remove duplicates.
+	//
+
+	for ( size_t i = 0 ; i < v.size() ; ++i )
+	{
+		if ( tok[ v[ i ] ] == TK_STAR )
+		{
+			v.push_back( v[ i ] + 1 ) ;
+		}
+	}
+
+	sort( v.begin(), v.end() ) ;
+	v.erase( unique( v.begin(), v.end() ), v.end() ) ;
+}
+
+
+uint filter_set::add_state( vector<uint>& v )
+{
+	//
+	// Return the DFA state for the set of filter positions v, adding it if new.
+	//
+
+	uint64_t mask = 0 ;
+
+	auto it = state_ids.find( v ) ;
+	if ( it != state_ids.end() )
+	{
+		return it->second ;
+	}
+
+	for ( auto p : v )
+	{
+		if ( tok[ p ] == TK_END )
+		{
+			mask |= ( uint64_t( 1 ) << tbit[ p ] ) ;
+		}
+	}
+
+	states.push_back( v ) ;
+	masks.push_back( mask ) ;
+	trans.resize( trans.size() + 256, -1 ) ;
+	state_ids[ v ] = states.size() - 1 ;
+
+	return states.size() - 1 ;
+}
+
+
+uint filter_set::next_state( uint s,
+			     unsigned char c )
+{
+	//
+	// Work out the transition from state s on character c.  If there are too many states, the
+	// DFA is restarted (keeping only the start state) before the new state is added.
+	//
+
+	int t ;
+
+	uint ns ;
+
+	bool blank = ( c == ' ' || c == '\t' ) ;
+
+	vector<uint> v ;
+
+	for ( auto p : states[ s ] )
+	{
+		t = tok[ p ] ;
+		switch ( t )
+		{
+		case TK_END:
+			break ;
+
+		case TK_STAR:
+			if ( !blank ) { v.push_back( p ) ; }
+			break ;
+
+		case TK_ANYNB:
+			if ( !blank ) { v.push_back( p + 1 ) ; }
+			break ;
+
+		case TK_ANY:
+			v.push_back( p + 1 ) ;
+			break ;
+
+		default:
+			if ( ( ( ticase[ p ] ) ? fold[ c ] : c ) == t ) { v.push_back( p + 1 ) ; }
+		}
+	}
+
+	closure( v ) ;
+
+	if ( states.size() >= FS_MAX_STATES )
+	{
+		reset_dfa() ;
+		return add_state( v ) ;
+	}
+
+	ns = add_state( v ) ;
+	trans[ s * 256 + c ] = ns ;
+
+	return ns ;
+}
+
+
+void filter_set::reset_dfa()
+{
+	//
+	// Clear the DFA and add the start state (state 0).
+	//
+
+	vector<uint> v = starts ;
+
+	states.clear() ;
+	state_ids.clear() ;
+	trans.clear() ;
+	masks.clear() ;
+
+	closure( v ) ;
+	add_state( v ) ;
+}
+
+
+/**************************************************************************************************************/
+/**********************************            TREE OPERATIONS            *************************************/
+/**************************************************************************************************************/
+
+#define TREE_COPY_CHUNK  ( 8 * 1024 * 1024 )
+#define TREE_DEL_BATCH   256
+
+
+tree_op::tree_op( bool r,
+		  bool f,
+		  bool p )
+{
+	recursive = r ;
+	frepl     = f ;
+	prattrs   = p ;
+	deleting  = false ;
+	done      = false ;
+	skipped   = false ;
+	entries   = 0 ;
+	bytes     = 0 ;
+}
+
+
+bool tree_op::copy( const string& src,
+		    const string& dest,
+		    const std::function<bool()>& f )
+{
+	//
+	// Copy directory src to dest, creating dest (as src) if it does not exist.
+	// Return false if the copy was cancelled by the progress callback.
+	//
+
+	tree_node* root ;
+
+	deleting = false ;
+
+	nodes.emplace_back( src, dest, nullptr ) ;
+	root = &nodes.back() ;
+
+	pool.submit( [ this, root ]()
+		{
+			copy_dir( root ) ;
+		} ) ;
+
+	return run( root, f ) ;
+}
+
+
+bool tree_op::remove( const string& dir,
+		      const std::function<bool()>& f )
+{
+	//
+	// Delete directory dir and everything under it.
+	// Return false if the delete was cancelled by the progress callback.
+	//
+
+	tree_node* root ;
+
+	deleting = true ;
+
+	nodes.emplace_back( dir, "", nullptr ) ;
+	root = &nodes.back() ;
+
+	pool.submit( [ this, root ]()
+		{
+			delete_dir( root ) ;
+		} ) ;
+
+	return run( root, f ) ;
+}
+
+
+void tree_op::status( uint64_t& n,
+		      uint64_t& b,
+		      string& e )
+{
+	//
+	// Return the number of entries and bytes processed so far and the last entry done.
+	//
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	n = entries ;
+	b = bytes ;
+	e = current ;
+}
+
+
+bool tree_op::run( tree_node* root,
+		   const std::function<bool()>& f )
+{
+	//
+	// Wait for the tasks to complete, calling f every half second.  If f returns false, cancel the
+	// pool.  Tasks already running finish the entry they are working on.
+	//
+
+	bool idle ;
+	bool cancelled = false ;
+
+	boost::posix_time::ptime next ;
+
+	next = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds( 500 ) ;
+
+	while ( true )
+	{
+		idle = pool.idle() ;
+		{
+			boost::unique_lock<boost::mutex> lock( mtx ) ;
+			if ( done || idle ) { break ; }
+			cond.timed_wait( lock, boost::posix_time::milliseconds( 100 ) ) ;
+		}
+		if ( !cancelled && boost::posix_time::microsec_clock::universal_time() >= next )
+		{
+			if ( !f() )
+			{
+				cancelled = true ;
+				pool.cancel() ;
+			}
+			next = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds( 500 ) ;
+		}
+	}
+
+	pool.wait() ;
+
+	return !cancelled ;
+}
+
+
+void tree_op::copy_dir( tree_node* node )
+{
+	//
+	// Create the target directory and copy the entries in node->src.  Subdirectories are copied by
+	// new tasks if recursive, otherwise they are only created.  Regular files are copied by new tasks.
+	// Runs on a worker thread.
+	//
+
+	int e ;
+
+	string s ;
+	string t ;
+	string link ;
+
+	unsigned char type ;
+
+	DIR* dir ;
+
+	struct dirent* ent ;
+	struct stat st ;
+
+	tree_node* child ;
+
+	vector<char> buf ;
+
+	if ( lstat( node->src.c_str(), &st ) != 0 )
+	{
+		error( "Listing directory", node->src, errno ) ;
+		node->ok = false ;
+		finish( node ) ;
+		return ;
+	}
+
+	if ( mkdir( node->dest.c_str(), st.st_mode & 07777 ) != 0 && errno != EEXIST )
+	{
+		error( "Copy of directory", node->src, errno ) ;
+		node->ok = false ;
+		finish( node ) ;
+		return ;
+	}
+
+	if ( !recursive && node->parent )
+	{
+		finish( node ) ;
+		return ;
+	}
+
+	dir = opendir( node->src.c_str() ) ;
+	if ( !dir )
+	{
+		error( "Listing directory", node->src, errno ) ;
+		node->ok = false ;
+		finish( node ) ;
+		return ;
+	}
+
+	while ( !pool.cancelled() && ( ent = readdir( dir ) ) )
+	{
+		if ( strcmp( ent->d_name, "." ) == 0 || strcmp( ent->d_name, ".." ) == 0 )
+		{
+			continue ;
+		}
+		s    = node->src  + "/" + ent->d_name ;
+		t    = node->dest + "/" + ent->d_name ;
+		type = ent->d_type ;
+		if ( type == DT_UNKNOWN )
+		{
+			if ( lstat( s.c_str(), &st ) != 0 )
+			{
+				error( "Copy of", s, errno ) ;
+				continue ;
+			}
+			type = ( S_ISDIR( st.st_mode ) ) ? DT_DIR :
+			       ( S_ISREG( st.st_mode ) ) ? DT_REG :
+			       ( S_ISLNK( st.st_mode ) ) ? DT_LNK : DT_UNKNOWN ;
+		}
+		if ( type == DT_DIR )
+		{
+			{
+				boost::lock_guard<boost::mutex> lock( mtx ) ;
+				nodes.emplace_back( s, t, node ) ;
+				child = &nodes.back() ;
+				++node->pending ;
+			}
+			pool.submit( [ this, child ]()
+				{
+					copy_dir( child ) ;
+				} ) ;
+			continue ;
+		}
+		if ( !frepl && lstat( t.c_str(), &st ) == 0 )
+		{
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			skipped = true ;
+			continue ;
+		}
+		if ( type == DT_REG )
+		{
+			{
+				boost::lock_guard<boost::mutex> lock( mtx ) ;
+				++node->pending ;
+			}
+			pool.submit( [ this, node, s, t ]()
+				{
+					copy_file( node, s, t ) ;
+				} ) ;
+		}
+		else if ( type == DT_LNK )
+		{
+			buf.resize( PATH_MAX + 1 ) ;
+			e = readlink( s.c_str(), buf.data(), buf.size() - 1 ) ;
+			if ( e < 0 )
+			{
+				error( "Copy of symlink", s, errno ) ;
+				continue ;
+			}
+			link.assign( buf.data(), e ) ;
+			if ( symlink( link.c_str(), t.c_str() ) != 0 &&
+			   ( errno != EEXIST || unlink( t.c_str() ) != 0 || symlink( link.c_str(), t.c_str() ) != 0 ) )
+			{
+				error( "Copy of symlink", s, errno ) ;
+				continue ;
+			}
+			if ( prattrs )
+			{
+				copy_attributes( s, t ) ;
+			}
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			++entries ;
+			current = s ;
+		}
+		else
+		{
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			errors.push_back( "Ignoring entry " + s + ".  Not a regular file, directory or symlink" ) ;
+		}
+	}
+
+	closedir( dir ) ;
+
+	finish( node ) ;
+}
+
+
+void tree_op::copy_file( tree_node* node,
+			 const string& s,
+			 const string& t )
+{
+	//
+	// Copy regular file s to t.  The data is written to a temporary file in the target directory
+	// that replaces t when complete, so t is never left partly written.  Runs on a worker thread.
+	//
+	// The temporary name has a fixed length so it is valid whatever the length of the target name.
+	//
+
+	int in ;
+	int out ;
+	int e ;
+
+	bool ok ;
+
+	size_t p ;
+
+	string n ;
+
+	struct stat st ;
+
+	vector<char> tmp ;
+
+	in = open( s.c_str(), O_RDONLY | O_CLOEXEC ) ;
+	if ( in == -1 || fstat( in, &st ) != 0 )
+	{
+		error( "Copy of file", s, errno ) ;
+		if ( in != -1 ) { close( in ) ; }
+		finish( node ) ;
+		return ;
+	}
+
+	p = t.find_last_of( '/' ) + 1 ;
+	n = t.substr( 0, p ) + ".lspf.XXXXXX" ;
+	tmp.assign( n.begin(), n.end() ) ;
+	tmp.push_back( 0x00 ) ;
+
+	out = mkostemp( tmp.data(), O_CLOEXEC ) ;
+	if ( out == -1 )
+	{
+		error( "Copy of file", s, errno ) ;
+		close( in ) ;
+		finish( node ) ;
+		return ;
+	}
+
+	fchmod( out, st.st_mode & 07777 ) ;
+
+	ok = copy_data( in, out, ( st.st_size == 0 ) ) ;
+	e  = errno ;
+
+	close( in ) ;
+	if ( close( out ) != 0 && ok )
+	{
+		ok = false ;
+		e  = errno ;
+	}
+
+	if ( ok && prattrs )
+	{
+		copy_attributes( s, tmp.data() ) ;
+	}
+
+	if ( ok && rename( tmp.data(), t.c_str() ) != 0 )
+	{
+		ok = false ;
+		e  = errno ;
+	}
+
+	if ( ok )
+	{
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		++entries ;
+		current = s ;
+	}
+	else
+	{
+		unlink( tmp.data() ) ;
+		if ( !pool.cancelled() )
+		{
+			error( "Copy of file", s, e ) ;
+		}
+	}
+
+	finish( node ) ;
+}
+
+
+bool tree_op::copy_data( int in,
+			 int out,
+			 bool plain )
+{
+	//
+	// Copy the contents of file in to file out.  Use copy_file_range() so the data need not pass
+	// through user space (and can be shared on file systems that support it).  If that is not supported
+	// between the two files, use sendfile() and then read/write.  Files that report a size of zero
+	// (eg. in /proc) are always read so the data is not missed.
+	//
+	// Return false with errno set on error or if the pool is cancelled.
+	//
+
+	int method = ( plain ) ? 2 : 0 ;
+
+	ssize_t r ;
+	ssize_t w ;
+
+	off_t total = 0 ;
+
+	vector<char> buf ;
+
+	while ( true )
+	{
+		if ( pool.cancelled() )
+		{
+			errno = ECANCELED ;
+			return false ;
+		}
+		if ( method == 0 )
+		{
+			r = copy_file_range( in, nullptr, out, nullptr, TREE_COPY_CHUNK, 0 ) ;
+			if ( r == -1 && total == 0 && ( errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP ) )
+			{
+				method = 1 ;
+				continue ;
+			}
+		}
+		else if ( method == 1 )
+		{
+			r = sendfile( out, in, nullptr, TREE_COPY_CHUNK ) ;
+			if ( r == -1 && total == 0 && ( errno == ENOSYS || errno == EINVAL ) )
+			{
+				method = 2 ;
+				continue ;
+			}
+		}
+		else
+		{
+			if ( buf.empty() ) { buf.resize( 1048576 ) ; }
+			r = read( in, buf.data(), buf.size() ) ;
+			for ( ssize_t i = 0 ; i < r ; i += w )
+			{
+				w = write( out, buf.data() + i, r - i ) ;
+				if ( w == -1 )
+				{
+					if ( errno == EINTR ) { w = 0 ; continue ; }
+					return false ;
+				}
+			}
+		}
+		if ( r == -1 )
+		{
+			if ( errno == EINTR ) { continue ; }
+			return false ;
+		}
+		if ( r == 0 )
+		{
+			if ( total == 0 && method < 2 )
+			{
+				method = 2 ;
+				continue ;
+			}
+			return true ;
+		}
+		total += r ;
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		bytes += r ;
+	}
+}
+
+
+void tree_op::delete_dir( tree_node* node )
+{
+	//
+	// Delete the entries in node->src.  Subdirectories are deleted by new tasks and other entries are
+	// unlinked in batches by new tasks.  node->src itself is removed by finish() when everything under
+	// it has gone.  Runs on a worker thread.
+	//
+
+	string s ;
+
+	unsigned char type ;
+
+	DIR* dir ;
+
+	struct dirent* ent ;
+	struct stat st ;
+
+	tree_node* child ;
+
+	vector<string> batch ;
+
+	auto submit_batch = [ this, node, &batch ]()
+	{
+		{
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			++node->pending ;
+		}
+		pool.submit( [ this, node, batch ]()
+			{
+				delete_files( node, batch ) ;
+			} ) ;
+		batch.clear() ;
+	} ;
+
+	dir = opendir( node->src.c_str() ) ;
+	if ( !dir )
+	{
+		error( "Listing directory", node->src, errno ) ;
+		node->ok = false ;
+		finish( node ) ;
+		return ;
+	}
+
+	while ( !pool.cancelled() && ( ent = readdir( dir ) ) )
+	{
+		if ( strcmp( ent->d_name, "." ) == 0 || strcmp( ent->d_name, ".." ) == 0 )
+		{
+			continue ;
+		}
+		s    = node->src + "/" + ent->d_name ;
+		type = ent->d_type ;
+		if ( type == DT_UNKNOWN && lstat( s.c_str(), &st ) == 0 && S_ISDIR( st.st_mode ) )
+		{
+			type = DT_DIR ;
+		}
+		if ( type == DT_DIR )
+		{
+			{
+				boost::lock_guard<boost::mutex> lock( mtx ) ;
+				nodes.emplace_back( s, "", node ) ;
+				child = &nodes.back() ;
+				++node->pending ;
+			}
+			pool.submit( [ this, child ]()
+				{
+					delete_dir( child ) ;
+				} ) ;
+			continue ;
+		}
+		batch.push_back( s ) ;
+		if ( batch.size() == TREE_DEL_BATCH )
+		{
+			submit_batch() ;
+		}
+	}
+
+	closedir( dir ) ;
+
+	if ( !batch.empty() )
+	{
+		submit_batch() ;
+	}
+
+	finish( node ) ;
+}
+
+
+void tree_op::delete_files( tree_node* node,
+			    const vector<string>& files )
+{
+	//
+	// Unlink a batch of entries in directory node.  Runs on a worker thread.
+	//
+
+	for ( const auto& file : files )
+	{
+		if ( pool.cancelled() ) { break ; }
+		if ( unlink( file.c_str() ) != 0 )
+		{
+			error( "Delete of", file, errno ) ;
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			node->ok = false ;
+			continue ;
+		}
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		++entries ;
+		current = file ;
+	}
+
+	finish( node ) ;
+}
+
+
+void tree_op::finish( tree_node* node )
+{
+	//
+	// A task for node has completed.  When there are none left, the directory is complete so copy
+	// its attributes or remove it, then do the same for the parent.  When the root is complete, wake
+	// up run().
+	//
+	// Nothing is done if the pool has been cancelled as the directory may not have been fully processed.
+	//
+
+	while ( true )
+	{
+		{
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			if ( --node->pending > 0 || pool.cancelled() ) { return ; }
+		}
+		if ( deleting )
+		{
+			if ( node->ok && rmdir( node->src.c_str() ) != 0 )
+			{
+				error( "Delete of directory", node->src, errno ) ;
+				node->ok = false ;
+			}
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			if ( !node->ok )
+			{
+				if ( node->parent ) { node->parent->ok = false ; }
+			}
+			else
+			{
+				++entries ;
+				current = node->src ;
+			}
+		}
+		else if ( node->ok && prattrs )
+		{
+			copy_attributes( node->src, node->dest ) ;
+		}
+		if ( !node->parent )
+		{
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			done = true ;
+			cond.notify_all() ;
+			return ;
+		}
+		node = node->parent ;
+	}
+}
+
+
+void tree_op::error( const string& text,
+		     const string& file,
+		     int e )
+{
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	errors.push_back( text + " " + file + " failed.  " + boost::system::error_code( e, boost::system::system_category() ).message() ) ;
+}
+
+
+void tree_op::copy_attributes( const string& file1,
+			       const string& file2 )
+{
+	//
+	// Copy mode, ownership, timestamps and xattr from file1 to file2.  Symlinks themselves are
+	// changed, not the file they point to.  Thread safe.
+	//
+
+	ssize_t buflen ;
+	ssize_t vallen ;
+	ssize_t keylen ;
+
+	int flags = 0 ;
+
+	bool lnk ;
+
+	char* buf ;
+	char* key ;
+	char* val ;
+
+	const char* fl1 = file1.c_str() ;
+	const char* fl2 = file2.c_str() ;
+
+	struct timespec times[ 2 ] ;
+
+	struct stat fl1_stats ;
+
+	if ( lstat( fl1, &fl1_stats ) == 0 )
+	{
+		lnk = S_ISLNK( fl1_stats.st_mode ) ;
+		lchown( fl2, fl1_stats.st_uid, -1 ) ;
+		lchown( fl2, -1, fl1_stats.st_gid ) ;
+		if ( !lnk )
+		{
+			chmod( fl2, fl1_stats.st_mode & 07777 ) ;
+		}
+		times[ 0 ] = fl1_stats.st_atim ;
+		times[ 1 ] = fl1_stats.st_mtim ;
+		utimensat( AT_FDCWD, fl2, times, AT_SYMLINK_NOFOLLOW ) ;
+	}
+
+	buflen = llistxattr( fl1, nullptr, 0 ) ;
+	if ( buflen > 0 )
+	{
+		buf    = new char[ buflen ] ;
+		key    = buf ;
+		buflen = llistxattr( fl1, key, buflen ) ;
+		while ( buflen > 0 )
+		{
+			vallen = lgetxattr( fl1, key, nullptr, 0 ) ;
+			if ( vallen >= 0 )
+			{
+				val    = new char[ vallen ] ;
+				vallen = lgetxattr( fl1, key, val, vallen ) ;
+				if ( vallen >= 0 )
+				{
+					lsetxattr( fl2, key, val, vallen, flags ) ;
+				}
+				delete[] val ;
+			}
+			keylen = strlen( key ) + 1 ;
+			key    = key + keylen ;
+			buflen = buflen - keylen ;
+		}
+		delete[] buf ;
+	}
+}
+
+
+/**************************************************************************************************************/
+/**********************************            DIRECTORY TREE             *************************************/
+/**************************************************************************************************************/
+
+dir_tree::dir_tree()
+{
+	dev = 0 ;
+}
+
+
+dir_tree::~dir_tree()
+{
+	pool.cancel() ;
+	pool.wait() ;
+}
+
+
+bool dir_tree::open( const string& dir,
+		     string& err )
+{
+	//
+	// Read the top directory and start adding up the sizes of the directories in it.
+	// The top directory may be a symlink to a directory.  Symlinks below it are not followed.
+	//
+
+	struct stat st ;
+
+	if ( stat( dir.c_str(), &st ) != 0 )
+	{
+		err = boost::system::error_code( errno, boost::system::system_category() ).message() ;
+		return false ;
+	}
+
+	if ( !S_ISDIR( st.st_mode ) )
+	{
+		err = boost::system::error_code( ENOTDIR, boost::system::system_category() ).message() ;
+		return false ;
+	}
+
+	dev = st.st_dev ;
+
+	entries.clear() ;
+	entries.emplace_back( dir, dir, 0, true, st.st_blocks * 512 ) ;
+
+	if ( !expand( 0, err ) )
+	{
+		return false ;
+	}
+
+	for ( auto i : entries[ 0 ].children )
+	{
+		const string& p = entries[ i ].path ;
+		if ( !entries[ i ].dir || lstat( p.c_str(), &st ) != 0 || st.st_dev != dev ) { continue ; }
+		pool.submit( [ this, p, st ]()
+			{
+				du( p, st ) ;
+			} ) ;
+	}
+
+	return true ;
+}
+
+
+bool dir_tree::expand( uint i,
+		       string& err )
+{
+	//
+	// Expand entry i, reading its entries if this has not been done.
+	//
+
+	if ( !entries[ i ].loaded && !read_children( i, err ) )
+	{
+		return false ;
+	}
+
+	entries[ i ].expanded = true ;
+
+	return true ;
+}
+
+
+bool dir_tree::read_children( uint i,
+			      string& err )
+{
+	//
+	// Read the entries of directory i, sorted by name.  Only regular files, directories and
+	// symlinks are added.  Symlinks to directories are not followed.
+	//
+
+	uint d ;
+
+	string dir ;
+
+	DIR* dp ;
+
+	struct dirent* ent ;
+	struct stat st ;
+
+	vector<pair<string, struct stat>> v ;
+
+	dir = entries[ i ].path ;
+	d   = ( i == 0 ) ? 0 : entries[ i ].depth + 1 ;
+
+	dp = opendir( dir.c_str() ) ;
+	if ( !dp )
+	{
+		err = boost::system::error_code( errno, boost::system::system_category() ).message() ;
+		return false ;
+	}
+
+	while ( ( ent = readdir( dp ) ) )
+	{
+		if ( strcmp( ent->d_name, "." ) == 0 || strcmp( ent->d_name, ".." ) == 0 )
+		{
+			continue ;
+		}
+		if ( fstatat( dirfd( dp ), ent->d_name, &st, AT_SYMLINK_NOFOLLOW ) != 0 )
+		{
+			continue ;
+		}
+		if ( S_ISREG( st.st_mode ) || S_ISDIR( st.st_mode ) || S_ISLNK( st.st_mode ) )
+		{
+			v.push_back( make_pair( string( ent->d_name ), st ) ) ;
+		}
+	}
+
+	closedir( dp ) ;
+
+	sort( v.begin(), v.end(), []( const pair<string, struct stat>& a, const pair<string, struct stat>& b )
+		{
+			return a.first < b.first ;
+		} ) ;
+
+	if ( dir.back() != '/' )
+	{
+		dir.push_back( '/' ) ;
+	}
+
+	for ( const auto& e : v )
+	{
+		entries[ i ].children.push_back( entries.size() ) ;
+		entries.emplace_back( e.first,
+				      dir + e.first,
+				      d,
+				      S_ISDIR( e.second.st_mode ),
+				      e.second.st_blocks * 512 ) ;
+	}
+
+	entries[ i ].loaded = true ;
+
+	return true ;
+}
+
+
+void dir_tree::visible( vector<uint>& v ) const
+{
+	//
+	// Return the entries to display, in order.  These are the entries of the top directory and of
+	// all expanded directories below it.
+	//
+
+	uint i ;
+
+	vector<uint> stk ;
+
+	v.clear() ;
+
+	stk.assign( entries[ 0 ].children.rbegin(), entries[ 0 ].children.rend() ) ;
+
+	while ( !stk.empty() )
+	{
+		i = stk.back() ;
+		stk.pop_back() ;
+		v.push_back( i ) ;
+		if ( entries[ i ].expanded )
+		{
+			stk.insert( stk.end(), entries[ i ].children.rbegin(), entries[ i ].children.rend() ) ;
+		}
+	}
+}
+
+
+string dir_tree::line( uint i ) const
+{
+	//
+	// Tree line for entry i.  Directories not expanded are shown with a '+'.
+	//
+
+	const tree_entry& e = entries[ i ] ;
+
+	return copies( "|   ", e.depth ) + ( ( e.dir && !e.expanded ) ? "+-- " : "|-- " ) + e.name ;
+}
+
+
+bool dir_tree::get_size( uint i,
+			 uint64_t& sz )
+{
+	//
+	// Return the size of entry i.  Return false if the size of a directory is not yet known.
+	//
+
+	const tree_entry& e = entries[ i ] ;
+
+	if ( !e.dir )
+	{
+		sz = e.size ;
+		return true ;
+	}
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	auto it = dsizes.find( e.path ) ;
+	if ( it == dsizes.end() )
+	{
+		return false ;
+	}
+
+	sz = it->second ;
+
+	return true ;
+}
+
+
+size_t dir_tree::sizes_known()
+{
+	//
+	// Number of directory sizes added up so far.  Used to see if the display needs rebuilding.
+	//
+
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	return dsizes.size() ;
+}
+
+
+uint64_t dir_tree::du( const string& dir,
+		       const struct stat& st )
+{
+	//
+	// Add up the space allocated to directory dir and everything below it.  Save the size of
+	// each directory completed.  Runs on a worker thread.
+	//
+
+	uint64_t total = st.st_blocks * 512 ;
+
+	DIR* dp ;
+
+	struct dirent* ent ;
+	struct stat st1 ;
+
+	dp = opendir( dir.c_str() ) ;
+	if ( dp )
+	{
+		while ( !pool.cancelled() && ( ent = readdir( dp ) ) )
+		{
+			if ( strcmp( ent->d_name, "." ) == 0 || strcmp( ent->d_name, ".." ) == 0 )
+			{
+				continue ;
+			}
+			if ( fstatat( dirfd( dp ), ent->d_name, &st1, AT_SYMLINK_NOFOLLOW ) != 0 )
+			{
+				continue ;
+			}
+			if ( S_ISDIR( st1.st_mode ) )
+			{
+				if ( st1.st_dev == dev )
+				{
+					total += du( dir + "/" + ent->d_name, st1 ) ;
+				}
+				continue ;
+			}
+			if ( st1.st_nlink > 1 )
+			{
+				boost::lock_guard<boost::mutex> lock( mtx ) ;
+				if ( !links.insert( make_pair( st1.st_dev, st1.st_ino ) ).second )
+				{
+					continue ;
+				}
+			}
+			total += st1.st_blocks * 512 ;
+		}
+		closedir( dp ) ;
+	}
+
+	if ( !pool.cancelled() )
+	{
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		dsizes[ dir ] = total ;
+	}
+
+	return total ;
+}
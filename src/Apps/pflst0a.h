@@ -51,6 +51,438 @@ enum LN_CMDS
 
 using namespace boost::filesystem ;
 
+// Approximate storage used by the file list directory cache before directories are dropped.
+#define DIR_CACHE_SIZE ( 64 * 1024 * 1024 )
+#define DIR_CACHE_WATCHES 512
+
+
+class dcache_dir
+{
+	public:
+		dcache_dir()
+		{
+			names_ok = false ;
+			wd       = -1 ;
+			used     = 0  ;
+			bytes    = 0  ;
+		}
+
+		bool names_ok ;
+		int  wd ;
+
+		uint64_t used ;
+		size_t bytes ;
+
+		struct timespec mtim ;
+		struct timespec ctim ;
+
+		dev_t dev ;
+		ino_t ino ;
+
+		vector<pair<string, unsigned char>> names ;
+
+		map<string, struct stat> stats ;
+} ;
+
+
+class dir_cache
+{
+	//
+	// Directory entries and lstat results kept between file list refreshes and pflst0a invocations.
+	// Keys are directory names ending in '/'.
+	//
+	// The entry names of a directory are used while its modification and change times are unchanged.
+	// Directories are also watched with inotify (where available) so entries that change are known and
+	// only those need another lstat.  lstat results are not kept for directories that are not watched,
+	// or for subdirectories, as the watch on the parent is not told about changes inside them.
+	// refresh() applies the inotify events received since the last call.
+	//
+	// At most DIR_CACHE_WATCHES directories are watched, so a recursive list does not use up the
+	// user's inotify watches.  The watch on the least recently used directory is removed to make room.
+	// Access times are not watched so the cached access time of a file may be out of date.  The cache
+	// is not used when access dates are shown or sorted on.
+	//
+	// The least recently used directories are dropped when the cache exceeds DIR_CACHE_SIZE bytes.
+	//
+
+	public:
+		dir_cache() ;
+		~dir_cache() ;
+
+		void refresh() ;
+
+		void watch( const string& ) ;
+
+		bool get_names( const string&,
+				const struct stat&,
+				vector<pair<string, unsigned char>>& ) ;
+
+		void put_names( const string&,
+				const struct stat&,
+				const vector<pair<string, unsigned char>>& ) ;
+
+		bool get_stat( const string&,
+			       const string&,
+			       struct stat& ) ;
+
+		void put_stat( const string&,
+			       const string&,
+			       const struct stat& ) ;
+
+	private:
+		void drop( map<string, dcache_dir>::iterator ) ;
+		void unwatch( map<string, dcache_dir>::iterator ) ;
+		void drop_stat( dcache_dir&,
+				const string& ) ;
+		void drop_parent_stat( const string& ) ;
+		void trim() ;
+
+		int ifd ;
+
+		uint64_t clock ;
+		size_t bytes ;
+
+		map<string, dcache_dir> dirs ;
+		map<int, set<string>> wds ;
+
+		boost::mutex mtx ;
+} ;
+
+
+class file_search
+{
+	//
+	// Search files for a set of words, ignoring case.  A file matches if it contains all the words.
+	//
+	// The words are built into an Aho-Corasick automaton with a full transition table, so each file is
+	// read once whatever the number of words and each byte costs a single table lookup.  Files are
+	// read and searched by a pool of threads.  Files with a null in the first 4K are treated as
+	// binary and skipped.
+	//
+	// Matching files are passed to the callback on the calling thread as they are found.  A progress
+	// callback is also called on the calling thread every 50ms with the number of files started.
+	// The search stops early if either callback returns false.
+	//
+
+	public:
+		file_search( const vector<string>& ) ;
+
+		bool run( const vector<string>&,
+			  const std::function<bool(const string&)>&,
+			  const std::function<bool(size_t)>& ) ;
+
+	private:
+		bool search_file( const string& ) ;
+
+		uint nwords ;
+
+		vector<uint> delta ;
+		vector<vector<uint>> outputs ;
+
+		unsigned char fold[ 256 ] ;
+
+		workPool pool ;
+
+		boost::mutex mtx ;
+		boost::condition cond ;
+
+		vector<string> results ;
+} ;
+
+
+class tree_node
+{
+	public:
+		tree_node( const string& s,
+			   const string& d,
+			   tree_node* p )
+		{
+			src     = s ;
+			dest    = d ;
+			parent  = p ;
+			pending = 1 ;
+			ok      = true ;
+		}
+
+		string src  ;
+		string dest ;
+
+		tree_node* parent ;
+
+		uint pending ;
+
+		bool ok ;
+} ;
+
+
+class tree_op
+{
+	//
+	// Copy or delete a directory tree using a pool of threads.
+	//
+	// Each directory is listed by its own task and each file is copied by a separate task.  File data
+	// is copied with copy_file_range(), falling back to sendfile() and then read/write, into a temporary
+	// file that is renamed to the target when complete, so an interrupted or failed copy never leaves
+	// a partly written file.  A directory is finished (attributes copied or the directory removed) only
+	// when everything under it has been done, so a delete removes directories from the bottom up.
+	//
+	// The progress callback is called on the calling thread every half second while the operation
+	// runs.  It is cancelled if the callback returns false.  Entries already processed stay copied or
+	// deleted.  Errors are returned in 'errors' to be logged by the caller.
+	//
+
+	public:
+		tree_op( bool = true,
+			 bool = false,
+			 bool = false ) ;
+
+		bool copy( const string&,
+			   const string&,
+			   const std::function<bool()>& ) ;
+
+		bool remove( const string&,
+			     const std::function<bool()>& ) ;
+
+		void status( uint64_t&,
+			     uint64_t&,
+			     string& ) ;
+
+		static void copy_attributes( const string&,
+					     const string& ) ;
+
+		bool skipped ;
+
+		vector<string> errors ;
+
+	private:
+		bool run( tree_node*,
+			  const std::function<bool()>& ) ;
+
+		void copy_dir( tree_node* ) ;
+
+		void copy_file( tree_node*,
+				const string&,
+				const string& ) ;
+
+		bool copy_data( int,
+				int,
+				bool ) ;
+
+		void delete_dir( tree_node* ) ;
+
+		void delete_files( tree_node*,
+				   const vector<string>& ) ;
+
+		void finish( tree_node* ) ;
+
+		void error( const string&,
+			    const string&,
+			    int ) ;
+
+		bool recursive ;
+		bool frepl ;
+		bool prattrs ;
+		bool deleting ;
+		bool done ;
+
+		uint64_t entries ;
+		uint64_t bytes ;
+
+		string current ;
+
+		std::deque<tree_node> nodes ;
+
+		workPool pool ;
+
+		boost::mutex mtx ;
+		boost::condition cond ;
+} ;
+
+
+class tree_entry
+{
+	public:
+		tree_entry( const string& n,
+			    const string& p,
+			    uint d,
+			    bool isdir,
+			    uint64_t sz )
+		{
+			name     = n ;
+			path     = p ;
+			depth    = d ;
+			dir      = isdir ;
+			size     = sz ;
+			loaded   = false ;
+			expanded = false ;
+		}
+
+		string name ;
+		string path ;
+
+		uint depth ;
+
+		bool dir ;
+		bool loaded ;
+		bool expanded ;
+
+		uint64_t size ;
+
+		vector<uint> children ;
+} ;
+
+
+class dir_tree
+{
+	//
+	// Directory tree for the TREE line command.  Entry 0 is the top directory.  The entries of a
+	// directory are only read when it is expanded, so the tree is shown straight away however large
+	// it is.
+	//
+	// Sizes are the space allocated to the entry and everything below it, counting hard linked files
+	// once and not crossing file systems (as du -x).  Directory sizes are added up in the background,
+	// one task per top level directory, and picked up each time the display is rebuilt.
+	//
+
+	public:
+		dir_tree() ;
+		~dir_tree() ;
+
+		bool open( const string&,
+			   string& ) ;
+
+		bool expand( uint,
+			     string& ) ;
+
+		void collapse( uint i )
+		{
+			entries[ i ].expanded = false ;
+		}
+
+		void visible( vector<uint>& ) const ;
+
+		const tree_entry& entry( uint i ) const
+		{
+			return entries[ i ] ;
+		}
+
+		string line( uint ) const ;
+
+		bool get_size( uint,
+			       uint64_t& ) ;
+
+		size_t sizes_known() ;
+
+	private:
+		bool read_children( uint,
+				    string& ) ;
+
+		uint64_t du( const string&,
+			     const struct stat& ) ;
+
+		dev_t dev ;
+
+		vector<tree_entry> entries ;
+
+		map<string, uint64_t> dsizes ;
+
+		set<pair<dev_t, ino_t>> links ;
+
+		workPool pool ;
+
+		boost::mutex mtx ;
+} ;
+
+
+enum FP_KIND
+{
+	FP_SUBSTR,
+	FP_EXACT,
+	FP_PREFIX,
+	FP_SUFFIX,
+	FP_GLOB,
+	FP_REGEX
+} ;
+
+
+class filter_pattern
+{
+	public:
+		FP_KIND kind ;
+
+		bool include ;
+		bool icase ;
+
+		string str ;
+
+		boost::regex rx ;
+} ;
+
+
+class filter_set
+{
+	//
+	// Include and exclude name filters compiled so each name is classified in one pass.
+	// A name is included if it matches all the include filters and excluded if it matches any
+	// of the exclude filters.
+	//
+	// Filters without generic characters match if the name contains the (upper case) string.
+	// Generic filters have the same meaning as the regex made by conv_regex(): * is any number of
+	// non-blank characters, ? one non-blank character and . any character.
+	//
+	// Generic filters with a single * at the start or end (or none) are checked directly as a
+	// suffix, prefix or whole name.  Other filters using only * ? and . are combined into one
+	// DFA, built as names are matched, whose states record the filters matched.  Filters with any
+	// other regex characters use their boost::regex.
+	//
+
+	public:
+		filter_set() ;
+
+		void clear() ;
+
+		void add( const string&,
+			  const boost::regex*,
+			  bool ) ;
+
+		void classify( const string&,
+			       bool&,
+			       bool& ) ;
+
+	private:
+		bool match_literal( const string&,
+				    size_t,
+				    const filter_pattern& ) const ;
+
+		uint add_state( vector<uint>& ) ;
+
+		uint next_state( uint,
+				 unsigned char ) ;
+
+		void closure( vector<uint>& ) const ;
+
+		void reset_dfa() ;
+
+		vector<filter_pattern> pats ;
+
+		vector<int> tok ;
+		vector<char> ticase ;
+		vector<uint> tbit ;
+		vector<uint> starts ;
+
+		uint64_t inc_mask ;
+		uint64_t exc_mask ;
+		uint nglobs ;
+
+		vector<vector<uint>> states ;
+		map<vector<uint>, uint> state_ids ;
+		vector<int> trans ;
+		vector<uint64_t> masks ;
+
+		unsigned char fold[ 256 ] ;
+} ;
+
+
 class pflst0a : public pApplication
 {
 	public:
@@ -63,7 +495,13 @@ class pflst0a : public pApplication
 		void setup_hotbar() ;
 		void process_hotbar() ;
 		void load_path_vector( vector<path>& ) ;
-		void load_searchList( vector<string>& ) ;
+		void read_directory( const string&,
+				     bool,
+				     vector<path>& ) ;
+		void read_dents( const string&,
+				 vector<string>&,
+				 vector<string>*,
+				 vector<string>& ) ;
 		void create_filelist1( bool = false ) ;
 		void updateFileList1() ;
 		void create_filelist2() ;
@@ -95,6 +533,13 @@ class pflst0a : public pApplication
 				       bool,
 				       bool&,
 				       bool& ) ;
+		bool   tree_progress( tree_op&,
+				      const string&,
+				      bool& ) ;
+		void   search_progress( size_t,
+					size_t,
+					const string&,
+					bool& ) ;
 		int    edit_entry( const string&,
 				   bool& ) ;
 		int    copy_entry( const string&,
@@ -119,6 +564,12 @@ class pflst0a : public pApplication
 		string expand_dir2( const string& ) ;
 		string expand_field1( const string& ) ;
 		void   browseTree( const string& ) ;
+		void   browseTree_build( const string&,
+					 dir_tree&,
+					 string&,
+					 string&,
+					 string&,
+					 string& ) ;
 		string expand_name( const string& ) ;
 		string getAppName( string ) ;
 		string getPFLName() ;
@@ -134,8 +585,7 @@ class pflst0a : public pApplication
 		void   getFileAttributes()  ;
 		void   getFilePermissions() ;
 		void   getFileUIDGID() ;
-		void   copy_file_attributes( const string&,
-					     const string& ) ;
+		string format_time( time_t ) ;
 
 		void   set_filter_i( const string&,
 				     bool = false ) ;
@@ -144,7 +594,7 @@ class pflst0a : public pApplication
 
 		void   set_filter_x( const string&,
 				     bool = false ) ;
-		bool   match_filter_x( const string& ) ;
+		bool   match_filters( const string& ) ;
 		void   clear_filter_x() ;
 
 		void   set_filter( const string&,
@@ -152,9 +602,7 @@ class pflst0a : public pApplication
 				   map<string, boost::regex>&,
 				   bool ) ;
 
-		void   execute_cmd( int&,
-				    const string&,
-				    vector<string>& ) ;
+		void   compile_filters() ;
 
 		void   set_search( const string& ) ;
 		void   clear_search() ;
@@ -263,7 +711,7 @@ class pflst0a : public pApplication
 		int    action_Block_View( const string& ) ;
 
 		set<string> searchList ;
-		set<string> excludeList ;
+		unordered_set<string> excludeList ;
 		boost::circular_buffer<string> pnames ;
 
 		bool   useList ;
@@ -303,6 +751,7 @@ class pflst0a : public pApplication
 		bool   rebuild1 ;
 		bool   rebuild2 ;
 		bool   initsort ;
+		bool   showacc  ;
 		bool   affull   ;
 		bool   pvalid   ;
 		bool   stats    ;
@@ -373,12 +822,21 @@ class pflst0a : public pApplication
 
 		struct stat results ;
 
+		static dir_cache Global_dir_cache ;
+
+		map<uid_t, string> owner_cache ;
+		map<gid_t, string> group_cache ;
+		map<time_t, string> date_cache ;
+
 		vector<string> filter_i ;
 		map<string, boost::regex> filter_i_regex ;
 
 		vector<string> filter_x ;
 		map<string, boost::regex> filter_x_regex ;
 
+		filter_set cfilters ;
+		bool filters_ok ;
+
 		vector<string> search ;
 
 		stack<string> scrnames ;
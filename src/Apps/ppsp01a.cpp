@@ -355,7 +355,6 @@ void ppsp01a::application()
 
 void ppsp01a::show_log( const string& fileName )
 {
-	int fsize ;
 	uint t ;
 
 	colsOn = false ;
@@ -403,9 +402,6 @@ void ppsp01a::show_log( const string& fileName )
 	Xon          = false ;
 	msg          = "" ;
 
-	fsize = 0  ;
-	file_has_changed( fileName, fsize ) ;
-
 	while ( true )
 	{
 		zcol1 = d2ds( startCol-47, 5 ) ;
@@ -418,7 +414,8 @@ void ppsp01a::show_log( const string& fileName )
 		if ( is_term_resized( zscreend+2, zscreenw ) )
 		{
 			term_resize() ;
-			read_file( fileName ) ;
+			data.front() = centre( " Top of Log ", zareaw, '*' ) ;
+			data.back()  = centre( " Bottom of Log ", zareaw, '*' ) ;
 			fill_dynamic_area() ;
 			continue ;
 		}
@@ -432,12 +429,12 @@ void ppsp01a::show_log( const string& fileName )
 		w3    = word( zcmd, 3 ) ;
 		Rest  = subword( zcmd, 2 ) ;
 
-		if ( file_has_changed( fileName, fsize ) )
+		if ( file_has_changed( fileName ) )
 		{
-			read_file( fileName ) ;
-			if ( ffilter != "" ) { find_lines( ffilter ) ; }
+			t = tail_file( fileName ) ;
+			if ( ffilter != "" ) { find_lines( ffilter, t ) ; }
 			rebuildZAREA = true ;
-			set_excludes() ;
+			set_excludes( t ) ;
 		}
 
 		if ( w1 == "" )
@@ -643,63 +640,130 @@ void ppsp01a::show_log( const string& fileName )
 
 void ppsp01a::read_file( const string& fileName )
 {
-	string t ;
+	//
+	// Read the whole log.  Exclude flags for existing lines are kept.
+	//
+
+	data.clear() ;
+
+	data.push_back( centre( " Top of Log ", zareaw, '*' ) ) ;
+	data.push_back( centre( " Bottom of Log ", zareaw, '*' ) ) ;
+
+	maxLines = data.size() ;
+	maxCol   = 1     ;
+	logoff   = 0     ;
+	logpart  = false ;
+	loghdr   = ""    ;
+
+	tail_file( fileName ) ;
+}
+
+
+uint ppsp01a::tail_file( const string& fileName )
+{
+	//
+	// Add lines appended to the log since it was last read, starting at byte offset logoff.
+	// Return the index of the first new line so excludes and finds need only be applied to those.
+	//
+	// If the file has been replaced (log rotation) or truncated, start again from the beginning.
+	// A last line without a newline is shown but read again next time as it may not be complete.
+	// Exclude flags from first onwards are reset as those entries were the partial line and the
+	// Bottom of Log line, so the caller must apply excludes and finds again from first.
+	//
+	// Continuation lines (no date/time/module/task header) are given the header of the
+	// last header line.
+	//
+
+	uint first ;
+
 	string inLine ;
 
+	struct stat results ;
+
+	if ( stat( fileName.c_str(), &results ) != 0 )
+	{
+		return maxLines - 1 ;
+	}
+
+	if ( logoff > 0 && ( results.st_ino != loginode || results.st_dev != logdev || results.st_size < logoff ) )
+	{
+		data.erase( data.begin() + 1, data.end() - 1 ) ;
+		excluded.clear() ;
+		maxCol  = 1     ;
+		logoff  = 0     ;
+		logpart = false ;
+		loghdr  = ""    ;
+	}
+
+	loginode = results.st_ino ;
+	logdev   = results.st_dev ;
+	logsize  = results.st_size ;
+
 	std::ifstream fin( fileName.c_str() ) ;
 
-	data.clear() ;
+	data.pop_back() ;
+	if ( logpart )
+	{
+		data.pop_back() ;
+		logpart = false ;
+	}
 
-	data.push_back( centre( " Top of Log ", zareaw, '*' ) ) ;
-	excluded.push_back( false ) ;
+	first = data.size() ;
 
+	fin.seekg( logoff ) ;
 	while ( getline( fin, inLine ) )
 	{
+		if ( fin.eof() )
+		{
+			logpart = true ;
+		}
+		else
+		{
+			logoff += inLine.size() + 1 ;
+		}
 		if ( inLine.size() < 47 || ( inLine[ 4 ] != '-' && inLine[ 8 ] != '-' ) )
 		{
-			for ( uint i = data.size() - 1 ; i > 0 ; --i )
-			{
-				if ( data[ i ].size() < 47 || ( data[ i ][ 4 ] != '-' && data[ i ][ 8 ] != '-' ) ) { continue ; }
-				t = data[ i ] ;
-				break ;
-			}
-			inLine = t.substr( 0, 47 ) + inLine ;
+			inLine = loghdr.substr( 0, 47 ) + inLine ;
 		}
-		data.push_back( inLine )  ;
-		excluded.push_back( false ) ;
-		if ( maxCol < inLine.size() ) { maxCol = inLine.size() ; }
+		else
+		{
+			loghdr = inLine.substr( 0, 47 ) ;
+		}
+		if ( maxCol <= inLine.size() ) { maxCol = inLine.size() + 1 ; }
+		data.push_back( inLine ) ;
 	}
 
-	++maxCol ;
 	data.push_back( centre( " Bottom of Log ", zareaw, '*' ) ) ;
-	excluded.push_back( false ) ;
 	maxLines = data.size() ;
 
+	excluded.resize( maxLines ) ;
+	fill( excluded.begin() + first, excluded.end(), false ) ;
+
 	fin.close() ;
+
+	return first ;
 }
 
 
-bool ppsp01a::file_has_changed( const string& fileName,
-				int& fsize )
+bool ppsp01a::file_has_changed( const string& fileName )
 {
-	int temp = fsize ;
-
 	struct stat results ;
 
-	lstat( fileName.c_str(), &results ) ;
-
-	fsize = results.st_size ;
+	if ( stat( fileName.c_str(), &results ) != 0 )
+	{
+		return false ;
+	}
 
-	return ( temp != fsize ) ;
+	return ( results.st_size != logsize || results.st_ino != loginode || results.st_dev != logdev ) ;
 }
 
 
-void ppsp01a::set_excludes()
+void ppsp01a::set_excludes( uint first )
 {
 	int j ;
 	char c ;
 
-	for ( uint i = 1 ; i < maxLines - 1 ; ++i )
+	for ( uint i = first ; i < maxLines - 1 ; ++i )
 	{
 		const string& ln = data[ i ] ;
 		if ( task > 0 )
@@ -756,10 +820,11 @@ void ppsp01a::exclude_all()
 }
 
 
-void ppsp01a::find_lines( string fnd )
+void ppsp01a::find_lines( string fnd,
+			    uint first )
 {
 	iupper( fnd ) ;
-	for ( uint i = 1 ; i < ( maxLines - 1 ) ; ++i )
+	for ( uint i = first ; i < ( maxLines - 1 ) ; ++i )
 	{
 		if ( upper( data[ i ] ).find( fnd ) == string::npos )
 		{
@@ -7594,73 +7659,16 @@ void ppsp01a::execute_cmd( int& rc,
 	// Execute a command and place the output in the
 	// results vector.
 	//
-	// Redirect STDERR/STOUT to pipes to get errors from the command.  Restore on return.
-	//
-
-	string line ;
-
-	int fd1 ;
-	int fd2 ;
-
-	int my_pipe1[ 2 ] ;
-	int my_pipe2[ 2 ] ;
-
-	char buffer[ 8192 ] ;
 
 	results.clear() ;
 
-	if ( pipe2( my_pipe1, O_NONBLOCK ) == -1 )
-	{
-		vreplace( "PSUERR", strerror( errno ) ) ;
-		setmsg( "PSUT015C" ) ;
-		return ;
-	}
-
-	if ( pipe2( my_pipe2, O_NONBLOCK ) == -1 )
-	{
-		vreplace( "PSUERR", strerror( errno ) ) ;
-		close( my_pipe1[ 0 ] ) ;
-		close( my_pipe1[ 1 ] ) ;
-		setmsg( "PSUT015C" ) ;
-		return ;
-	}
-
-	fd1 = dup( STDERR_FILENO ) ;
-	dup2( my_pipe1[ 1 ], STDERR_FILENO ) ;
-
-	fd2 = dup( STDOUT_FILENO ) ;
-	dup2( my_pipe2[ 1 ], STDOUT_FILENO ) ;
+	rc = run_command( cmd, results ) ;
 
-	FILE* pipe { popen( cmd.c_str(), "r" ) } ;
-
-	if ( !pipe )
+	if ( rc == -1 )
 	{
 		rc = 3 ;
 		setmsg( "PSUT011E" ) ;
-		llog( "E", "POPEN failed.  Command string size="<< cmd.size() <<endl ) ;
-		return ;
-	}
-
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
-	{
-		line = buffer ;
-		if ( line != "" && line.back() == 0x0a )
-		{
-			line.pop_back() ;
-		}
-		results.push_back( line ) ;
+		llog( "E", "Command " << cmd << " could not be started." << endl ) ;
 	}
-
-	rc = WEXITSTATUS( pclose( pipe ) ) ;
-
-	fflush( stdout ) ;
-	close( my_pipe2[ 0 ] ) ;
-	close( my_pipe2[ 1 ] ) ;
-	dup2( fd2, STDOUT_FILENO ) ;
-
-	fflush( stderr ) ;
-	close( my_pipe1[ 0 ] ) ;
-	close( my_pipe1[ 1 ] ) ;
-	dup2( fd1, STDERR_FILENO ) ;
 }
 
@@ -156,12 +156,13 @@ class ppsp01a : public pApplication
 		void show_log( const string& ) ;
 
 		void read_file( const string& ) ;
-		bool file_has_changed( const string&,
-				       int& ) ;
+		uint tail_file( const string& ) ;
+		bool file_has_changed( const string& ) ;
 		void fill_dynamic_area() ;
-		void set_excludes()      ;
+		void set_excludes( uint = 1 ) ;
 		void exclude_all()       ;
-		void find_lines( string );
+		void find_lines( string,
+				 uint = 1 ) ;
 
 		string getColumnLine( int = 0 ) ;
 
@@ -172,6 +173,13 @@ class ppsp01a : public pApplication
 		vector<string> data     ;
 		vector<bool>   excluded ;
 
+		off_t  logoff   ;
+		off_t  logsize  ;
+		ino_t  loginode ;
+		dev_t  logdev   ;
+		bool   logpart  ;
+		string loghdr   ;
+
 		string zcol1   ;
 		string zrow1   ;
 		string zrow2   ;
@@ -24,7 +24,7 @@
 /*                                                                          */
 /* Run a shell script and direct output to the spool.                       */
 /* Functions invoked by this procedure, do not have access to lspf services */
-/* since they are run using popen.                                          */
+/* since they are run using posix_spawn.                                    */
 /*                                                                          */
 /****************************************************************************/
 
@@ -56,15 +56,14 @@ void pshell0::application()
 void pshell0::run_command( string cmd )
 {
 	//
-	// Run shell command and detach from the terminal (unless pipes are used).
+	// Run shell command and detach from the terminal.  Output is written to the spool as it
+	// arrives.  The command is stopped if the application is interrupted.
 	//
 	// Command goes to fname1.
 	// Output goes to fname2.
 	// Errors go to fname3.
 	//
 
-	string file ;
-
 	string t = word( cmd, 1 ) ;
 
 	string fname1 = get_spool_filename( t, "input" ) ;
@@ -79,34 +78,32 @@ void pshell0::run_command( string cmd )
 	}
 	fout.close() ;
 
-	char buffer[2560] ;
-
-	std::ofstream of ;
+	std::ofstream of2 ;
+	std::ofstream of3 ;
 
-	if ( cmd.find( '|' ) == string::npos ) { cmd += " </dev/null 2> "+ fname3 ; }
-	else                                   { cmd += " 2> "+ fname3            ; }
+	subProcess proc ;
 
-	FILE* pipe{ popen( cmd.c_str(), "r" ) } ;
-
-	if ( !pipe )
+	if ( !proc.start( cmd ) )
 	{
-		llog( "E", "POPEN failed.  Command string size="<< cmd.size() <<endl ) ;
+		llog( "E", "Command " << cmd << " could not be started.  " << strerror( proc.error() ) << endl ) ;
 		return ;
 	}
 
-	of.open( fname2 ) ;
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
-	{
-		file = buffer ;
-		if ( file != "" && file.back() == 0x0a )
+	of2.open( fname2 ) ;
+	of3.open( fname3 ) ;
+
+	interrupted = false ;
+	proc.run( [ &of2, &of3 ]( const string& line, bool e )
 		{
-			file.pop_back() ;
-		}
-		of << file << endl ;
-	}
-	pclose( pipe ) ;
+			( ( e ) ? of3 : of2 ) << line << endl ;
+			return true ;
+		}, 0, [ this ]()
+		{
+			return interrupted ;
+		} ) ;
 
-	of.close() ;
+	of2.close() ;
+	of3.close() ;
 }
 
 
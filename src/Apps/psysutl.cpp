@@ -44,6 +44,8 @@
 //#define WITH_NETHOGS
 
 #include <functional>
+#include <atomic>
+#include <memory>
 #include <net/if.h>
 
 #include <sys/stat.h>
@@ -61,6 +63,7 @@
 #include <pwd.h>
 
 #include <systemd/sd-bus.h>
+#include <systemd/sd-journal.h>
 #include <boost/scope_exit.hpp>
 #include <boost/regex.hpp>
 
@@ -73,6 +76,14 @@
 #include "../lspfall.h"
 #include "psysutl.h"
 
+#define N_RED      0x03
+#define N_GREEN    0x04
+#define N_YELLOW   0x05
+#define N_BLUE     0x06
+#define N_MAGENTA  0x07
+#define N_TURQ     0x08
+#define N_WHITE    0x09
+
 using namespace boost ;
 using namespace boost::filesystem ;
 
@@ -83,12 +94,16 @@ map<int, Update>psysutl::row_updates ;
 boost::mutex psysutl::mtxg ;
 bool psysutl::nethogs_running = false ;
 
+sys_sampler psysutl::sysmon ;
+
 LSPF_APP_MAKER( psysutl )
 
 
 psysutl::psysutl()
 {
 	STANDARD_HEADER( "System utilities to show system information, mounts, disks, etc..", "1.0.0" )
+
+	subscribed = false ;
 }
 
 
@@ -235,7 +250,7 @@ void psysutl::showSystemUsage()
 {
 	//
 	// Show system usage.
-	// Collector runs in a separate task to read procfs every 1s.
+	// Data comes from the shared system sampler, which reads procfs every 1s.
 	//
 
 	string zcmd ;
@@ -271,32 +286,25 @@ void psysutl::showSystemUsage()
 	string tguest ;
 	string tgnice ;
 
+	string cpuavg1 ;
+	string cpuavg5 ;
+
 	int ztdtop  = 1 ;
 	int ztdsels = 0 ;
 
-	coll_status = CL_STOPPED ;
-	collector_a = true ;
-
-	control( "ABENDRTN", static_cast<void (pApplication::*)()>(&psysutl::showSystemUsage_cleanup) ) ;
-
-	bThread = new boost::thread( &psysutl::showSystemUsage_collector, this ) ;
-
-	while ( coll_status != CL_RUNNING )
-	{
-		boost::this_thread::sleep_for( boost::chrono::milliseconds( 50 ) ) ;
-	}
+	sysmon_subscribe() ;
 
 	string sel ;
 
 	const string vlist1 = "ZTDTOP ZTDSELS" ;
 	const string vlist2 = "CPU USER NICE SYSTEM IDLE IOWAIT IRQ SOFTIRQ STEAL GUEST GNICE" ;
 	const string vlist3 = "TCPU TUSER TNICE TSYSTEM TIDLE TIOWAIT TIRQ TSOFTIRQ TSTEAL TGUEST TGNICE" ;
-	const string vlist4 = "ZCMD SEL PSWPIN PSWPOUT PGIN PGOUT" ;
+	const string vlist4 = "ZCMD SEL PSWPIN PSWPOUT PGIN PGOUT CPUAVG1 CPUAVG5" ;
 
 	vdefine( vlist1, &ztdtop, &ztdsels ) ;
 	vdefine( vlist2, &cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal, &guest, &gnice ) ;
 	vdefine( vlist3, &tcpu, &tuser, &tnice, &tsystem, &tidle, &tiowait, &tirq, &tsoftirq, &tsteal, &tguest, &tgnice ) ;
-	vdefine( vlist4, &zcmd, &sel, &pswpin, &pswpout, &pgin, &pgout ) ;
+	vdefine( vlist4, &zcmd, &sel, &pswpin, &pswpout, &pgin, &pgout, &cpuavg1, &cpuavg5 ) ;
 
 	tabName = "USG" + d2ds( taskid(), 5 ) ;
 
@@ -326,7 +334,9 @@ void psysutl::showSystemUsage()
 			       tsoftirq,
 			       tsteal,
 			       tguest,
-			       tgnice ) ;
+			       tgnice,
+			       cpuavg1,
+			       cpuavg5 ) ;
 
 	while ( true )
 	{
@@ -371,44 +381,20 @@ void psysutl::showSystemUsage()
 					       tsoftirq,
 					       tsteal,
 					       tguest,
-					       tgnice ) ;
+					       tgnice,
+					       cpuavg1,
+					       cpuavg5 ) ;
 		}
 		zcmd = "" ;
 	}
 
-	coll_status = CL_STOPPING ;
-	cond_collector.notify_all() ;
-	while ( coll_status != CL_STOPPED )
-	{
-		boost::this_thread::sleep_for( boost::chrono::milliseconds( 5 ) ) ;
-	}
-
-	delete bThread ;
+	sysmon_unsubscribe() ;
 
 	tbend( tabName ) ;
 	vdelete( vlist1, vlist2, vlist3, vlist4 ) ;
 }
 
 
-void psysutl::showSystemUsage_cleanup()
-{
-	//
-	// Stop the background data collector when an abend in the main thread occurs
-	// or we'll bring down the whole of lspf.
-	//
-
-	if ( coll_status != CL_STOPPED )
-	{
-		coll_status = CL_STOPPING ;
-		cond_collector.notify_all() ;
-		while ( coll_status != CL_STOPPED )
-		{
-			boost::this_thread::sleep_for( boost::chrono::milliseconds( 5 ) ) ;
-		}
-	}
-}
-
-
 void psysutl::showSystemUsage_build( const string& tabName,
 				     string& pswpin,
 				     string& pswpout,
@@ -435,105 +421,54 @@ void psysutl::showSystemUsage_build( const string& tabName,
 				     string& tsoftirq,
 				     string& tsteal,
 				     string& tguest,
-				     string& tgnice )
+				     string& tgnice,
+				     string& cpuavg1,
+				     string& cpuavg5 )
 {
 	//
-	// Build the lspf table with the individual CPU usage stats.
+	// Build the lspf table with the individual CPU usage stats from the last two samples.
+	// Paging rates are per second over the last interval.  The CPU averages use the
+	// sample history, so cover less time if the sampler has not been running that long.
 	//
 
 	long clktck = sysconf( _SC_CLK_TCK ) ;
 
-	vector<cpu_dtls> cpu_details1 ;
-	vector<cpu_dtls> cpu_details2 ;
+	float secs ;
 
-	int pgpgin1  = 0 ;
-	int pgpgin2  = 0 ;
-	int pgpgout1 = 0 ;
-	int pgpgout2 = 0 ;
+	uint n = sysmon.history() ;
 
-	int pswpin1  = 0 ;
-	int pswpin2  = 0 ;
-	int pswpout1 = 0 ;
-	int pswpout2 = 0 ;
+	auto t2 = sysmon.get( 0 ) ;
+	auto t1 = sysmon.get( ( n > 1 ) ? 1 : 0 ) ;
 
-	boost::lock_guard<boost::mutex> lock( mtx ) ;
+	auto a1 = sysmon.get( min( n - 1, 60u ) ) ;
+	auto a5 = sysmon.get( min( n - 1, 300u ) ) ;
 
-	for ( size_t i = 0 ; i < pstat_details1.size() ; ++i )
-	{
-		const string* t1 ;
-		const string* t2 ;
-		if ( collector_a )
-		{
-			t1 = &pstat_details1[ i ] ;
-			t2 = &pstat_details2[ i ] ;
-		}
-		else
-		{
-			t2 = &pstat_details1[ i ] ;
-			t1 = &pstat_details2[ i ] ;
-		}
-		if ( t1->compare( 0, 3, "cpu" ) == 0 )
-		{
-			cpu_details1.push_back( cpu_dtls( *t1 ) ) ;
-			cpu_details2.push_back( cpu_dtls( *t2 ) ) ;
-		}
-	}
+	if ( !t2 || !t1 || !a1 || !a5 ) { return ; }
 
-	for ( size_t i = 0 ; i < pvmstat_details1.size() ; ++i )
-	{
-		const string* t1 ;
-		const string* t2 ;
-		if ( collector_a )
-		{
-			t1 = &pvmstat_details1[ i ] ;
-			t2 = &pvmstat_details2[ i ] ;
-		}
-		else
-		{
-			t2 = &pvmstat_details1[ i ] ;
-			t1 = &pvmstat_details2[ i ] ;
-		}
-		if ( t1->compare( 0, 6, "pgpgin" ) == 0 )
-		{
-			pgpgin1 = ds2d( word( *t1, 2 ) ) ;
-			pgpgin2 = ds2d( word( *t2, 2 ) ) ;
-		}
-		else if ( t1->compare( 0, 7, "pgpgout" ) == 0 )
-		{
-			pgpgout1 = ds2d( word( *t1, 2 ) ) ;
-			pgpgout2 = ds2d( word( *t2, 2 ) ) ;
-		}
-		else if ( t1->compare( 0, 6, "pswpin" ) == 0 )
-		{
-			pswpin1 = ds2d( word( *t1, 2 ) ) ;
-			pswpin2 = ds2d( word( *t2, 2 ) ) ;
-		}
-		else if ( t1->compare( 0, 7, "pswpout" ) == 0 )
-		{
-			pswpout1 = ds2d( word( *t1, 2 ) ) ;
-			pswpout2 = ds2d( word( *t2, 2 ) ) ;
-		}
-	}
+	secs = std::chrono::duration<float>( t2->time - t1->time ).count() ;
+	if ( secs <= 0 ) { secs = 1 ; }
+
+	pswpin  = to_string( uint64_t( ( t2->pswpin - t1->pswpin ) / secs + 0.5 ) ) ;
+	pswpout = to_string( uint64_t( ( t2->pswpout - t1->pswpout ) / secs + 0.5 ) ) ;
+	pgin    = to_string( uint64_t( ( t2->pgpgin - t1->pgpgin ) / secs + 0.5 ) ) ;
+	pgout   = to_string( uint64_t( ( t2->pgpgout - t1->pgpgout ) / secs + 0.5 ) ) ;
 
-	pswpin  = to_string( pswpin2 - pswpin1 ) ;
-	pswpout = to_string( pswpout2 - pswpout1 ) ;
-	pgin    = to_string( pgpgin2 - pgpgin1 ) ;
-	pgout   = to_string( pgpgout2 - pgpgout1 ) ;
+	cpuavg1 = ( a1 == t2 ) ? "" : ( t2->cpus[ 0 ] - a1->cpus[ 0 ] ).get_cpu_pcent() ;
+	cpuavg5 = ( a5 == t2 ) ? "" : ( t2->cpus[ 0 ] - a5->cpus[ 0 ] ).get_cpu_pcent() ;
 
-	cpu_dtls& t2   = cpu_details2[ 0 ] ;
-	cpu_dtls delta = cpu_details2[ 0 ] - cpu_details1[ 0 ] ;
+	const cpu_dtls& c2 = t2->cpus[ 0 ] ;
 
-	cpu     = t2.get_cpu( clktck ) ;
-	idle    = t2.get_idle( clktck ) ;
-	nice    = addCommas( to_string( t2.nice / clktck ) ) ;
-	system  = addCommas( to_string( t2.system / clktck ) ) ;
-	idle    = addCommas( to_string( t2.idle / clktck ) ) ;
-	iowait  = addCommas( to_string( t2.iowait / clktck ) ) ;
-	irq     = addCommas( to_string( t2.irq / clktck ) ) ;
-	softirq = addCommas( to_string( t2.softirq / clktck ) ) ;
-	steal   = addCommas( to_string( t2.steal / clktck ) ) ;
-	guest   = addCommas( to_string( t2.guest / clktck ) ) ;
-	gnice   = addCommas( to_string( t2.gnice / clktck ) ) ;
+	cpu     = c2.get_cpu( clktck ) ;
+	user    = addCommas( to_string( c2.user / clktck ) ) ;
+	nice    = addCommas( to_string( c2.nice / clktck ) ) ;
+	system  = addCommas( to_string( c2.system / clktck ) ) ;
+	idle    = addCommas( to_string( c2.idle / clktck ) ) ;
+	iowait  = addCommas( to_string( c2.iowait / clktck ) ) ;
+	irq     = addCommas( to_string( c2.irq / clktck ) ) ;
+	softirq = addCommas( to_string( c2.softirq / clktck ) ) ;
+	steal   = addCommas( to_string( c2.steal / clktck ) ) ;
+	guest   = addCommas( to_string( c2.guest / clktck ) ) ;
+	gnice   = addCommas( to_string( c2.gnice / clktck ) ) ;
 
 	tbcreate( tabName,
 		  "",
@@ -541,9 +476,10 @@ void psysutl::showSystemUsage_build( const string& tabName,
 		  NOWRITE,
 		  REPLACE ) ;
 
-	for ( size_t i = 0 ; i < cpu_details1.size() ; ++i )
+	for ( size_t i = 0 ; i < t2->cpus.size() && i < t1->cpus.size() ; ++i )
 	{
-		cpu_dtls delta = cpu_details2[ i ] - cpu_details1[ i ] ;
+		cpu_dtls delta = t2->cpus[ i ] - t1->cpus[ i ] ;
+		if ( delta.total == 0 ) { delta = t2->cpus[ i ] ; }
 		tcpu     = delta.get_cpu_pcent() ;
 		tuser    = delta.get_user_pcent() ;
 		tnice    = delta.get_nice_pcent() ;
@@ -561,97 +497,213 @@ void psysutl::showSystemUsage_build( const string& tabName,
 }
 
 
-void psysutl::showSystemUsage_collector()
+void psysutl::sysmon_subscribe()
 {
 	//
-	// This method runs in the background to read /proc/stat and /proc/vmstat data every 1s.
+	// Start using the shared system sampler.  The sampler thread runs while there are
+	// subscribers so make sure it is stopped if the application abends, or we'll bring
+	// down the whole of lspf when the module is unloaded.
 	//
 
-	boost::mutex mutex ;
+	if ( !subscribed )
+	{
+		control( "ABENDRTN", static_cast<void (pApplication::*)()>(&psysutl::sysmon_unsubscribe) ) ;
+		sysmon.subscribe() ;
+		subscribed = true ;
+	}
+}
 
-	int i = 9 ;
 
-	showSystemUsage_stats( pstat_details1 ) ;
-	showSystemUsage_vmstats( pvmstat_details1 ) ;
+void psysutl::sysmon_unsubscribe()
+{
+	//
+	// Stop using the shared system sampler.  Also used as the abend routine.
+	//
 
-	boost::this_thread::sleep_for( boost::chrono::milliseconds( 150 ) ) ;
+	if ( subscribed )
+	{
+		sysmon.unsubscribe() ;
+		subscribed = false ;
+	}
+}
 
-	showSystemUsage_stats( pstat_details2 ) ;
-	showSystemUsage_vmstats( pvmstat_details2 ) ;
 
-	coll_status = CL_RUNNING ;
 
-	while ( coll_status == CL_RUNNING )
+/**************************************************************************************************************/
+/**********************************            SYSTEM SAMPLER               ***********************************/
+/**************************************************************************************************************/
+
+sys_sampler::sys_sampler()
+{
+	count       = 0 ;
+	thread      = nullptr ;
+	subscribers = 0 ;
+	stopping    = false ;
+}
+
+
+void sys_sampler::subscribe()
+{
+	//
+	// Add a subscriber.  The first one takes a sample so there is data straight away,
+	// then starts the sampler thread.
+	//
+
+	boost::lock_guard<boost::mutex> lock( ctl ) ;
+
+	if ( ++subscribers == 1 )
 	{
-		boost::mutex::scoped_lock lk( mutex ) ;
-		cond_collector.wait_for( lk, boost::chrono::milliseconds( 100 ) ) ;
-		lk.unlock() ;
-		++i ;
-		if ( i == 1 )
-		{
-			boost::lock_guard<boost::mutex> lock( mtx ) ;
-			if ( collector_a )
-			{
-				collector_a = false ;
-				showSystemUsage_stats( pstat_details1 ) ;
-				showSystemUsage_vmstats( pvmstat_details1 ) ;
-			}
-			else
-			{
-				collector_a = true ;
-				showSystemUsage_stats( pstat_details2 ) ;
-				showSystemUsage_vmstats( pvmstat_details2 ) ;
-			}
-		}
-		else if ( i == 10 )
-		{
-			i = 0 ;
-		}
+		take_sample() ;
+		stopping = false ;
+		thread   = new boost::thread( &sys_sampler::run, this ) ;
 	}
-
-	coll_status = CL_STOPPED ;
 }
 
 
-void psysutl::showSystemUsage_stats( vector<string>& v )
+void sys_sampler::unsubscribe()
 {
 	//
-	// Get proc stats data.
+	// Remove a subscriber.  The last one stops the sampler thread and clears the history,
+	// as it will not be continuous with samples taken after a restart.
 	//
 
-	string line ;
+	boost::lock_guard<boost::mutex> lock( ctl ) ;
 
-	v.clear() ;
+	if ( subscribers == 0 || --subscribers > 0 ) { return ; }
 
-	std::ifstream if_procstats( _PATH_PROC_STAT ) ;
+	{
+		boost::lock_guard<boost::mutex> lk( mtx ) ;
+		stopping = true ;
+	}
+
+	cond.notify_all() ;
+	thread->join() ;
+
+	delete thread ;
+	thread = nullptr ;
 
-	while ( getline( if_procstats, line ) )
+	count = 0 ;
+	for ( auto& s : ring )
 	{
-		v.push_back( line ) ;
+		std::atomic_store( &s, std::shared_ptr<const sys_sample>() ) ;
 	}
+}
 
-	if_procstats.close() ;
+
+std::shared_ptr<const sys_sample> sys_sampler::get( uint n ) const
+{
+	//
+	// Return the sample taken n ticks ago (0 is the latest), or null if there is none.
+	//
+	// Samples are not changed once added so the caller can keep using it without a lock
+	// while the sampler continues.
+	//
+
+	uint64_t c = count ;
+
+	if ( n >= c || n >= SS_HISTORY - 1 )
+	{
+		return nullptr ;
+	}
+
+	return std::atomic_load( &ring[ ( c - 1 - n ) % SS_HISTORY ] ) ;
+}
+
+
+uint sys_sampler::history() const
+{
+	//
+	// Return the number of samples that can be retrieved with get().
+	//
+
+	uint64_t c = count ;
+
+	return min( c, uint64_t( SS_HISTORY - 1 ) ) ;
+}
+
+
+void sys_sampler::run()
+{
+	//
+	// Sampler thread.  Take a sample every 1s until the last subscriber has gone.
+	//
+
+	auto next = boost::chrono::steady_clock::now() ;
+
+	boost::unique_lock<boost::mutex> lk( mtx ) ;
+
+	while ( true )
+	{
+		next += boost::chrono::milliseconds( 1000 ) ;
+		while ( !stopping && cond.wait_until( lk, next ) != boost::cv_status::timeout ) {}
+		if ( stopping ) { break ; }
+		lk.unlock() ;
+		take_sample() ;
+		lk.lock() ;
+	}
 }
 
 
-void psysutl::showSystemUsage_vmstats( vector<string>& v )
+void sys_sampler::take_sample()
 {
 	//
-	// Get proc vmstats data.
+	// Read /proc/stat, /proc/vmstat, /proc/net/dev and /proc/diskstats into a new sample
+	// and add it to the history, replacing the oldest.
 	//
 
 	string line ;
+	string name ;
 
-	v.clear() ;
+	uint64_t v ;
 
-	std::ifstream if_pvmstats( _PATH_PROC_VMSTAT ) ;
+	auto s = std::make_shared<sys_sample>() ;
+
+	s->time = std::chrono::steady_clock::now() ;
 
-	while ( getline( if_pvmstats, line ) )
+	std::ifstream if_procstats( _PATH_PROC_STAT ) ;
+	while ( getline( if_procstats, line ) && line.compare( 0, 3, "cpu" ) == 0 )
 	{
-		v.push_back( line ) ;
+		s->cpus.push_back( cpu_dtls( line ) ) ;
 	}
+	if_procstats.close() ;
 
+	std::ifstream if_pvmstats( _PATH_PROC_VMSTAT ) ;
+	while ( if_pvmstats >> name >> v )
+	{
+		if      ( name == "pgpgin"  ) { s->pgpgin  = v ; }
+		else if ( name == "pgpgout" ) { s->pgpgout = v ; }
+		else if ( name == "pswpin"  ) { s->pswpin  = v ; }
+		else if ( name == "pswpout" ) { s->pswpout = v ; }
+	}
 	if_pvmstats.close() ;
+
+	std::ifstream if_devnet( _PATH_PROC_NETDEV ) ;
+	getline( if_devnet, line ) ;
+	getline( if_devnet, line ) ;
+	while ( getline( if_devnet, line ) )
+	{
+		size_t p = line.find( ':' ) ;
+		if ( p == string::npos ) { continue ; }
+		name = strip( line.substr( 0, p ) ) ;
+		stringstream ss( line.substr( p + 1 ) ) ;
+		auto& f = s->net[ name ] ;
+		while ( ss >> v ) { f.push_back( v ) ; }
+	}
+	if_devnet.close() ;
+
+	std::ifstream if_diskstats( _PATH_PROC_DISKSTATS ) ;
+	while ( getline( if_diskstats, line ) )
+	{
+		stringstream ss( line ) ;
+		vector<uint64_t> f( 2 ) ;
+		if ( !( ss >> f[ 0 ] >> f[ 1 ] >> name ) ) { continue ; }
+		while ( ss >> v ) { f.push_back( v ) ; }
+		s->disks[ name ] = std::move( f ) ;
+	}
+	if_diskstats.close() ;
+
+	std::atomic_store( &ring[ count % SS_HISTORY ], std::shared_ptr<const sys_sample>( s ) ) ;
+	++count ;
 }
 
 
@@ -1600,80 +1652,65 @@ void psysutl::showDisks_unmount( const string& partition )
 void psysutl::showDEV_diskstats( const string& dev )
 {
 	//
-	// Show /proc/diskstats for device dev.
+	// Show /proc/diskstats for device dev from the latest system sample, and the
+	// read/write rates over the last interval (sectors are always 512 bytes).
+	// There is always a sample once subscribed.
 	//
 
 	string dev1 = dev.substr( dev.find_last_of( '/' ) + 1 ) ;
 
-	string line ;
-	string ignore ;
+	float secs ;
 
-	string dstats1 ;
-	string dstats2 ;
 	string dstats3 = dev ;
-	string dstats4 ;
-	string dstats5 ;
-	string dstats6 ;
-	string dstats7 ;
-	string dstats8 ;
-	string dstats9 ;
-
-	string dstats10 ;
-	string dstats11 ;
-	string dstats12 ;
-	string dstats13 ;
-	string dstats14 ;
-	string dstats15 ;
-	string dstats16 ;
-	string dstats17 ;
-	string dstats18 ;
-	string dstats19 ;
-	string dstats20 ;
+	string drater ;
+	string dratew ;
+
+	vector<string> dstats( 21 ) ;
 
 	const string vlist1 = "DSTATS1  DSTATS2  DSTATS3  DSTATS4  DSTATS5  DSTATS6  DSTATS7  DSTATS8  DSTATS9  DSTATS10" ;
 	const string vlist2 = "DSTATS11 DSTATS12 DSTATS13 DSTATS14 DSTATS15 DSTATS16 DSTATS17 DSTATS18 DSTATS19 DSTATS20" ;
+	const string vlist3 = "DRATER DRATEW" ;
 
-	vdefine( vlist1, &dstats1, &dstats2, &dstats3, &dstats4, &dstats5, &dstats6, &dstats7, &dstats8, &dstats9, &dstats10 ) ;
-	vdefine( vlist2, &dstats11, &dstats12, &dstats13, &dstats14, &dstats15, &dstats16, &dstats17, &dstats18, &dstats19, &dstats20 ) ;
+	vdefine( vlist1, &dstats[ 1 ], &dstats[ 2 ], &dstats3, &dstats[ 4 ], &dstats[ 5 ], &dstats[ 6 ], &dstats[ 7 ], &dstats[ 8 ], &dstats[ 9 ], &dstats[ 10 ] ) ;
+	vdefine( vlist2, &dstats[ 11 ], &dstats[ 12 ], &dstats[ 13 ], &dstats[ 14 ], &dstats[ 15 ], &dstats[ 16 ], &dstats[ 17 ], &dstats[ 18 ], &dstats[ 19 ], &dstats[ 20 ] ) ;
+	vdefine( vlist3, &drater, &dratew ) ;
+
+	sysmon_subscribe() ;
 
 	RC = 0 ;
 
 	while ( RC == 0 )
 	{
-		std::ifstream if_diskstats( _PATH_PROC_DISKSTATS ) ;
-		while ( getline( if_diskstats, line ) )
+		drater = "" ;
+		dratew = "" ;
+		auto s2 = sysmon.get( 0 ) ;
+		auto s1 = sysmon.get( 1 ) ;
+		auto it2 = s2->disks.find( dev1 ) ;
+		if ( it2 != s2->disks.end() )
 		{
-			if ( word( line, 3 ) == dev1 )
+			const vector<uint64_t>& f2 = it2->second ;
+			for ( size_t i = 0 ; i < f2.size() && i < 19 ; ++i )
 			{
-				stringstream ss( line ) ;
-				ss >> dstats1  ;
-				ss >> dstats2  ;
-				ss >> ignore   ;
-				ss >> dstats4  ;
-				ss >> dstats5  ;
-				ss >> dstats6  ;
-				ss >> dstats7  ;
-				ss >> dstats8  ;
-				ss >> dstats9  ;
-				ss >> dstats10 ;
-				ss >> dstats11 ;
-				ss >> dstats12 ;
-				ss >> dstats13 ;
-				ss >> dstats14 ;
-				ss >> dstats15 ;
-				ss >> dstats16 ;
-				ss >> dstats17 ;
-				ss >> dstats18 ;
-				ss >> dstats19 ;
-				ss >> dstats20 ;
-				break ;
+				dstats[ ( i < 2 ) ? i + 1 : i + 2 ] = to_string( f2[ i ] ) ;
+			}
+			auto it1 = ( s1 ) ? s1->disks.find( dev1 ) : s2->disks.end() ;
+			if ( s1 && it1 != s1->disks.end() && f2.size() > 8 )
+			{
+				const vector<uint64_t>& f1 = it1->second ;
+				secs = std::chrono::duration<float>( s2->time - s1->time ).count() ;
+				if ( secs > 0 && f2[ 4 ] >= f1[ 4 ] && f2[ 8 ] >= f1[ 8 ] )
+				{
+					drater = format_kbs( ( f2[ 4 ] - f1[ 4 ] ) / 2.0 / secs ) ;
+					dratew = format_kbs( ( f2[ 8 ] - f1[ 8 ] ) / 2.0 / secs ) ;
+				}
 			}
 		}
-		if_diskstats.close() ;
 		display( "PSUT00QI" ) ;
 	}
 
-	vdelete( vlist1, vlist2 ) ;
+	sysmon_unsubscribe() ;
+
+	vdelete( vlist1, vlist2, vlist3 ) ;
 }
 
 
@@ -1685,7 +1722,8 @@ void psysutl::showDEV_diskstats( const string& dev )
 void psysutl::showTasks()
 {
 	//
-	// Show running tasks from 'top' output.
+	// Show running tasks.  Task details are read from /proc by a task_sampler, which keeps the
+	// previous sample so %CPU covers the time between refreshes.
 	//
 
 	int rc ;
@@ -1713,6 +1751,8 @@ void psysutl::showTasks()
 
 	vector<string> results ;
 
+	task_sampler sampler ;
+
 	const string vlist1 = "SEL USER PID NICE CPU CPUX MEM MEMX CMD" ;
 	const string vlist2 = "USERF ONLYF" ;
 	const string vlist3 = "CRP ZTDSELS ZTDTOP" ;
@@ -1724,12 +1764,14 @@ void psysutl::showTasks()
 	table = "TSKL" + d2ds( taskid(), 4 ) ;
 
 	showTasks_buildTable( table,
+			      sampler,
 			      user,
 			      pid,
 			      nice,
 			      cpu,
 			      cpux,
 			      mem,
+			      memx,
 			      cmd ) ;
 
 	ztdtop  = 1 ;
@@ -1750,7 +1792,6 @@ void psysutl::showTasks()
 			tbskip( table, ztdtop ) ;
 			panel = "PSUT00TK" ;
 		}
-		control( "DISPLAY", "REFRESH" ) ;
 		tbdispl( table,
 			 panel,
 			 msg,
@@ -1802,12 +1843,14 @@ void psysutl::showTasks()
 		if ( sel == "" && ztdsels < 2 )
 		{
 			showTasks_buildTable( table,
+					      sampler,
 					      user,
 					      pid,
 					      nice,
 					      cpu,
 					      cpux,
 					      mem,
+					      memx,
 					      cmd,
 					      uf,
 					      of ) ;
@@ -1821,57 +1864,31 @@ void psysutl::showTasks()
 
 
 void psysutl::showTasks_buildTable( const string& table,
+				    task_sampler& sampler,
 				    string& user,
 				    string& pid,
 				    string& nice,
 				    string& cpu,
 				    string& cpux,
 				    string& mem,
+				    string& memx,
 				    string& cmd,
 				    const string& uf,
 				    const string& of )
 {
 	//
-	// Columns for top: PID, user, priority, NI, virt, RES, Size, Status, %CPU, %MEM, time, Command.
+	// Build the task table from a new sample of /proc.
 	//
-	// Procedure can use 'top' or 'ps'.
-	// top gives a better representation of CPU percentage but there is a delay.
-	//
-	// Do CONTROL DISPLAY REFRESH before TBDISPL when using 'top' as it seems to sometimes interfere with ncurses output.
+	// %CPU is the CPU time used since the previous sample (100% being one CPU, as top).  On the
+	// first sample it is the average over the life of the task, as ps.
+	// CPUX and MEMX are the percentages * 10 for sorting.
 	//
 
-	int maxw1 ;
-	int rc ;
+	int x ;
 
-	size_t p ;
+	vector<task_dtls> tasks ;
 
-	string excmd ;
-
-	vector<string> results ;
-
-	enum Columns
-	{
-		C_PID = 1,
-		C_USER,
-		C_PRI,
-		C_NICE,
-		C_VIRT,
-		C_RES,
-		C_SIZE,
-		C_STATUS,
-		C_CPU,
-		C_MEM,
-		C_TIME,
-		C_CMD
-	} ;
-
-	vdefine( "ZSCRMAXW", &maxw1 ) ;
-	vget( "ZSCRMAXW", SHARED ) ;
-
-  //    excmd = "ps ax -o pid,user,pri,ni,vsz,drs,size,stat,%cpu,%mem,time,cmd" ;
-	excmd = "top -b -n 1 -w " + d2ds( maxw1 ) ;
-
-	execute_cmd( rc, excmd, results ) ;
+	sampler.sample( tasks ) ;
 
 	tbcreate( table,
 		  "",
@@ -1879,34 +1896,245 @@ void psysutl::showTasks_buildTable( const string& table,
 		  NOWRITE,
 		  REPLACE ) ;
 
-	for ( const auto& inLine : results )
+	for ( const auto& t : tasks )
 	{
 		tbvclear( table ) ;
-		pid = word( inLine, C_PID ) ;
-		if ( !datatype( pid, 'W' ) ) { continue ; }
-		user = word( inLine, C_USER ) ;
+		user = sampler.username( t.uid ) ;
 		if ( uf != "" && uf != upper( user ) ) { continue ; }
-		nice = word( inLine, C_NICE ) ;
-		cpu  = word( inLine, C_CPU ) ;
-		p    = cpu.find( '.' ) ;
-		if ( p == string::npos ) { cpux = d2ds( ds2d( cpu ) * 10 ) ; }
-		else                     { cpux = cpu ; cpux.erase( p, 1 ) ; }
-		mem = word( inLine, C_MEM ) ;
-		cmd = subword( inLine, C_CMD ) ;
-		if ( of != "" && pos( of, upper( cmd ) ) == 0 ) { continue ; }
-		trim_left( cmd ) ;
-		cmd = strip( strip( cmd, 'L', '`' ), 'L', '-' ) ;
-		trim_left( cmd ) ;
+		if ( of != "" && pos( of, upper( t.cmd ) ) == 0 ) { continue ; }
+		pid  = d2ds( t.pid ) ;
+		nice = d2ds( t.nice ) ;
+		x    = t.cpu * 10 + 0.5 ;
+		cpux = d2ds( x ) ;
+		cpu  = d2ds( x / 10 ) + "." + d2ds( x % 10 ) ;
+		x    = t.mem * 10 + 0.5 ;
+		memx = d2ds( x ) ;
+		mem  = d2ds( x / 10 ) + "." + d2ds( x % 10 ) ;
+		cmd  = t.cmd ;
 		tbadd( table ) ;
 	}
 
 	tbsort( table, "(CPUX,N,D)" ) ;
 	tbtop( table ) ;
+}
+
+
+task_sampler::task_sampler()
+{
+	struct sysinfo si ;
+
+	clktck   = sysconf( _SC_CLK_TCK ) ;
+	pagesize = sysconf( _SC_PAGESIZE ) ;
+	memtotal = ( sysinfo( &si ) == 0 ) ? uint64_t( si.totalram ) * si.mem_unit : 0 ;
+}
+
+
+void task_sampler::sample( vector<task_dtls>& tasks )
+{
+	//
+	// Read all tasks in /proc.  Tasks are read in parallel and the %CPU worked out from the
+	// CPU ticks used since the previous sample, which is kept for the next call.
+	//
+
+	float elapsed ;
+	float uptime = 0.0 ;
+
+	struct dirent* ent ;
+
+	vector<pid_t> pids ;
+
+	map<pid_t, pair<uint64_t, uint64_t>> curr ;
+
+	auto now = std::chrono::steady_clock::now() ;
+
+	DIR* dir = opendir( "/proc" ) ;
+	if ( !dir ) { return ; }
+
+	while ( ( ent = readdir( dir ) ) )
+	{
+		if ( isdigit( ent->d_name[ 0 ] ) )
+		{
+			pids.push_back( atoi( ent->d_name ) ) ;
+		}
+	}
+
+	closedir( dir ) ;
+
+	tasks.clear() ;
+	tasks.resize( pids.size() ) ;
+
+	parallel_ranges( pids.size(), 64, [ this, &tasks, &pids ]( size_t b, size_t e, uint )
+		{
+			for ( size_t i = b ; i < e ; ++i )
+			{
+				tasks[ i ].pid = pids[ i ] ;
+				tasks[ i ].ok  = read_task( tasks[ i ] ) ;
+			}
+		} ) ;
+
+	if ( prev.empty() )
+	{
+		std::ifstream fin( "/proc/uptime" ) ;
+		fin >> uptime ;
+	}
+
+	elapsed = std::chrono::duration<float>( now - prev_time ).count() * clktck ;
+
+	for ( auto& t : tasks )
+	{
+		if ( !t.ok ) { continue ; }
+		auto it = prev.find( t.pid ) ;
+		if ( it != prev.end() && it->second.first == t.start )
+		{
+			if ( elapsed > 0 ) { t.cpu = ( t.ticks - it->second.second ) * 100.0 / elapsed ; }
+		}
+		else if ( prev.empty() && uptime * clktck > t.start )
+		{
+			t.cpu = t.ticks * 100.0 / ( uptime * clktck - t.start ) ;
+		}
+		if ( memtotal > 0 )
+		{
+			t.mem = t.rss * pagesize * 100.0 / memtotal ;
+		}
+		curr[ t.pid ] = make_pair( t.start, t.ticks ) ;
+	}
+
+	tasks.erase( remove_if( tasks.begin(), tasks.end(), []( const task_dtls& t )
+		{
+			return !t.ok ;
+		} ), tasks.end() ) ;
+
+	prev.swap( curr ) ;
+	prev_time = now ;
+}
+
+
+bool task_sampler::read_task( task_dtls& t ) const
+{
+	//
+	// Read stat, statm and cmdline for a task.  Return false if the task has gone.
+	// Kernel threads have no command line so show the name in brackets, as ps.
+	//
+	// The name in stat can contain blanks and brackets so the fields start after the last ')'.
+	//
+
+	int fd ;
+
+	char buf[ 4096 ] ;
+
+	char* p ;
+	char* q ;
+
+	ssize_t n ;
+
+	unsigned long utime ;
+	unsigned long stime ;
+	unsigned long long start ;
+	unsigned long size ;
+	unsigned long rss ;
+
+	struct stat st ;
+
+	string comm ;
+
+	snprintf( buf, sizeof( buf ), "/proc/%d", t.pid ) ;
+
+	fd = open( buf, O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ;
+	if ( fd == -1 ) { return false ; }
+
+	BOOST_SCOPE_EXIT( &fd )
+	{
+		close( fd ) ;
+	}
+	BOOST_SCOPE_EXIT_END
+
+	if ( fstat( fd, &st ) == -1 ) { return false ; }
+	t.uid = st.st_uid ;
+
+	n = read_proc( fd, "stat", buf, sizeof( buf ) ) ;
+	if ( n <= 0 ) { return false ; }
+
+	p = strchr( buf, '(' ) ;
+	q = strrchr( buf, ')' ) ;
+	if ( !p || !q || q < p ) { return false ; }
+
+	comm.assign( p + 1, q - p - 1 ) ;
+
+	if ( sscanf( q + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d %d %*d %*d %llu",
+		     &utime,
+		     &stime,
+		     &t.nice,
+		     &start ) != 4 )
+	{
+		return false ;
+	}
+
+	t.ticks = utime + stime ;
+	t.start = start ;
+
+	n = read_proc( fd, "statm", buf, sizeof( buf ) ) ;
+	if ( n > 0 && sscanf( buf, "%lu %lu", &size, &rss ) == 2 )
+	{
+		t.rss = rss ;
+	}
+
+	n = read_proc( fd, "cmdline", buf, sizeof( buf ) ) ;
+	if ( n > 0 )
+	{
+		replace( buf, buf + n, '\0', ' ' ) ;
+		t.cmd.assign( buf, n ) ;
+		trim_right( t.cmd ) ;
+	}
+
+	if ( t.cmd == "" )
+	{
+		t.cmd = "[" + comm + "]" ;
+	}
+
+	return true ;
+}
+
 
-	vdelete( "ZSCRMAXW" ) ;
+ssize_t task_sampler::read_proc( int dfd,
+				 const char* name,
+				 char* buf,
+				 size_t size ) const
+{
+	//
+	// Read file name in directory dfd into buf (null terminated).  Return the length read
+	// or -1 on error.  Longer files are truncated.
+	//
+
+	ssize_t n ;
+
+	int fd = openat( dfd, name, O_RDONLY | O_CLOEXEC ) ;
+	if ( fd == -1 ) { return -1 ; }
+
+	n = read( fd, buf, size - 1 ) ;
+	close( fd ) ;
+
+	buf[ ( n < 0 ) ? 0 : n ] = '\0' ;
+
+	return n ;
 }
 
 
+const string& task_sampler::username( uid_t uid )
+{
+	//
+	// Return the user name for uid, caching the result.
+	//
+
+	auto it = users.find( uid ) ;
+	if ( it == users.end() )
+	{
+		struct passwd* pw = getpwuid( uid ) ;
+		it = users.insert( make_pair( uid, ( pw ) ? string( pw->pw_name ) : to_string( uid ) ) ).first ;
+	}
+
+	return it->second ;
+}
+
 
 /**************************************************************************************************************/
 /**********************************            USB SYBSYSTEM                ***********************************/
@@ -2854,14 +3082,16 @@ void psysutl::showNetwork_info( const string& netif,
 	string irxb ;
 	string irxe ;
 	string irxd ;
+	string itxr ;
+	string irxr ;
 
 	struct udev_device* dev ;
 
 	const string vlist1 = "ZCMD IVENDOR IMODEL IDRIVER ICLASS ISCLASS" ;
-	const string vlist2 = "ITXP ITXB ITXE ITXD IRXP IRXB IRXE IRXD" ;
+	const string vlist2 = "ITXP ITXB ITXE ITXD IRXP IRXB IRXE IRXD ITXR IRXR" ;
 
 	vdefine( vlist1, &zcmd, &ivendor, &imodel, &idriver, &iclass, &isclass ) ;
-	vdefine( vlist2, &itxp, &itxb, &itxe, &itxd, &irxp, &irxb, &irxe, &irxd ) ;
+	vdefine( vlist2, &itxp, &itxb, &itxe, &itxd, &irxp, &irxb, &irxe, &irxd, &itxr, &irxr ) ;
 
 	struct udev* udev = udev_new() ;
 	if ( !udev )
@@ -2881,13 +3111,17 @@ void psysutl::showNetwork_info( const string& netif,
 	udev_device_unref( dev ) ;
 	udev_unref( udev ) ;
 
+	sysmon_subscribe() ;
+
 	RC = 0 ;
 	while ( RC == 0 )
 	{
-		showNetwork_stats( netif, itxp, itxb, itxe, itxd, irxp, irxb, irxe, irxd ) ;
+		showNetwork_stats( netif, itxp, itxb, itxe, itxd, irxp, irxb, irxe, irxd, itxr, irxr ) ;
 		display( "PSUT00NI" ) ;
 	}
 
+	sysmon_unsubscribe() ;
+
 	vdelete( vlist1, vlist2 ) ;
 }
 
@@ -2900,40 +3134,57 @@ void psysutl::showNetwork_stats( const string& netif,
 				 string& irxp,
 				 string& irxb,
 				 string& irxe,
-				 string& irxd )
+				 string& irxd,
+				 string& itxr,
+				 string& irxr )
 {
 	//
-	// Get interface transmit/receive/error/drop stats.
+	// Get interface transmit/receive/error/drop stats from the latest system sample, and the
+	// transmit/receive rates over the last interval.
 	//
-	// Use /proc/net/dev to get the statistics as it uses rtnl_link_stats64 internally.
+	// /proc/net/dev is used to get the statistics as it uses rtnl_link_stats64 internally.
 	// ifa_data uses rtnl_link_stats so will soon wrap.
 	//
+	// Fields are receive bytes, packets, errs, drop, fifo, frame, compressed, multicast,
+	// then transmit bytes, packets, errs, drop, fifo, colls, carrier, compressed.
+	//
 
-	string line ;
-	string key = netif + ":" ;
+	float secs ;
 
-	std::ifstream if_devnet( _PATH_PROC_NETDEV ) ;
+	auto s2 = sysmon.get( 0 ) ;
+	auto s1 = sysmon.get( 1 ) ;
 
-	getline( if_devnet, line ) ;
-	getline( if_devnet, line ) ;
+	itxr = "" ;
+	irxr = "" ;
 
-	while ( getline( if_devnet, line ) )
-	{
-		if ( word( line, 1 ) == key )
-		{
-			itxp = word( line, 11 ) ;
-			itxb = word( line, 10 ) ;
-			itxe = word( line, 12 ) ;
-			itxd = word( line, 13 ) ;
-			irxp = word( line, 3 ) ;
-			irxb = word( line, 2 ) ;
-			irxe = word( line, 4 ) ;
-			irxd = word( line, 5 ) ;
-			break ;
-		}
-	}
+	if ( !s2 ) { return ; }
 
-	if_devnet.close() ;
+	auto it2 = s2->net.find( netif ) ;
+	if ( it2 == s2->net.end() || it2->second.size() < 12 ) { return ; }
+
+	const vector<uint64_t>& f2 = it2->second ;
+
+	itxp = to_string( f2[ 9 ] ) ;
+	itxb = to_string( f2[ 8 ] ) ;
+	itxe = to_string( f2[ 10 ] ) ;
+	itxd = to_string( f2[ 11 ] ) ;
+	irxp = to_string( f2[ 1 ] ) ;
+	irxb = to_string( f2[ 0 ] ) ;
+	irxe = to_string( f2[ 2 ] ) ;
+	irxd = to_string( f2[ 3 ] ) ;
+
+	if ( !s1 ) { return ; }
+
+	auto it1 = s1->net.find( netif ) ;
+	if ( it1 == s1->net.end() || it1->second.size() < 12 ) { return ; }
+
+	const vector<uint64_t>& f1 = it1->second ;
+
+	secs = std::chrono::duration<float>( s2->time - s1->time ).count() ;
+	if ( secs <= 0 || f2[ 8 ] < f1[ 8 ] || f2[ 0 ] < f1[ 0 ] ) { return ; }
+
+	itxr = format_kbs( ( f2[ 8 ] - f1[ 8 ] ) / 1024.0 / secs ) ;
+	irxr = format_kbs( ( f2[ 0 ] - f1[ 0 ] ) / 1024.0 / secs ) ;
 }
 
 
@@ -5050,7 +5301,7 @@ void psysutl::showJournal()
 		csrrow = crp ;
 		if ( sel == "S" || sel == "B" )
 		{
-			select( "PGM(PCMD0A) PARM(journalctl --b "+ bootid +" ) SUSPEND" ) ;
+			showJournal_entries( bootid ) ;
 		}
 		else if ( sel == "F" )
 		{
@@ -5059,9 +5310,9 @@ void psysutl::showJournal()
 			vget( vlist4, PROFILE ) ;
 			if ( jfield1 != "" && jvalue1 != "" )
 			{
-				filters = jfield1 + "='" + jvalue1 + "'" ;
+				filters = jfield1 + "=" + jvalue1 ;
 			}
-			select( "PGM(PCMD0A) PARM(journalctl "+filters+" --b "+ bootid +" ) SUSPEND" ) ;
+			showJournal_entries( bootid, filters ) ;
 		}
 	}
 
@@ -5253,6 +5504,359 @@ bool psysutl::showJournal_buildTable( const string& tabName )
 	return true ;
 }
 
+void psysutl::showJournal_entries( const string& bootid,
+				   const string& filter )
+{
+	//
+	// Browse the journal entries for boot bootid, optionally only those matching filter
+	// (FIELD=value).  Both are added as journal matches so only matching entries are read.
+	//
+	// Only the visible window is read from the journal.  Scrolling moves the cursor of the
+	// first entry shown so opening and scrolling take the same time whatever the journal size.
+	//
+
+	int zareaw ;
+	int zaread ;
+	int zscrolln ;
+
+	int rc ;
+
+	uint startCol = 0 ;
+
+	string s ;
+	string t ;
+	string msg ;
+	string zcmd ;
+	string zverb ;
+	string zarea ;
+	string zshadow ;
+	string zscrolla ;
+	string jfilter ;
+	string jbootid = bootid ;
+
+	vector<string> lines ;
+	vector<int> prty ;
+	vector<string> matches = { "_BOOT_ID=" + bootid } ;
+
+	journal_pager pager ;
+
+	if ( filter != "" )
+	{
+		matches.push_back( filter ) ;
+	}
+
+	rc = pager.open( matches ) ;
+	if ( rc < 0 )
+	{
+		display_error( "PSUT017A", rc ) ;
+		return ;
+	}
+
+	const string vlist1 = "ZCMD ZVERB ZAREA ZSHADOW ZSCROLLA JFILTER JBOOTID" ;
+	const string vlist2 = "ZAREAW ZAREAD ZSCROLLN" ;
+
+	vdefine( vlist1, &zcmd, &zverb, &zarea, &zshadow, &zscrolla, &jfilter, &jbootid ) ;
+	vdefine( vlist2, &zareaw, &zaread, &zscrolln ) ;
+
+	jfilter = filter ;
+
+	while ( true )
+	{
+		pquery( "PSUT00J4", "ZAREA", "", "ZAREAW", "ZAREAD" ) ;
+		if ( RC > 0 ) { break ; }
+		zarea   = "" ;
+		zshadow = "" ;
+		if ( pager.at_top() )
+		{
+			zarea   = centre( " Top of Journal ", zareaw, '*' ) ;
+			zshadow = string( zareaw, N_TURQ ) ;
+		}
+		pager.read( ( pager.at_top() ) ? zaread - 1 : zaread, lines, prty ) ;
+		for ( size_t i = 0 ; i < lines.size() ; ++i )
+		{
+			t = lines[ i ].substr( 0, 16 ) ;
+			if ( lines[ i ].size() > startCol + 16 )
+			{
+				t += lines[ i ].substr( startCol + 16 ) ;
+			}
+			t.resize( zareaw, ' ' ) ;
+			s = string( zareaw, ( prty[ i ] <= 3 ) ? N_RED    :
+					    ( prty[ i ] == 4 ) ? N_YELLOW :
+					    ( prty[ i ] == 5 ) ? N_WHITE  : N_GREEN ) ;
+			s.replace( 0, min( 16, zareaw ), min( 16, zareaw ), N_TURQ ) ;
+			zarea   += t ;
+			zshadow += s ;
+		}
+		if ( int( lines.size() ) < ( ( pager.at_top() ) ? zaread - 1 : zaread ) )
+		{
+			zarea   += centre( " Bottom of Journal ", zareaw, '*' ) ;
+			zshadow += string( zareaw, N_TURQ ) ;
+		}
+		zarea.resize( zareaw * zaread, ' ' ) ;
+		zshadow.resize( zareaw * zaread, N_TURQ ) ;
+		display( "PSUT00J4", msg, "ZCMD" ) ;
+		if ( RC == 8 ) { break ; }
+		msg = "" ;
+		vget( "ZVERB ZSCROLLA ZSCROLLN", SHARED ) ;
+		zcmd = "" ;
+		if ( zverb == "DOWN" )
+		{
+			if ( zscrolla == "MAX" ) { pager.bottom( zaread - 1 ) ; }
+			else                     { pager.down( zscrolln )     ; }
+		}
+		else if ( zverb == "UP" )
+		{
+			if ( zscrolla == "MAX" ) { pager.top()            ; }
+			else                     { pager.up( zscrolln )   ; }
+		}
+		else if ( zverb == "LEFT" )
+		{
+			startCol = ( zscrolla == "MAX" || int( startCol ) < zscrolln ) ? 0 : startCol - zscrolln ;
+		}
+		else if ( zverb == "RIGHT" )
+		{
+			startCol += zscrolln ;
+		}
+	}
+
+	vdelete( vlist1, vlist2 ) ;
+}
+
+journal_pager::journal_pager()
+{
+	j = nullptr ;
+}
+
+
+journal_pager::~journal_pager()
+{
+	if ( j )
+	{
+		sd_journal_close( j ) ;
+	}
+}
+
+
+int journal_pager::open( const vector<string>& matches )
+{
+	//
+	// Open the local journal and add the matches (FIELD=value).  Matches for different fields
+	// must all be satisfied.  Return a negative errno on error.
+	//
+
+	int rc ;
+
+	rc = sd_journal_open( &j, SD_JOURNAL_LOCAL_ONLY ) ;
+	if ( rc < 0 )
+	{
+		j = nullptr ;
+		return rc ;
+	}
+
+	for ( const auto& m : matches )
+	{
+		rc = sd_journal_add_match( j, m.c_str(), m.size() ) ;
+		if ( rc < 0 ) { return rc ; }
+	}
+
+	return 0 ;
+}
+
+
+void journal_pager::top()
+{
+	//
+	// Position at the start of the journal.
+	//
+
+	first = "" ;
+	cursors.clear() ;
+}
+
+
+void journal_pager::bottom( uint n )
+{
+	//
+	// Position so the last n entries are shown.
+	//
+
+	sd_journal_seek_tail( j ) ;
+	if ( sd_journal_previous_skip( j, max( n, 1u ) ) > 0 )
+	{
+		first = cursor() ;
+	}
+}
+
+
+void journal_pager::down( uint n )
+{
+	//
+	// Move forward n entries, stopping at the last entry.  Use the cursors of the visible
+	// window when the new first entry is in it.
+	//
+	// At the start of the journal the top marker line counts as a line.
+	//
+
+	int r ;
+
+	if ( n == 0 ) { return ; }
+
+	if ( at_top() && n <= cursors.size() )
+	{
+		first = cursors[ n - 1 ] ;
+		return ;
+	}
+	else if ( !at_top() && n < cursors.size() )
+	{
+		first = cursors[ n ] ;
+		return ;
+	}
+
+	if ( at_top() )
+	{
+		sd_journal_seek_head( j ) ;
+	}
+	else if ( !seek_first() )
+	{
+		return ;
+	}
+
+	r = sd_journal_next_skip( j, n ) ;
+
+	if ( r > 0 )
+	{
+		first = cursor() ;
+	}
+}
+
+
+void journal_pager::up( uint n )
+{
+	//
+	// Move back n entries.  Position at the start if there are not that many.
+	//
+
+	if ( at_top() || n == 0 ) { return ; }
+
+	if ( !seek_first() || sd_journal_previous_skip( j, n ) < int( n ) )
+	{
+		top() ;
+		return ;
+	}
+
+	first = cursor() ;
+}
+
+
+void journal_pager::read( uint n,
+			  vector<string>& lines,
+			  vector<int>& prty )
+{
+	//
+	// Read up to n entries from the first entry shown, formatted as in journalctl short
+	// format, and their priorities.  The first 16 characters of each line is the time stamp.
+	//
+
+	time_t t ;
+
+	uint64_t usec ;
+
+	char buf[ 32 ] ;
+
+	string ident ;
+	string pid ;
+	string pri ;
+	string line ;
+
+	lines.clear() ;
+	prty.clear() ;
+	cursors.clear() ;
+
+	if ( at_top() )
+	{
+		sd_journal_seek_head( j ) ;
+		if ( sd_journal_next( j ) <= 0 ) { return ; }
+	}
+	else if ( !seek_first() )
+	{
+		return ;
+	}
+
+	do
+	{
+		cursors.push_back( cursor() ) ;
+		t = ( sd_journal_get_realtime_usec( j, &usec ) < 0 ) ? 0 : usec / 1000000 ;
+		strftime( buf, sizeof( buf ), "%b %d %H:%M:%S ", localtime( &t ) ) ;
+		line  = buf ;
+		ident = get_field( "SYSLOG_IDENTIFIER" ) ;
+		if ( ident == "" ) { ident = get_field( "_COMM" ) ; }
+		pid   = get_field( "_PID" ) ;
+		line += ident ;
+		if ( pid != "" ) { line += "[" + pid + "]" ; }
+		line += ": " + get_field( "MESSAGE" ) ;
+		replace( line.begin(), line.end(), '\n', ' ' ) ;
+		pri   = get_field( "PRIORITY" ) ;
+		lines.push_back( line ) ;
+		prty.push_back( ( pri == "" ) ? 6 : ds2d( pri ) ) ;
+	} while ( lines.size() < n && sd_journal_next( j ) > 0 ) ;
+}
+
+
+bool journal_pager::seek_first()
+{
+	//
+	// Position on the first entry shown.  If it has gone (journal rotated), the nearest
+	// entry is used.
+	//
+
+	if ( sd_journal_seek_cursor( j, first.c_str() ) < 0 )
+	{
+		return false ;
+	}
+
+	return ( sd_journal_next( j ) > 0 ) ;
+}
+
+
+string journal_pager::cursor()
+{
+	//
+	// Return the cursor of the current entry.
+	//
+
+	char* c ;
+
+	string s ;
+
+	if ( sd_journal_get_cursor( j, &c ) >= 0 )
+	{
+		s = c ;
+		free( c ) ;
+	}
+
+	return s ;
+}
+
+
+string journal_pager::get_field( const char* field )
+{
+	//
+	// Return the value of a field of the current entry.  Data is returned as FIELD=value.
+	//
+
+	const void* data ;
+
+	size_t l ;
+	size_t fl = strlen( field ) ;
+
+	if ( sd_journal_get_data( j, field, &data, &l ) < 0 || l <= fl )
+	{
+		return "" ;
+	}
+
+	return string( static_cast<const char*>( data ) + fl + 1, l - fl - 1 ) ;
+}
+
 
 /**************************************************************************************************************/
 /**********************************           UTILITY FUNCTIONS             ***********************************/
@@ -5674,88 +6278,41 @@ void psysutl::execute_cmd( int& rc,
 	// Execute a command and place the output in the
 	// results vector.
 	//
-	// Redirect STDERR/STOUT to pipes to get errors from the command.  Restore on return.
+	// Error output is saved in stderror.  The command is stopped if the application is interrupted.
 	//
 
-	string line ;
-
-	int fd1 ;
-	int fd2 ;
-	int retc ;
-
-	int my_pipe1[ 2 ] ;
-	int my_pipe2[ 2 ] ;
-
-	char buffer[ 8192 ] ;
+	vector<string> errs ;
 
 	results.clear() ;
 
-	stderror = "" ;
-
-	if ( pipe2( my_pipe1, O_NONBLOCK ) == -1 )
-	{
-		display_error( "PSUT015C", strerror( errno ) ) ;
-		return ;
-	}
-
-	if ( pipe2( my_pipe2, O_NONBLOCK ) == -1 )
-	{
-		close( my_pipe1[ 0 ] ) ;
-		close( my_pipe1[ 1 ] ) ;
-		display_error( "PSUT015C", strerror( errno ) ) ;
-		return ;
-	}
-
-	fd1 = dup( STDERR_FILENO ) ;
-	dup2( my_pipe1[ 1 ], STDERR_FILENO ) ;
-
-	fd2 = dup( STDOUT_FILENO ) ;
-	dup2( my_pipe2[ 1 ], STDOUT_FILENO ) ;
+	stderror    = "" ;
+	interrupted = false ;
 
-	FILE* pipe { popen( cmd.c_str(), "r" ) } ;
+	rc = run_command( cmd, results, &errs, [ this ]()
+		{
+			return interrupted ;
+		} ) ;
 
-	if ( !pipe )
+	if ( rc == -1 )
 	{
 		rc = 3 ;
 		setmsg( "PSUT011E" ) ;
-		llog( "E", "POPEN failed.  Command string size="<< cmd.size() <<endl ) ;
+		llog( "E", "Command " << cmd << " could not be started." << endl ) ;
 		return ;
 	}
 
-	while ( fgets( buffer, sizeof( buffer ), pipe ) )
+	for ( const auto& e : errs )
 	{
-		line = buffer ;
-		if ( line != "" && line.back() == 0x0a )
-		{
-			line.pop_back() ;
-		}
-		results.push_back( line ) ;
+		stderror += e + " " ;
 	}
 
-	rc = WEXITSTATUS( pclose( pipe ) ) ;
-
-	fflush( stdout ) ;
-	close( my_pipe2[ 0 ] ) ;
-	close( my_pipe2[ 1 ] ) ;
-	dup2( fd2, STDOUT_FILENO ) ;
-
-	fflush( stderr ) ;
-	close( my_pipe1[ 1 ] ) ;
-	line = "" ;
-	retc = read( my_pipe1[ 0 ], buffer, sizeof( buffer ) ) ;
-	while ( retc != -1 )
+	if ( strip( stderror ) != "" )
 	{
-		line += string( buffer, retc ) ;
-		retc = read( my_pipe1[ 0 ], buffer, sizeof( buffer ) ) ;
+		llog( "O", "STDERR " << stderror << endl ) ;
 	}
-	close( my_pipe1[ 0 ] ) ;
-	dup2( fd1, STDERR_FILENO ) ;
-
-	line = translate( line, 0x20, 0x0a ) ;
-	if ( strip( line ) != "" )
+	else
 	{
-		stderror = line ;
-		llog( "O", "STDERR " << stderror << endl ) ;
+		stderror = "" ;
 	}
 }
 
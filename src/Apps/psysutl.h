@@ -183,72 +183,72 @@ class cpu_dtls
 			total   = 0 ;
 		}
 
-		string get_cpu( long clktck )
+		string get_cpu( long clktck ) const
 		{
 			return addCommas( to_string( ( ( total - idle ) / clktck ) ) ) ;
 		}
 
-		string get_idle( long clktck )
+		string get_idle( long clktck ) const
 		{
 			return addCommas( to_string( ( idle / clktck ) ) ) ;
 		}
 
-		string get_cpu_pcent()
+		string get_cpu_pcent() const
 		{
 			return addCommas( to_string( ( ( total - xI )/(float)total ) * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_user_pcent()
+		string get_user_pcent() const
 		{
 			return addCommas( to_string( user/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_nice_pcent()
+		string get_nice_pcent() const
 		{
 			return addCommas( to_string( nice/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_idle_pcent()
+		string get_idle_pcent() const
 		{
 			return addCommas( to_string( idle/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_system_pcent()
+		string get_system_pcent() const
 		{
 			return addCommas( to_string( system/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_iowait_pcent()
+		string get_iowait_pcent() const
 		{
 			return addCommas( to_string( iowait/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_irq_pcent()
+		string get_irq_pcent() const
 		{
 			return addCommas( to_string( irq/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_softirq_pcent()
+		string get_softirq_pcent() const
 		{
 			return addCommas( to_string( softirq/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_steal_pcent()
+		string get_steal_pcent() const
 		{
 			return addCommas( to_string( steal/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_guest_pcent()
+		string get_guest_pcent() const
 		{
 			return addCommas( to_string( guest/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		string get_gnice_pcent()
+		string get_gnice_pcent() const
 		{
 			return addCommas( to_string( gnice/(float)total * 100 + 0.05 ), 1 ) ;
 		}
 
-		cpu_dtls operator - ( const cpu_dtls& rhs )
+		cpu_dtls operator - ( const cpu_dtls& rhs ) const
 		{
 			cpu_dtls temp ;
 			temp.user    = user - rhs.user ;
@@ -283,6 +283,164 @@ class cpu_dtls
 } ;
 
 
+#define SS_HISTORY 301
+
+
+class sys_sample
+{
+	public:
+		sys_sample()
+		{
+			pgpgin  = 0 ;
+			pgpgout = 0 ;
+			pswpin  = 0 ;
+			pswpout = 0 ;
+		}
+
+		std::chrono::steady_clock::time_point time ;
+
+		vector<cpu_dtls> cpus ;                    // /proc/stat, total first.
+
+		uint64_t pgpgin ;                          // /proc/vmstat.
+		uint64_t pgpgout ;
+		uint64_t pswpin ;
+		uint64_t pswpout ;
+
+		map<string, vector<uint64_t>> net ;        // /proc/net/dev counters by interface.
+		map<string, vector<uint64_t>> disks ;      // /proc/diskstats fields by device (major, minor, stats).
+} ;
+
+
+class sys_sampler
+{
+	public:
+		sys_sampler() ;
+
+		void subscribe() ;
+		void unsubscribe() ;
+
+		std::shared_ptr<const sys_sample> get( uint = 0 ) const ;
+
+		uint history() const ;
+
+	private:
+		void run() ;
+
+		void take_sample() ;
+
+		std::shared_ptr<const sys_sample> ring[ SS_HISTORY ] ;
+
+		std::atomic<uint64_t> count ;
+
+		boost::mutex mtx ;
+		boost::mutex ctl ;
+
+		boost::condition cond ;
+
+		boost::thread* thread ;
+
+		uint subscribers ;
+
+		bool stopping ;
+} ;
+
+
+class task_dtls
+{
+	public:
+		task_dtls()
+		{
+			pid   = 0 ;
+			uid   = 0 ;
+			nice  = 0 ;
+			ticks = 0 ;
+			start = 0 ;
+			rss   = 0 ;
+			cpu   = 0.0 ;
+			mem   = 0.0 ;
+			ok    = false ;
+		}
+
+		pid_t    pid ;
+		uid_t    uid ;
+		int      nice ;
+		uint64_t ticks ;      // utime + stime.
+		uint64_t start ;      // Start time after boot in ticks, to spot a reused PID.
+		uint64_t rss ;        // Resident pages.
+		float    cpu ;
+		float    mem ;
+		bool     ok ;
+		string   cmd ;
+} ;
+
+
+class task_sampler
+{
+	public:
+		task_sampler() ;
+
+		void sample( vector<task_dtls>& ) ;
+
+		const string& username( uid_t ) ;
+
+	private:
+		bool read_task( task_dtls& ) const ;
+
+		ssize_t read_proc( int,
+				   const char*,
+				   char*,
+				   size_t ) const ;
+
+		map<pid_t, pair<uint64_t, uint64_t>> prev ;
+
+		map<uid_t, string> users ;
+
+		std::chrono::steady_clock::time_point prev_time ;
+
+		long clktck ;
+		long pagesize ;
+
+		uint64_t memtotal ;
+} ;
+
+
+class journal_pager
+{
+	public:
+		journal_pager() ;
+		~journal_pager() ;
+
+		int open( const vector<string>& ) ;
+
+		void top() ;
+		void bottom( uint ) ;
+		void down( uint ) ;
+		void up( uint ) ;
+
+		void read( uint,
+			   vector<string>&,
+			   vector<int>& ) ;
+
+		bool at_top() const
+		{
+			return ( first == "" ) ;
+		}
+
+	private:
+		bool seek_first() ;
+
+		string cursor() ;
+
+		string get_field( const char* ) ;
+
+		sd_journal* j ;
+
+		string first ;              // Cursor of the first entry shown, blank for the head.
+
+		vector<string> cursors ;    // Cursors of the entries in the visible window.
+} ;
+
+
 class Unit_cc
 {
 	public:
@@ -387,19 +545,11 @@ class psysutl : public pApplication
 		void application() ;
 
 	private:
-		boost::condition cond_collector ;
-
 		boost::thread* bThread ;
 
-		boost::mutex mtx ;
-
-		vector<string> pstat_details1 ;
-		vector<string> pstat_details2 ;
+		static sys_sampler sysmon ;
 
-		vector<string> pvmstat_details1 ;
-		vector<string> pvmstat_details2 ;
-
-		bool collector_a ;
+		bool subscribed ;
 
 #ifdef WITH_NETHOGS
 		static void onNethogsUpdate( int,
@@ -496,8 +646,10 @@ class psysutl : public pApplication
 
 		bool showJournal_buildTable( const string& ) ;
 
+		void showJournal_entries( const string&,
+					  const string& = "" ) ;
+
 		void showSystemUsage() ;
-		void showSystemUsage_cleanup() ;
 		void showSystemUsage_build( const string&,
 					    string&,
 					    string&,
@@ -524,10 +676,12 @@ class psysutl : public pApplication
 					    string&,
 					    string&,
 					    string&,
+					    string&,
+					    string&,
 					    string& ) ;
-		void showSystemUsage_stats( vector<string>& ) ;
-		void showSystemUsage_vmstats( vector<string>& ) ;
-		void showSystemUsage_collector() ;
+
+		void sysmon_subscribe() ;
+		void sysmon_unsubscribe() ;
 
 		void showMounts() ;
 		void showMounts_build( const string&,
@@ -570,15 +724,17 @@ class psysutl : public pApplication
 
 		void showTasks() ;
 		void showTasks_buildTable( const string&,
-						 string&,
-						 string&,
-						 string&,
-						 string&,
-						 string&,
-						 string&,
-						 string&,
-						 const string& = "",
-						 const string& = "" ) ;
+					   task_sampler&,
+					   string&,
+					   string&,
+					   string&,
+					   string&,
+					   string&,
+					   string&,
+					   string&,
+					   string&,
+					   const string& = "",
+					   const string& = "" ) ;
 
 		void showUSB() ;
 		void showUSB_build( const string&,
@@ -657,6 +813,8 @@ class psysutl : public pApplication
 					string&,
 					string&,
 					string&,
+					string&,
+					string&,
 					string& ) ;
 
 		void showPCI() ;
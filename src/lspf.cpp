@@ -61,6 +61,15 @@ boost::condition cond_batch ;
 #include "pTable.h"
 #include "pTable.cpp"
 
+#include "pWorkPool.h"
+#include "pWorkPool.cpp"
+
+#include "pDiff.h"
+#include "pDiff.cpp"
+
+#include "pProcess.h"
+#include "pProcess.cpp"
+
 #include "pPanel.h"
 #include "pFTailor.h"
 #include "pApplication.h"
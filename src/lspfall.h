@@ -25,6 +25,9 @@
 #include "pLSServ.h"
 #include "pWidgets.h"
 #include "pTable.h"
+#include "pWorkPool.h"
+#include "pDiff.h"
+#include "pProcess.h"
 #include "pPanel.h"
 #include "pFTailor.h"
 #include "pApplication.h"
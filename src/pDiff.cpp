@@ -0,0 +1,1718 @@
+/*
+  Copyright (c) 2015 Daniel John Erdos
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+#include <sys/stat.h>
+
+namespace lspf {
+
+lineDiff::lineDiff( const diffOptions& o )
+{
+	opts          = o ;
+	pa            = nullptr ;
+	pb            = nullptr ;
+	doff          = 0 ;
+	too_expensive = 0 ;
+
+	if ( opts.ignre != "" )
+	{
+		ignregex.assign( opts.ignre ) ;
+	}
+}
+
+
+void lineDiff::compare( const vector<string>& a,
+			const vector<string>& b,
+			bool noeol_a,
+			bool noeol_b )
+{
+	//
+	// Compare lines a (old) with lines b (new).  Result is available from hunks().
+	// noeol_a/noeol_b indicate the last line has no newline, so it does not match
+	// the same line with a newline unless white space at the end of lines is being ignored
+	// (-b, -w or -Z), as diff.
+	//
+
+	size_t n = a.size() ;
+	size_t m = b.size() ;
+
+	pa = &a ;
+	pb = &b ;
+
+	dhunks.clear() ;
+
+	tokenise( a, ta, noeol_a ) ;
+	tokenise( b, tb, noeol_b ) ;
+	tokens.clear() ;
+
+	ca.assign( n, 0 ) ;
+	cb.assign( m, 0 ) ;
+
+	fd.assign( n + m + 3, 0 ) ;
+	bd.assign( n + m + 3, 0 ) ;
+	doff = m + 1 ;
+
+	//
+	// Give up looking for the shortest edit script after about sqrt(n+m) diagonals (minimum 4096).
+	//
+
+	too_expensive = 1 ;
+	for ( size_t d = n + m + 3 ; d != 0 ; d >>= 2 )
+	{
+		too_expensive <<= 1 ;
+	}
+	too_expensive = max( too_expensive, ssize_t( 4096 ) ) ;
+
+	patience( 0, n, 0, m ) ;
+
+	build_hunks() ;
+
+	vector<ssize_t>().swap( fd ) ;
+	vector<ssize_t>().swap( bd ) ;
+}
+
+
+string lineDiff::normalise( const string& s ) const
+{
+	//
+	// Return the form of the line used for comparison.
+	//
+	// For -b (as diff) each run of whitespace becomes a single blank, including a leading run, and
+	// trailing whitespace is removed.  So "  a" and " a" compare equal but differ from "a".
+	//
+
+	string t ;
+
+	t.reserve( s.size() ) ;
+
+	if ( opts.itabs )
+	{
+		t = expand( s ) ;
+	}
+	else
+	{
+		t = s ;
+	}
+
+	if ( opts.iallsp )
+	{
+		t.erase( remove_if( t.begin(), t.end(),
+			[]( char c )
+			{
+				return isspace( c ) ;
+			} ), t.end() ) ;
+	}
+	else if ( opts.ispace )
+	{
+		size_t j = 0 ;
+		bool sp  = false ;
+		for ( size_t i = 0 ; i < t.size() ; ++i )
+		{
+			if ( isspace( t[ i ] ) )
+			{
+				sp = true ;
+				continue ;
+			}
+			if ( sp )
+			{
+				t[ j++ ] = ' ' ;
+			}
+			sp = false ;
+			t[ j++ ] = t[ i ] ;
+		}
+		t.resize( j ) ;
+	}
+	else if ( opts.itrail )
+	{
+		size_t i = t.find_last_not_of( " \t\r\f\v" ) ;
+		t.resize( ( i == string::npos ) ? 0 : i + 1 ) ;
+	}
+
+	if ( opts.icase )
+	{
+		transform( t.begin(), t.end(), t.begin(), ::tolower ) ;
+	}
+
+	return t ;
+}
+
+
+void lineDiff::tokenise( const vector<string>& in,
+			 vector<uint>& out,
+			 bool noeol )
+{
+	//
+	// Replace each line by a number so equal lines (after normalisation) have the same number.
+	// A last line without a newline is given a key that cannot match a complete line, except when
+	// trailing white space is ignored.  diff then treats the missing newline as trailing white space.
+	//
+
+	string key ;
+
+	out.resize( in.size() ) ;
+
+	noeol = noeol && !opts.ispace && !opts.iallsp && !opts.itrail ;
+
+	for ( size_t i = 0 ; i < in.size() ; ++i )
+	{
+		key = normalise( in[ i ] ) ;
+		if ( noeol && i == in.size() - 1 )
+		{
+			key.push_back( '\n' ) ;
+		}
+		auto r = tokens.insert( make_pair( key, uint( tokens.size() ) ) ) ;
+		out[ i ] = r.first->second ;
+	}
+}
+
+
+void lineDiff::patience( size_t xoff,
+			 size_t xlim,
+			 size_t yoff,
+			 size_t ylim )
+{
+	//
+	// Match lines that are unique in both ranges, keep the longest sequence of these
+	// that is in the same order in both files, and compare the gaps between them.
+	//
+
+	struct ucount
+	{
+		uint   na ;
+		uint   nb ;
+		size_t pb ;
+	} ;
+
+	size_t i ;
+	size_t k ;
+	size_t x ;
+	size_t y ;
+
+	vector<size_t> ax ;
+	vector<size_t> by ;
+	vector<size_t> tails ;
+	vector<size_t> prev ;
+	vector<size_t> lis ;
+
+	unordered_map<uint, ucount> u ;
+
+	while ( xoff < xlim && yoff < ylim && ta[ xoff ] == tb[ yoff ] )
+	{
+		++xoff ;
+		++yoff ;
+	}
+
+	while ( xlim > xoff && ylim > yoff && ta[ xlim - 1 ] == tb[ ylim - 1 ] )
+	{
+		--xlim ;
+		--ylim ;
+	}
+
+	if ( xoff == xlim || yoff == ylim )
+	{
+		compareseq( xoff, xlim, yoff, ylim ) ;
+		return ;
+	}
+
+	for ( i = xoff ; i < xlim ; ++i )
+	{
+		ucount& c = u[ ta[ i ] ] ;
+		++c.na ;
+	}
+
+	for ( i = yoff ; i < ylim ; ++i )
+	{
+		auto it = u.find( tb[ i ] ) ;
+		if ( it != u.end() && it->second.nb++ == 0 )
+		{
+			it->second.pb = i ;
+		}
+	}
+
+	for ( i = xoff ; i < xlim ; ++i )
+	{
+		const ucount& c = u[ ta[ i ] ] ;
+		if ( c.na == 1 && c.nb == 1 )
+		{
+			ax.push_back( i ) ;
+			by.push_back( c.pb ) ;
+		}
+	}
+
+	//
+	// Longest increasing subsequence of the B positions (patience sorting).
+	//
+
+	prev.resize( by.size() ) ;
+	for ( i = 0 ; i < by.size() ; ++i )
+	{
+		k = lower_bound( tails.begin(), tails.end(), by[ i ],
+			[ &by ]( size_t t, size_t v )
+			{
+				return by[ t ] < v ;
+			} ) - tails.begin() ;
+		prev[ i ] = ( k > 0 ) ? tails[ k - 1 ] : string::npos ;
+		if ( k == tails.size() )
+		{
+			tails.push_back( i ) ;
+		}
+		else
+		{
+			tails[ k ] = i ;
+		}
+	}
+
+	if ( tails.empty() )
+	{
+		compareseq( xoff, xlim, yoff, ylim ) ;
+		return ;
+	}
+
+	for ( i = tails.back() ; i != string::npos ; i = prev[ i ] )
+	{
+		lis.push_back( i ) ;
+	}
+
+	x = xoff ;
+	y = yoff ;
+	for ( auto it = lis.rbegin() ; it != lis.rend() ; ++it )
+	{
+		compareseq( x, ax[ *it ], y, by[ *it ] ) ;
+		x = ax[ *it ] + 1 ;
+		y = by[ *it ] + 1 ;
+	}
+
+	compareseq( x, xlim, y, ylim ) ;
+}
+
+
+void lineDiff::compareseq( size_t xoff,
+			   size_t xlim,
+			   size_t yoff,
+			   size_t ylim )
+{
+	//
+	// Mark the changed lines in ranges [xoff,xlim) of A and [yoff,ylim) of B by
+	// splitting at the middle snake of the shortest edit script.
+	//
+
+	size_t i ;
+	size_t xmid ;
+	size_t ymid ;
+
+	while ( xoff < xlim && yoff < ylim && ta[ xoff ] == tb[ yoff ] )
+	{
+		++xoff ;
+		++yoff ;
+	}
+
+	while ( xlim > xoff && ylim > yoff && ta[ xlim - 1 ] == tb[ ylim - 1 ] )
+	{
+		--xlim ;
+		--ylim ;
+	}
+
+	if ( xoff == xlim )
+	{
+		for ( i = yoff ; i < ylim ; ++i ) { cb[ i ] = 1 ; }
+		return ;
+	}
+
+	if ( yoff == ylim )
+	{
+		for ( i = xoff ; i < xlim ; ++i ) { ca[ i ] = 1 ; }
+		return ;
+	}
+
+	diag( xoff, xlim, yoff, ylim, xmid, ymid ) ;
+
+	if ( ( xmid == xoff && ymid == yoff ) || ( xmid == xlim && ymid == ylim ) )
+	{
+		for ( i = xoff ; i < xlim ; ++i ) { ca[ i ] = 1 ; }
+		for ( i = yoff ; i < ylim ; ++i ) { cb[ i ] = 1 ; }
+		return ;
+	}
+
+	compareseq( xoff, xmid, yoff, ymid ) ;
+	compareseq( xmid, xlim, ymid, ylim ) ;
+}
+
+
+void lineDiff::diag( size_t xoff,
+		     size_t xlim,
+		     size_t yoff,
+		     size_t ylim,
+		     size_t& xmid,
+		     size_t& ymid )
+{
+	//
+	// Find the midpoint of the shortest edit script for the ranges, searching forwards from
+	// the start and backwards from the end until the paths overlap.
+	//
+	// If the cost exceeds too_expensive, return the furthest point reached on any diagonal.
+	//
+
+	ssize_t* F = fd.data() + doff ;
+	ssize_t* B = bd.data() + doff ;
+
+	const ssize_t dmin = ssize_t( xoff ) - ssize_t( ylim ) ;
+	const ssize_t dmax = ssize_t( xlim ) - ssize_t( yoff ) ;
+	const ssize_t fmid = ssize_t( xoff ) - ssize_t( yoff ) ;
+	const ssize_t bmid = ssize_t( xlim ) - ssize_t( ylim ) ;
+
+	const ssize_t sxoff = xoff ;
+	const ssize_t sxlim = xlim ;
+	const ssize_t syoff = yoff ;
+	const ssize_t sylim = ylim ;
+
+	ssize_t fmin = fmid ;
+	ssize_t fmax = fmid ;
+	ssize_t bmin = bmid ;
+	ssize_t bmax = bmid ;
+
+	ssize_t c ;
+	ssize_t d ;
+	ssize_t x ;
+	ssize_t y ;
+	ssize_t tlo ;
+	ssize_t thi ;
+
+	ssize_t fxybest ;
+	ssize_t fxbest = 0 ;
+	ssize_t bxybest ;
+	ssize_t bxbest = 0 ;
+
+	const bool odd = ( fmid - bmid ) & 1 ;
+
+	F[ fmid ] = xoff ;
+	B[ bmid ] = xlim ;
+
+	for ( c = 1 ;; ++c )
+	{
+		if ( fmin > dmin ) { F[ --fmin - 1 ] = -1 ; }
+		else               { ++fmin ; }
+		if ( fmax < dmax ) { F[ ++fmax + 1 ] = -1 ; }
+		else               { --fmax ; }
+		for ( d = fmax ; d >= fmin ; d -= 2 )
+		{
+			tlo = F[ d - 1 ] ;
+			thi = F[ d + 1 ] ;
+			x   = ( tlo >= thi ) ? tlo + 1 : thi ;
+			y   = x - d ;
+			while ( x < sxlim && y < sylim && ta[ x ] == tb[ y ] )
+			{
+				++x ;
+				++y ;
+			}
+			F[ d ] = x ;
+			if ( odd && bmin <= d && d <= bmax && B[ d ] <= x )
+			{
+				xmid = x ;
+				ymid = y ;
+				return ;
+			}
+		}
+
+		if ( bmin > dmin ) { B[ --bmin - 1 ] = SSIZE_MAX ; }
+		else               { ++bmin ; }
+		if ( bmax < dmax ) { B[ ++bmax + 1 ] = SSIZE_MAX ; }
+		else               { --bmax ; }
+		for ( d = bmax ; d >= bmin ; d -= 2 )
+		{
+			tlo = B[ d - 1 ] ;
+			thi = B[ d + 1 ] ;
+			x   = ( tlo < thi ) ? tlo : thi - 1 ;
+			y   = x - d ;
+			while ( x > sxoff && y > syoff && ta[ x - 1 ] == tb[ y - 1 ] )
+			{
+				--x ;
+				--y ;
+			}
+			B[ d ] = x ;
+			if ( !odd && fmin <= d && d <= fmax && x <= F[ d ] )
+			{
+				xmid = x ;
+				ymid = y ;
+				return ;
+			}
+		}
+
+		if ( opts.minimal || c < too_expensive ) { continue ; }
+
+		fxybest = -1 ;
+		for ( d = fmax ; d >= fmin ; d -= 2 )
+		{
+			x = min( F[ d ], sxlim ) ;
+			y = x - d ;
+			if ( sylim < y )
+			{
+				x = sylim + d ;
+				y = sylim ;
+			}
+			if ( fxybest < x + y )
+			{
+				fxybest = x + y ;
+				fxbest  = x ;
+			}
+		}
+
+		bxybest = SSIZE_MAX ;
+		for ( d = bmax ; d >= bmin ; d -= 2 )
+		{
+			x = max( sxoff, B[ d ] ) ;
+			y = x - d ;
+			if ( y < syoff )
+			{
+				x = syoff + d ;
+				y = syoff ;
+			}
+			if ( x + y < bxybest )
+			{
+				bxybest = x + y ;
+				bxbest  = x ;
+			}
+		}
+
+		if ( ( sxlim + sylim ) - bxybest < fxybest - ( sxoff + syoff ) )
+		{
+			xmid = fxbest ;
+			ymid = fxybest - fxbest ;
+		}
+		else
+		{
+			xmid = bxbest ;
+			ymid = bxybest - bxbest ;
+		}
+		return ;
+	}
+}
+
+
+void lineDiff::build_hunks()
+{
+	//
+	// Create the list of hunks from the changed line flags.
+	// With the ignore blank lines or ignore regex options, drop hunks where every
+	// line can be ignored.
+	//
+
+	size_t i  = 0 ;
+	size_t j  = 0 ;
+	size_t a1 ;
+	size_t b1 ;
+	size_t k  ;
+
+	bool blank ;
+
+	const size_t n = ca.size() ;
+	const size_t m = cb.size() ;
+
+	while ( i < n || j < m )
+	{
+		if ( i < n && j < m && !ca[ i ] && !cb[ j ] )
+		{
+			++i ;
+			++j ;
+			continue ;
+		}
+		a1 = i ;
+		b1 = j ;
+		while ( i < n && ca[ i ] ) { ++i ; }
+		while ( j < m && cb[ j ] ) { ++j ; }
+		if ( i == a1 && j == b1 )
+		{
+			//
+			// Should not happen.  Lines left over on one side only.
+			//
+			if ( i < n ) { ++i ; }
+			if ( j < m ) { ++j ; }
+			dhunks.push_back( diffHunk( a1, i - a1, b1, j - b1 ) ) ;
+			continue ;
+		}
+		if ( opts.iblank || opts.ignre != "" )
+		{
+			blank = true ;
+			for ( k = a1 ; k < i && blank ; ++k )
+			{
+				blank = is_ignored( ( *pa )[ k ] ) ;
+			}
+			for ( k = b1 ; k < j && blank ; ++k )
+			{
+				blank = is_ignored( ( *pb )[ k ] ) ;
+			}
+			if ( blank ) { continue ; }
+		}
+		dhunks.push_back( diffHunk( a1, i - a1, b1, j - b1 ) ) ;
+	}
+}
+
+
+bool lineDiff::is_blank( const string& s ) const
+{
+	return normalise( s ).empty() ;
+}
+
+
+bool lineDiff::is_ignored( const string& s ) const
+{
+	return ( opts.iblank && is_blank( s ) ) ||
+	       ( opts.ignre != "" && boost::regex_search( s, ignregex ) ) ;
+}
+
+
+string lineDiff::expand( const string& s ) const
+{
+	//
+	// Expand tabs to spaces.
+	//
+
+	string t ;
+
+	if ( s.find( '\t' ) == string::npos )
+	{
+		return s ;
+	}
+
+	for ( char c : s )
+	{
+		if ( c == '\t' )
+		{
+			t.append( opts.tabsize - ( t.size() % opts.tabsize ), ' ' ) ;
+		}
+		else
+		{
+			t.push_back( c ) ;
+		}
+	}
+
+	return t ;
+}
+
+
+string lineDiff::range( size_t first,
+			size_t count ) const
+{
+	//
+	// Line range in diff normal format (1-based).
+	// An empty range is shown as the line before the change.
+	//
+
+	if ( count == 0 )
+	{
+		return d2ds( first ) ;
+	}
+	else if ( count == 1 )
+	{
+		return d2ds( first + 1 ) ;
+	}
+
+	return d2ds( first + 1 ) + "," + d2ds( first + count ) ;
+}
+
+
+void lineDiff::normal( vector<string>& out,
+			const diffFormat& f ) const
+{
+	//
+	// Create output in diff normal format.
+	//
+
+	size_t i ;
+	size_t k ;
+
+	char c ;
+
+	for ( const auto& h : dhunks )
+	{
+		c = ( h.a_count == 0 ) ? 'a' : ( h.b_count == 0 ) ? 'd' : 'c' ;
+		out.push_back( colour( range( h.a_first, h.a_count ) + c + range( h.b_first, h.b_count ), "36", f ) ) ;
+		for ( i = 0 ; i < h.a_count ; ++i )
+		{
+			k = h.a_first + i ;
+			out.push_back( colour( "< " + text( ( *pa )[ k ], f ), "31", f ) ) ;
+			if ( f.noeol_a && k == pa->size() - 1 )
+			{
+				out.push_back( "\\ No newline at end of file" ) ;
+			}
+		}
+		if ( c == 'c' )
+		{
+			out.push_back( "---" ) ;
+		}
+		for ( i = 0 ; i < h.b_count ; ++i )
+		{
+			k = h.b_first + i ;
+			out.push_back( colour( "> " + text( ( *pb )[ k ], f ), "32", f ) ) ;
+			if ( f.noeol_b && k == pb->size() - 1 )
+			{
+				out.push_back( "\\ No newline at end of file" ) ;
+			}
+		}
+	}
+}
+
+
+void lineDiff::context( vector<string>& out,
+			const diffFormat& f ) const
+{
+	//
+	// Create output in diff context format.  Changed lines are flagged with '!' on both
+	// sides, deleted lines with '-' and inserted lines with '+'.
+	//
+
+	size_t a1 ;
+	size_t a2 ;
+	size_t b1 ;
+	size_t b2 ;
+	size_t i ;
+	size_t g ;
+	size_t k ;
+
+	bool dels ;
+	bool inss ;
+
+	vector<pair<size_t, size_t>> grps ;
+
+	out.push_back( colour( "*** " + f.label_a, "1", f ) ) ;
+	out.push_back( colour( "--- " + f.label_b, "1", f ) ) ;
+
+	groups( f.context, grps ) ;
+
+	for ( const auto& gr : grps )
+	{
+		const diffHunk& h1 = dhunks[ gr.first ] ;
+		const diffHunk& h2 = dhunks[ gr.second ] ;
+		k  = min( size_t( f.context ), min( h1.a_first, h1.b_first ) ) ;
+		a1 = h1.a_first - k ;
+		b1 = h1.b_first - k ;
+		a2 = h2.a_first + h2.a_count ;
+		b2 = h2.b_first + h2.b_count ;
+		k  = min( size_t( f.context ), min( pa->size() - a2, pb->size() - b2 ) ) ;
+		a2 += k ;
+		b2 += k ;
+		dels = false ;
+		inss = false ;
+		for ( g = gr.first ; g <= gr.second ; ++g )
+		{
+			if ( dhunks[ g ].a_count > 0 ) { dels = true ; }
+			if ( dhunks[ g ].b_count > 0 ) { inss = true ; }
+		}
+		out.push_back( "***************" ) ;
+		out.push_back( colour( "*** " + range( a1, a2 - a1 ) + " ****", "36", f ) ) ;
+		if ( dels )
+		{
+			i = a1 ;
+			for ( g = gr.first ; g <= gr.second ; ++g )
+			{
+				const diffHunk& h = dhunks[ g ] ;
+				for ( ; i < h.a_first ; ++i )
+				{
+					out.push_back( "  " + text( ( *pa )[ i ], f ) ) ;
+				}
+				for ( ; i < h.a_first + h.a_count ; ++i )
+				{
+					out.push_back( colour( ( ( h.b_count > 0 ) ? "! " : "- " ) + text( ( *pa )[ i ], f ), "31", f ) ) ;
+				}
+			}
+			for ( ; i < a2 ; ++i )
+			{
+				out.push_back( "  " + text( ( *pa )[ i ], f ) ) ;
+			}
+			if ( f.noeol_a && a2 == pa->size() )
+			{
+				out.push_back( "\\ No newline at end of file" ) ;
+			}
+		}
+		out.push_back( colour( "--- " + range( b1, b2 - b1 ) + " ----", "36", f ) ) ;
+		if ( inss )
+		{
+			i = b1 ;
+			for ( g = gr.first ; g <= gr.second ; ++g )
+			{
+				const diffHunk& h = dhunks[ g ] ;
+				for ( ; i < h.b_first ; ++i )
+				{
+					out.push_back( "  " + text( ( *pb )[ i ], f ) ) ;
+				}
+				for ( ; i < h.b_first + h.b_count ; ++i )
+				{
+					out.push_back( colour( ( ( h.a_count > 0 ) ? "! " : "+ " ) + text( ( *pb )[ i ], f ), "32", f ) ) ;
+				}
+			}
+			for ( ; i < b2 ; ++i )
+			{
+				out.push_back( "  " + text( ( *pb )[ i ], f ) ) ;
+			}
+			if ( f.noeol_b && b2 == pb->size() )
+			{
+				out.push_back( "\\ No newline at end of file" ) ;
+			}
+		}
+	}
+}
+
+
+void lineDiff::unified( vector<string>& out,
+			const diffFormat& f ) const
+{
+	//
+	// Create output in diff unified format.  This is the format used for patches.
+	//
+
+	size_t a1 ;
+	size_t a2 ;
+	size_t b1 ;
+	size_t b2 ;
+	size_t i ;
+	size_t j ;
+	size_t g ;
+	size_t k ;
+
+	vector<pair<size_t, size_t>> grps ;
+
+	auto common = [ &, this ]()
+	{
+		out.push_back( " " + text( ( *pa )[ i ], f ) ) ;
+		if ( f.noeol_a && i == pa->size() - 1 )
+		{
+			out.push_back( "\\ No newline at end of file" ) ;
+		}
+		++i ;
+		++j ;
+	} ;
+
+	out.push_back( colour( "--- " + f.label_a, "1", f ) ) ;
+	out.push_back( colour( "+++ " + f.label_b, "1", f ) ) ;
+
+	groups( f.context, grps ) ;
+
+	for ( const auto& gr : grps )
+	{
+		const diffHunk& h1 = dhunks[ gr.first ] ;
+		const diffHunk& h2 = dhunks[ gr.second ] ;
+		k  = min( size_t( f.context ), min( h1.a_first, h1.b_first ) ) ;
+		a1 = h1.a_first - k ;
+		b1 = h1.b_first - k ;
+		a2 = h2.a_first + h2.a_count ;
+		b2 = h2.b_first + h2.b_count ;
+		k  = min( size_t( f.context ), min( pa->size() - a2, pb->size() - b2 ) ) ;
+		a2 += k ;
+		b2 += k ;
+		out.push_back( colour( "@@ -" + urange( a1, a2 - a1 ) + " +" + urange( b1, b2 - b1 ) + " @@", "36", f ) ) ;
+		i = a1 ;
+		j = b1 ;
+		for ( g = gr.first ; g <= gr.second ; ++g )
+		{
+			const diffHunk& h = dhunks[ g ] ;
+			while ( i < h.a_first )
+			{
+				common() ;
+			}
+			for ( ; i < h.a_first + h.a_count ; ++i )
+			{
+				out.push_back( colour( "-" + text( ( *pa )[ i ], f ), "31", f ) ) ;
+				if ( f.noeol_a && i == pa->size() - 1 )
+				{
+					out.push_back( "\\ No newline at end of file" ) ;
+				}
+			}
+			for ( ; j < h.b_first + h.b_count ; ++j )
+			{
+				out.push_back( colour( "+" + text( ( *pb )[ j ], f ), "32", f ) ) ;
+				if ( f.noeol_b && j == pb->size() - 1 )
+				{
+					out.push_back( "\\ No newline at end of file" ) ;
+				}
+			}
+		}
+		while ( i < a2 )
+		{
+			common() ;
+		}
+	}
+}
+
+
+void lineDiff::ed_script( vector<string>& out,
+			  const diffFormat& f ) const
+{
+	//
+	// Create an ed script to change file A into file B.  Hunks are output last to first
+	// so line numbers remain valid as the script is applied.
+	//
+
+	size_t i ;
+
+	for ( auto it = dhunks.rbegin() ; it != dhunks.rend() ; ++it )
+	{
+		const diffHunk& h = *it ;
+		if ( h.a_count == 0 )
+		{
+			out.push_back( d2ds( h.a_first ) + "a" ) ;
+		}
+		else
+		{
+			out.push_back( range( h.a_first, h.a_count ) + ( ( h.b_count == 0 ) ? "d" : "c" ) ) ;
+		}
+		if ( h.b_count > 0 )
+		{
+			for ( i = 0 ; i < h.b_count ; ++i )
+			{
+				out.push_back( text( ( *pb )[ h.b_first + i ], f ) ) ;
+			}
+			out.push_back( "." ) ;
+		}
+	}
+}
+
+
+void lineDiff::rcs( vector<string>& out,
+		    const diffFormat& f ) const
+{
+	//
+	// Create output in RCS format.  Line numbers refer to the original file A.
+	//
+
+	size_t i ;
+
+	for ( const auto& h : dhunks )
+	{
+		if ( h.a_count > 0 )
+		{
+			out.push_back( "d" + d2ds( h.a_first + 1 ) + " " + d2ds( h.a_count ) ) ;
+		}
+		if ( h.b_count > 0 )
+		{
+			out.push_back( "a" + d2ds( h.a_first + h.a_count ) + " " + d2ds( h.b_count ) ) ;
+			for ( i = 0 ; i < h.b_count ; ++i )
+			{
+				out.push_back( text( ( *pb )[ h.b_first + i ], f ) ) ;
+			}
+		}
+	}
+}
+
+
+void lineDiff::side_by_side( vector<string>& out,
+			     const diffFormat& f ) const
+{
+	//
+	// Create output with both files side by side (as diff -y).  Gutter characters:
+	//   |  line changed.
+	//   <  line only in A.
+	//   >  line only in B.
+	//
+	// Tabs are always expanded so the columns line up.
+	//
+
+	size_t i = 0 ;
+	size_t j = 0 ;
+	size_t k ;
+
+	uint hw = ( f.width > 7 ) ? ( f.width - 3 ) / 2 : 2 ;
+
+	auto col = [ this, hw ]( const string& s )
+	{
+		string t = expand( s ) ;
+		t.resize( hw, ' ' ) ;
+		return t ;
+	} ;
+
+	auto line = [ this, hw ]( const string& l, const string& g, const string& r )
+	{
+		string t = l + g + expand( r ).substr( 0, hw ) ;
+		size_t p = t.find_last_not_of( ' ' ) ;
+		t.resize( ( p == string::npos ) ? 0 : p + 1 ) ;
+		return t ;
+	} ;
+
+	for ( const auto& h : dhunks )
+	{
+		for ( ; i < h.a_first ; ++i, ++j )
+		{
+			if ( !f.suppress )
+			{
+				out.push_back( line( col( ( *pa )[ i ] ), "   ", ( *pb )[ j ] ) ) ;
+			}
+		}
+		for ( k = 0 ; k < h.a_count || k < h.b_count ; ++k )
+		{
+			if ( k < h.a_count && k < h.b_count )
+			{
+				out.push_back( line( col( ( *pa )[ i++ ] ), " | ", ( *pb )[ j++ ] ) ) ;
+			}
+			else if ( k < h.a_count )
+			{
+				out.push_back( line( col( ( *pa )[ i++ ] ), " <", "" ) ) ;
+			}
+			else
+			{
+				out.push_back( line( string( hw, ' ' ), " > ", ( *pb )[ j++ ] ) ) ;
+			}
+		}
+	}
+
+	for ( ; i < pa->size() && j < pb->size() && !f.suppress ; ++i, ++j )
+	{
+		out.push_back( line( col( ( *pa )[ i ] ), "   ", ( *pb )[ j ] ) ) ;
+	}
+}
+
+
+void lineDiff::format( vector<string>& out,
+		       const diffFormat& f ) const
+{
+	//
+	// Create output of the last compare in the requested format.
+	//
+
+	out.clear() ;
+
+	switch ( f.type )
+	{
+	case DF_NORMAL:
+		normal( out, f ) ;
+		break ;
+
+	case DF_CONTEXT:
+		context( out, f ) ;
+		break ;
+
+	case DF_UNIFIED:
+		unified( out, f ) ;
+		break ;
+
+	case DF_ED:
+		ed_script( out, f ) ;
+		break ;
+
+	case DF_RCS:
+		rcs( out, f ) ;
+		break ;
+
+	case DF_SIDE:
+		side_by_side( out, f ) ;
+		break ;
+	}
+}
+
+
+void lineDiff::groups( uint ctx,
+		       vector<pair<size_t, size_t>>& grps ) const
+{
+	//
+	// Group hunks that are close enough for their context lines to overlap.
+	// Each entry is the index of the first and last hunk in the group.
+	//
+
+	size_t g ;
+
+	grps.clear() ;
+
+	for ( g = 0 ; g < dhunks.size() ; ++g )
+	{
+		if ( g > 0 && dhunks[ g ].a_first - ( dhunks[ g - 1 ].a_first + dhunks[ g - 1 ].a_count ) <= 2 * ctx )
+		{
+			grps.back().second = g ;
+		}
+		else
+		{
+			grps.push_back( make_pair( g, g ) ) ;
+		}
+	}
+}
+
+
+string lineDiff::urange( size_t first,
+			 size_t count ) const
+{
+	//
+	// Line range in diff unified format (1-based start,count).
+	// An empty range is shown as the line before the change with a count of 0.
+	//
+
+	if ( count == 0 )
+	{
+		return d2ds( first ) + ",0" ;
+	}
+	else if ( count == 1 )
+	{
+		return d2ds( first + 1 ) ;
+	}
+
+	return d2ds( first + 1 ) + "," + d2ds( count ) ;
+}
+
+
+string lineDiff::text( const string& s,
+		       const diffFormat& f ) const
+{
+	return ( f.expand ) ? expand( s ) : s ;
+}
+
+
+string lineDiff::colour( const string& s,
+			 const char* sgr,
+			 const diffFormat& f ) const
+{
+	//
+	// Add ANSI colour sequences around s if requested (as diff --color).
+	//
+
+	return ( f.colour ) ? "\x1b[" + string( sgr ) + "m" + s + "\x1b[0m" : s ;
+}
+
+
+bool diff_read_file( const string& file,
+		     vector<string>& lines,
+		     bool& noeol,
+		     bool& binary )
+{
+	//
+	// Read file into lines.  Set noeol if the last line has no newline character and binary
+	// if the file contains a NUL character.  Return false if the file cannot be read (errno set).
+	//
+
+	int fd ;
+
+	ssize_t r ;
+
+	size_t p ;
+	size_t q ;
+
+	string buf ;
+
+	char b[ 65536 ] ;
+
+	lines.clear() ;
+	noeol  = false ;
+	binary = false ;
+
+	fd = open( file.c_str(), O_RDONLY | O_CLOEXEC ) ;
+	if ( fd < 0 ) { return false ; }
+
+	while ( ( r = read( fd, b, sizeof( b ) ) ) != 0 )
+	{
+		if ( r < 0 )
+		{
+			if ( errno == EINTR ) { continue ; }
+			int e = errno ;
+			close( fd ) ;
+			errno = e ;
+			return false ;
+		}
+		buf.append( b, r ) ;
+	}
+
+	close( fd ) ;
+
+	binary = ( memchr( buf.data(), 0, buf.size() ) != nullptr ) ;
+
+	for ( p = 0 ; p < buf.size() ; p = q + 1 )
+	{
+		q = buf.find( '\n', p ) ;
+		if ( q == string::npos )
+		{
+			lines.push_back( buf.substr( p ) ) ;
+			noeol = true ;
+			break ;
+		}
+		lines.push_back( buf.substr( p, q - p ) ) ;
+	}
+
+	return true ;
+}
+
+
+static string diff_file_label( const string& file,
+			       bool exists )
+{
+	//
+	// Header label for context and unified format: file name and modification time.
+	// Files that do not exist are given the epoch.
+	//
+
+	struct stat st ;
+	struct tm t ;
+
+	time_t secs = 0 ;
+	long   nsec = 0 ;
+
+	char buf[ 64 ] ;
+	char zone[ 16 ] ;
+
+	if ( exists && stat( file.c_str(), &st ) == 0 )
+	{
+		secs = st.st_mtim.tv_sec ;
+		nsec = st.st_mtim.tv_nsec ;
+	}
+
+	localtime_r( &secs, &t ) ;
+	strftime( buf, sizeof( buf ), "%Y-%m-%d %H:%M:%S", &t ) ;
+	strftime( zone, sizeof( zone ), "%z", &t ) ;
+
+	return file + "\t" + buf + "." + d2ds( nsec, 9, '0' ) + " " + zone ;
+}
+
+
+int diff_files( const string& f1,
+		const string& f2,
+		const diffOptions& o,
+		const diffFormat& f,
+		vector<string>& out,
+		bool newfile )
+{
+	//
+	// Compare files f1 and f2 and create the output in out.
+	// With newfile, a file that does not exist is treated as empty (as diff -N).
+	//
+	// Return 0 files the same.
+	//        1 files differ.
+	//        2 error reading a file.
+	//
+
+	bool bin_a ;
+	bool bin_b ;
+	bool ex_a = true ;
+	bool ex_b = true ;
+
+	diffFormat g( f ) ;
+
+	vector<string> a ;
+	vector<string> b ;
+
+	out.clear() ;
+
+	if ( !diff_read_file( f1, a, g.noeol_a, bin_a ) )
+	{
+		if ( !newfile || errno != ENOENT ) { return 2 ; }
+		ex_a = false ;
+	}
+
+	if ( !diff_read_file( f2, b, g.noeol_b, bin_b ) )
+	{
+		if ( !newfile || errno != ENOENT ) { return 2 ; }
+		ex_b = false ;
+	}
+
+	if ( ( bin_a || bin_b ) && !o.text )
+	{
+		if ( a == b && g.noeol_a == g.noeol_b ) { return 0 ; }
+		out.push_back( "Binary files " + f1 + " and " + f2 + " differ" ) ;
+		return 1 ;
+	}
+
+	lineDiff ld( o ) ;
+
+	ld.compare( a, b, g.noeol_a, g.noeol_b ) ;
+	if ( !ld.differ() ) { return 0 ; }
+
+	if ( g.label_a == "" ) { g.label_a = diff_file_label( f1, ex_a ) ; }
+	if ( g.label_b == "" ) { g.label_b = diff_file_label( f2, ex_b ) ; }
+
+	ld.format( out, g ) ;
+
+	return 1 ;
+}
+
+
+static int diff_entry_type( const string& path )
+{
+	//
+	// 0 does not exist, 1 regular file, 2 directory, 3 anything else.
+	//
+
+	struct stat st ;
+
+	if ( stat( path.c_str(), &st ) != 0 ) { return 0 ; }
+
+	return S_ISREG( st.st_mode ) ? 1 : S_ISDIR( st.st_mode ) ? 2 : 3 ;
+}
+
+
+static void diff_dir_entries( const string& d1,
+			      const string& d2,
+			      const diffOptions& o,
+			      const diffFormat& f,
+			      const string& excl,
+			      vector<string>& out,
+			      int& rc )
+{
+	int r ;
+	int t1 ;
+	int t2 ;
+
+	string p1 ;
+	string p2 ;
+
+	set<string> names ;
+
+	vector<string> fout ;
+
+	DIR* dp ;
+
+	struct dirent* de ;
+
+	for ( const string* d : { &d1, &d2 } )
+	{
+		dp = opendir( d->c_str() ) ;
+		if ( !dp )
+		{
+			if ( errno != ENOENT ) { rc = 2 ; }
+			continue ;
+		}
+		while ( ( de = readdir( dp ) ) )
+		{
+			if ( strcmp( de->d_name, "." ) == 0 || strcmp( de->d_name, ".." ) == 0 ) { continue ; }
+			if ( excl != "" && fnmatch( excl.c_str(), de->d_name, 0 ) == 0 ) { continue ; }
+			names.insert( de->d_name ) ;
+		}
+		closedir( dp ) ;
+	}
+
+	for ( const auto& name : names )
+	{
+		p1 = d1 + "/" + name ;
+		p2 = d2 + "/" + name ;
+		t1 = diff_entry_type( p1 ) ;
+		t2 = diff_entry_type( p2 ) ;
+		if ( t1 == 3 || t2 == 3 ) { continue ; }
+		if ( t1 == 2 || t2 == 2 )
+		{
+			if ( t1 == 1 || t2 == 1 )
+			{
+				out.push_back( "File " + p1 + " is a " + ( ( t1 == 2 ) ? "directory" : "regular file" ) +
+					       " while file " + p2 + " is a " + ( ( t2 == 2 ) ? "directory" : "regular file" ) ) ;
+				rc = max( rc, 1 ) ;
+				continue ;
+			}
+			diff_dir_entries( p1, p2, o, f, excl, out, rc ) ;
+			continue ;
+		}
+		r = diff_files( p1, p2, o, f, fout, true ) ;
+		if ( r == 1 )
+		{
+			out.push_back( "diff -Naur " + p1 + " " + p2 ) ;
+			out.insert( out.end(), fout.begin(), fout.end() ) ;
+		}
+		rc = max( rc, r ) ;
+	}
+}
+
+
+int diff_dirs( const string& d1,
+	       const string& d2,
+	       const diffOptions& o,
+	       const diffFormat& f,
+	       const string& excl,
+	       vector<string>& out )
+{
+	//
+	// Compare directory trees d1 and d2.  Files only in one tree are compared with an empty file.
+	// Entries whose name matches the shell pattern excl are skipped.
+	// Return as diff_files().
+	//
+
+	int rc = 0 ;
+
+	out.clear() ;
+
+	diff_dir_entries( d1, d2, o, f, excl, out, rc ) ;
+
+	return rc ;
+}
+
+
+bool diff_parse_options( const string& str,
+			 diffOptions& o,
+			 diffFormat& f,
+			 string& msg )
+{
+	//
+	// Set options from a string of diff command line options.  Options that have no effect
+	// on the output of a compare (eg. -q -s -r -N) are accepted and ignored.
+	//
+	// Return false with msg set for an unknown or invalid option.
+	//
+
+	size_t i ;
+	size_t p ;
+
+	char q ;
+
+	string w ;
+	string arg ;
+	string name ;
+
+	vector<string> words ;
+
+	//
+	// Split into words, allowing quotes around words containing spaces.
+	//
+
+	for ( i = 0 ; i < str.size() ; )
+	{
+		if ( str[ i ] == ' ' ) { ++i ; continue ; }
+		w = "" ;
+		while ( i < str.size() && str[ i ] != ' ' )
+		{
+			if ( str[ i ] == '\'' || str[ i ] == '"' )
+			{
+				q = str[ i++ ] ;
+				while ( i < str.size() && str[ i ] != q ) { w.push_back( str[ i++ ] ) ; }
+				if ( i < str.size() ) { ++i ; }
+			}
+			else
+			{
+				w.push_back( str[ i++ ] ) ;
+			}
+		}
+		words.push_back( w ) ;
+	}
+
+	auto number = [ &msg ]( const string& n, const string& opt, uint& v )
+	{
+		if ( n == "" || !isnumeric( n ) || n.size() > 6 )
+		{
+			msg = "Invalid number for diff option " + opt ;
+			return false ;
+		}
+		v = ds2d( n ) ;
+		return true ;
+	} ;
+
+	for ( i = 0 ; i < words.size() ; ++i )
+	{
+		w = words[ i ] ;
+		if ( w.compare( 0, 2, "--" ) == 0 )
+		{
+			p    = w.find( '=' ) ;
+			name = w.substr( 0, p ) ;
+			arg  = ( p == string::npos ) ? "" : w.substr( p + 1 ) ;
+			if      ( name == "--ignore-case" )            { o.icase   = true ; }
+			else if ( name == "--ignore-space-change" )    { o.ispace  = true ; }
+			else if ( name == "--ignore-all-space" )       { o.iallsp  = true ; }
+			else if ( name == "--ignore-blank-lines" )     { o.iblank  = true ; }
+			else if ( name == "--ignore-tab-expansion" )   { o.itabs   = true ; }
+			else if ( name == "--ignore-trailing-space" )  { o.itrail  = true ; }
+			else if ( name == "--text" )                   { o.text    = true ; }
+			else if ( name == "--minimal" )                { o.minimal = true ; }
+			else if ( name == "--expand-tabs" )            { f.expand  = true ; }
+			else if ( name == "--suppress-common-lines" )  { f.suppress = true ; }
+			else if ( name == "--normal" )                 { f.type = DF_NORMAL ; }
+			else if ( name == "--ed" )                     { f.type = DF_ED     ; }
+			else if ( name == "--rcs" )                    { f.type = DF_RCS    ; }
+			else if ( name == "--side-by-side" )           { f.type = DF_SIDE   ; }
+			else if ( name == "--color" || name == "--colour" )
+			{
+				f.colour = ( arg != "never" ) ;
+			}
+			else if ( name == "--context" || name == "--unified" )
+			{
+				f.type = ( name == "--context" ) ? DF_CONTEXT : DF_UNIFIED ;
+				if ( arg != "" && !number( arg, name, f.context ) ) { return false ; }
+			}
+			else if ( name == "--width" )
+			{
+				if ( !number( arg, name, f.width ) ) { return false ; }
+			}
+			else if ( name == "--tabsize" )
+			{
+				if ( !number( arg, name, o.tabsize ) || o.tabsize == 0 ) { return false ; }
+			}
+			else if ( name == "--ignore-matching-lines" )
+			{
+				o.ignre = arg ;
+			}
+			else if ( name == "--brief" || name == "--report-identical-files" ||
+				  name == "--recursive" || name == "--new-file" || name == "--unidirectional-new-file" )
+			{
+			}
+			else
+			{
+				msg = "Unsupported diff option " + w ;
+				return false ;
+			}
+			continue ;
+		}
+		if ( w.size() < 2 || w.front() != '-' )
+		{
+			msg = "Unsupported diff option " + w ;
+			return false ;
+		}
+		for ( p = 1 ; p < w.size() ; ++p )
+		{
+			switch ( w[ p ] )
+			{
+			case 'i': o.icase   = true ; break ;
+			case 'b': o.ispace  = true ; break ;
+			case 'w': o.iallsp  = true ; break ;
+			case 'B': o.iblank  = true ; break ;
+			case 'E': o.itabs   = true ; break ;
+			case 'Z': o.itrail  = true ; break ;
+			case 'a': o.text    = true ; break ;
+			case 'd': o.minimal = true ; break ;
+			case 't': f.expand  = true ; break ;
+			case 'c': f.type = DF_CONTEXT ; break ;
+			case 'u': f.type = DF_UNIFIED ; break ;
+			case 'e': f.type = DF_ED      ; break ;
+			case 'n': f.type = DF_RCS     ; break ;
+			case 'y': f.type = DF_SIDE    ; break ;
+			case 'q':
+			case 's':
+			case 'r':
+			case 'N':
+				break ;
+
+			case 'C':
+			case 'U':
+			case 'W':
+			case 'I':
+				arg = w.substr( p + 1 ) ;
+				if ( arg == "" && i + 1 < words.size() )
+				{
+					arg = words[ ++i ] ;
+				}
+				if ( w[ p ] == 'I' )
+				{
+					o.ignre = arg ;
+				}
+				else if ( w[ p ] == 'W' )
+				{
+					if ( !number( arg, "-W", f.width ) ) { return false ; }
+				}
+				else
+				{
+					f.type = ( w[ p ] == 'C' ) ? DF_CONTEXT : DF_UNIFIED ;
+					if ( !number( arg, string( "-" ) + w[ p ], f.context ) ) { return false ; }
+				}
+				p = w.size() ;
+				break ;
+
+			default:
+				msg = "Unsupported diff option -" + string( 1, w[ p ] ) ;
+				return false ;
+			}
+		}
+	}
+
+	if ( o.ignre != "" )
+	{
+		try
+		{
+			boost::regex r( o.ignre ) ;
+		}
+		catch ( boost::regex_error& e )
+		{
+			msg = "Invalid regular expression " + o.ignre + ": " + e.what() ;
+			return false ;
+		}
+	}
+
+	return true ;
+}
+
+
+
+static const uint64_t xxh_p1 = 11400714785074694791ULL ;
+static const uint64_t xxh_p2 = 14029467366897019727ULL ;
+static const uint64_t xxh_p3 =  1609587929392839161ULL ;
+static const uint64_t xxh_p4 =  9650029242287828579ULL ;
+static const uint64_t xxh_p5 =  2870177450012600261ULL ;
+
+
+static inline uint64_t xxh_rotl( uint64_t x,
+				 int r )
+{
+	return ( x << r ) | ( x >> ( 64 - r ) ) ;
+}
+
+
+static inline uint64_t xxh_read64( const unsigned char* p )
+{
+	uint64_t v ;
+
+	memcpy( &v, p, sizeof( v ) ) ;
+
+	return v ;
+}
+
+
+static inline uint64_t xxh_round( uint64_t acc,
+				  uint64_t input )
+{
+	return xxh_rotl( acc + input * xxh_p2, 31 ) * xxh_p1 ;
+}
+
+
+static inline uint64_t xxh_merge( uint64_t acc,
+				  uint64_t val )
+{
+	return ( acc ^ xxh_round( 0, val ) ) * xxh_p1 + xxh_p4 ;
+}
+
+
+xxHash64::xxHash64( uint64_t s )
+{
+	seed   = s ;
+	total  = 0 ;
+	buflen = 0 ;
+	v[ 0 ] = s + xxh_p1 + xxh_p2 ;
+	v[ 1 ] = s + xxh_p2 ;
+	v[ 2 ] = s ;
+	v[ 3 ] = s - xxh_p1 ;
+}
+
+
+void xxHash64::update( const void* data,
+		       size_t len )
+{
+	//
+	// Add len bytes to the hash.  Input is consumed in 32 byte stripes, any remainder
+	// is kept until the next call or digest().
+	//
+
+	const unsigned char* p = static_cast<const unsigned char*>( data ) ;
+	const unsigned char* e = p + len ;
+
+	size_t n ;
+
+	total += len ;
+
+	if ( buflen > 0 )
+	{
+		n = min( len, sizeof( buf ) - buflen ) ;
+		memcpy( buf + buflen, p, n ) ;
+		buflen += n ;
+		p      += n ;
+		if ( buflen < sizeof( buf ) ) { return ; }
+		v[ 0 ] = xxh_round( v[ 0 ], xxh_read64( buf ) ) ;
+		v[ 1 ] = xxh_round( v[ 1 ], xxh_read64( buf + 8 ) ) ;
+		v[ 2 ] = xxh_round( v[ 2 ], xxh_read64( buf + 16 ) ) ;
+		v[ 3 ] = xxh_round( v[ 3 ], xxh_read64( buf + 24 ) ) ;
+		buflen = 0 ;
+	}
+
+	for ( ; e - p >= 32 ; p += 32 )
+	{
+		v[ 0 ] = xxh_round( v[ 0 ], xxh_read64( p ) ) ;
+		v[ 1 ] = xxh_round( v[ 1 ], xxh_read64( p + 8 ) ) ;
+		v[ 2 ] = xxh_round( v[ 2 ], xxh_read64( p + 16 ) ) ;
+		v[ 3 ] = xxh_round( v[ 3 ], xxh_read64( p + 24 ) ) ;
+	}
+
+	if ( p < e )
+	{
+		memcpy( buf, p, e - p ) ;
+		buflen = e - p ;
+	}
+}
+
+
+uint64_t xxHash64::digest() const
+{
+	uint64_t h ;
+	uint32_t k ;
+
+	const unsigned char* p = buf ;
+	const unsigned char* e = buf + buflen ;
+
+	if ( total >= 32 )
+	{
+		h = xxh_rotl( v[ 0 ], 1 ) + xxh_rotl( v[ 1 ], 7 ) + xxh_rotl( v[ 2 ], 12 ) + xxh_rotl( v[ 3 ], 18 ) ;
+		h = xxh_merge( h, v[ 0 ] ) ;
+		h = xxh_merge( h, v[ 1 ] ) ;
+		h = xxh_merge( h, v[ 2 ] ) ;
+		h = xxh_merge( h, v[ 3 ] ) ;
+	}
+	else
+	{
+		h = seed + xxh_p5 ;
+	}
+
+	h += total ;
+
+	for ( ; e - p >= 8 ; p += 8 )
+	{
+		h ^= xxh_round( 0, xxh_read64( p ) ) ;
+		h  = xxh_rotl( h, 27 ) * xxh_p1 + xxh_p4 ;
+	}
+
+	if ( e - p >= 4 )
+	{
+		memcpy( &k, p, sizeof( k ) ) ;
+		h ^= uint64_t( k ) * xxh_p1 ;
+		h  = xxh_rotl( h, 23 ) * xxh_p2 + xxh_p3 ;
+		p += 4 ;
+	}
+
+	for ( ; p < e ; ++p )
+	{
+		h ^= uint64_t( *p ) * xxh_p5 ;
+		h  = xxh_rotl( h, 11 ) * xxh_p1 ;
+	}
+
+	h ^= h >> 33 ;
+	h *= xxh_p2 ;
+	h ^= h >> 29 ;
+	h *= xxh_p3 ;
+	h ^= h >> 32 ;
+
+	return h ;
+}
+
+
+bool diff_hash_file( const string& file,
+		     uint64_t& h )
+{
+	//
+	// Return the xxHash64 of the contents of file.  Return false if the file cannot be read.
+	//
+
+	int fd ;
+
+	ssize_t r ;
+
+	xxHash64 xh ;
+
+	vector<char> b( 262144 ) ;
+
+	fd = open( file.c_str(), O_RDONLY | O_CLOEXEC ) ;
+	if ( fd < 0 ) { return false ; }
+
+	posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL ) ;
+
+	while ( ( r = read( fd, b.data(), b.size() ) ) != 0 )
+	{
+		if ( r < 0 )
+		{
+			if ( errno == EINTR ) { continue ; }
+			close( fd ) ;
+			return false ;
+		}
+		xh.update( b.data(), r ) ;
+	}
+
+	close( fd ) ;
+
+	h = xh.digest() ;
+
+	return true ;
+}
+
+}
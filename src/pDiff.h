@@ -0,0 +1,316 @@
+/*
+  Copyright (c) 2015 Daniel John Erdos
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+/*********************************************************************************************/
+/*                                                                                           */
+/* Line based file compare.                                                                  */
+/*                                                                                           */
+/* lineDiff     - compare two vectors of lines and produce a list of hunks.  Each line is    */
+/*                normalised according to the diffOptions and given a token number so        */
+/*                lines are compared as integers.                                            */
+/*                                                                                           */
+/*                Lines that occur exactly once in each file are matched first, keeping the  */
+/*                longest increasing sequence of them (patience diff).  The gaps between     */
+/*                these are then compared using the linear-space Myers algorithm with a cost */
+/*                limit so very different files do not take quadratic time.                  */
+/*                                                                                           */
+/*                The line vectors are not copied and must remain valid while the lineDiff   */
+/*                object is in use.                                                          */
+/*                                                                                           */
+/* diffHunk     - a range of lines in file A replaced by a range of lines in file B.  Line   */
+/*                numbers are zero based.  A count of zero means lines are only inserted or  */
+/*                only deleted, the first line being the position of the change.             */
+/*                                                                                           */
+/* diffFormat   - output format for lineDiff::format().  Normal, context, unified, ed script,*/
+/*                RCS and side-by-side formats are available, as produced by diff.           */
+/*                                                                                           */
+/* diff_files   - compare two files and format the result.  Returns 0 if the files are the   */
+/*                same, 1 if they differ and 2 on error (as the diff command).               */
+/*                                                                                           */
+/* diff_dirs    - compare two directory trees in unified format for use as a patch.  Missing */
+/*                files are treated as empty and all files as text (as diff -Naur).          */
+/*                                                                                           */
+/* diff_parse_options - set options and format from a string of diff command line options.   */
+/*                                                                                           */
+/* xxHash64     - 64-bit non-cryptographic hash (XXH64 algorithm) that can be fed in pieces. */
+/*                diff_hash_file() returns the hash of a file's contents.                    */
+/*                                                                                           */
+/*********************************************************************************************/
+
+#include <unordered_map>
+#include <climits>
+#include <boost/regex.hpp>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+
+namespace lspf {
+
+class diffOptions
+{
+	public:
+		diffOptions()
+		{
+			icase   = false ;
+			ispace  = false ;
+			iallsp  = false ;
+			iblank  = false ;
+			itabs   = false ;
+			itrail  = false ;
+			minimal = false ;
+			text    = false ;
+			tabsize = 8 ;
+		}
+
+		bool icase   ;       // -i  ignore case.
+		bool ispace  ;       // -b  ignore changes in the amount of white space.
+		bool iallsp  ;       // -w  ignore all white space.
+		bool iblank  ;       // -B  ignore changes where all lines are blank.
+		bool itabs   ;       // -E  ignore changes due to tab expansion.
+		bool itrail  ;       // -Z  ignore white space at line end.
+		bool minimal ;       // -d  no cost limit.
+		bool text    ;       // -a  treat all files as text.
+		uint tabsize ;
+		string ignre ;       // -I  ignore changes where all lines match this regex.
+} ;
+
+
+enum DIFF_FORMAT
+{
+	DF_NORMAL,
+	DF_CONTEXT,
+	DF_UNIFIED,
+	DF_ED,
+	DF_RCS,
+	DF_SIDE
+} ;
+
+
+class diffFormat
+{
+	public:
+		diffFormat( DIFF_FORMAT t = DF_NORMAL )
+		{
+			type     = t ;
+			context  = 3 ;
+			width    = 130 ;
+			expand   = false ;
+			colour   = false ;
+			suppress = false ;
+			noeol_a  = false ;
+			noeol_b  = false ;
+		}
+
+		DIFF_FORMAT type ;
+		uint   context  ;     // -C/-U  lines of context.
+		uint   width    ;     // -W     side-by-side output width.
+		bool   expand   ;     // -t     expand tabs in output.
+		bool   colour   ;     // --color  ANSI colour sequences.
+		bool   suppress ;     // --suppress-common-lines for side-by-side.
+		bool   noeol_a  ;     // Last line of file A/B has no newline.
+		bool   noeol_b  ;
+		string label_a  ;     // Header lines for context and unified format.
+		string label_b  ;
+} ;
+
+
+class diffHunk
+{
+	public:
+		diffHunk( size_t a1,
+			  size_t a2,
+			  size_t b1,
+			  size_t b2 )
+		{
+			a_first = a1 ;
+			a_count = a2 ;
+			b_first = b1 ;
+			b_count = b2 ;
+		}
+
+		size_t a_first ;
+		size_t a_count ;
+		size_t b_first ;
+		size_t b_count ;
+} ;
+
+
+class lineDiff
+{
+	public:
+		lineDiff( const diffOptions& o = diffOptions() ) ;
+
+		void compare( const vector<string>&,
+			      const vector<string>&,
+			      bool = false,
+			      bool = false ) ;
+
+		const vector<diffHunk>& hunks() const
+		{
+			return dhunks ;
+		}
+
+		bool differ() const
+		{
+			return !dhunks.empty() ;
+		}
+
+		void format( vector<string>&,
+			     const diffFormat& ) const ;
+
+	private:
+		string normalise( const string& ) const ;
+
+		void tokenise( const vector<string>&,
+			       vector<uint>&,
+			       bool ) ;
+
+		void patience( size_t,
+			       size_t,
+			       size_t,
+			       size_t ) ;
+
+		void compareseq( size_t,
+				 size_t,
+				 size_t,
+				 size_t ) ;
+
+		void diag( size_t,
+			   size_t,
+			   size_t,
+			   size_t,
+			   size_t&,
+			   size_t& ) ;
+
+		void build_hunks() ;
+
+		bool is_blank( const string& ) const ;
+
+		bool is_ignored( const string& ) const ;
+
+		string expand( const string& ) const ;
+
+		string range( size_t,
+			      size_t ) const ;
+
+		string urange( size_t,
+			       size_t ) const ;
+
+		void normal( vector<string>&,
+			     const diffFormat& ) const ;
+
+		void context( vector<string>&,
+			      const diffFormat& ) const ;
+
+		void unified( vector<string>&,
+			      const diffFormat& ) const ;
+
+		void ed_script( vector<string>&,
+				const diffFormat& ) const ;
+
+		void rcs( vector<string>&,
+			  const diffFormat& ) const ;
+
+		void side_by_side( vector<string>&,
+				   const diffFormat& ) const ;
+
+		void groups( uint,
+			     vector<pair<size_t, size_t>>& ) const ;
+
+		string text( const string&,
+			     const diffFormat& ) const ;
+
+		string colour( const string&,
+			       const char*,
+			       const diffFormat& ) const ;
+
+		diffOptions opts ;
+
+		boost::regex ignregex ;
+
+		const vector<string>* pa ;
+		const vector<string>* pb ;
+
+		vector<uint> ta ;
+		vector<uint> tb ;
+
+		vector<char> ca ;
+		vector<char> cb ;
+
+		vector<ssize_t> fd ;
+		vector<ssize_t> bd ;
+
+		ssize_t doff ;
+		ssize_t too_expensive ;
+
+		unordered_map<string, uint> tokens ;
+
+		vector<diffHunk> dhunks ;
+} ;
+
+
+bool diff_read_file( const string&,
+		     vector<string>&,
+		     bool&,
+		     bool& ) ;
+
+int diff_files( const string&,
+		const string&,
+		const diffOptions&,
+		const diffFormat&,
+		vector<string>&,
+		bool = false ) ;
+
+int diff_dirs( const string&,
+	       const string&,
+	       const diffOptions&,
+	       const diffFormat&,
+	       const string&,
+	       vector<string>& ) ;
+
+bool diff_parse_options( const string&,
+			 diffOptions&,
+			 diffFormat&,
+			 string& ) ;
+
+
+class xxHash64
+{
+	public:
+		xxHash64( uint64_t = 0 ) ;
+
+		void update( const void*,
+			     size_t ) ;
+
+		uint64_t digest() const ;
+
+	private:
+		uint64_t v[ 4 ] ;
+		uint64_t seed  ;
+		uint64_t total ;
+
+		unsigned char buf[ 32 ] ;
+		size_t buflen ;
+} ;
+
+
+bool diff_hash_file( const string&,
+		     uint64_t& ) ;
+
+}
@@ -0,0 +1,395 @@
+/*
+  Copyright (c) 2015 Daniel John Erdos
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+namespace lspf {
+
+subProcess::subProcess()
+{
+	pid         = -1 ;
+	fd_out      = -1 ;
+	fd_err      = -1 ;
+	epfd        = -1 ;
+	err         = 0  ;
+	exit_status = -1 ;
+	timedout    = false ;
+	stopped     = false ;
+	hard        = false ;
+}
+
+
+subProcess::~subProcess()
+{
+	//
+	// Make sure the command does not outlive us.
+	//
+
+	if ( pid > 0 )
+	{
+		::kill( -pid, SIGKILL ) ;
+		reap( true ) ;
+	}
+
+	close_fds() ;
+}
+
+
+bool subProcess::start( const string& cmd )
+{
+	//
+	// Start /bin/sh -c cmd.  Return false with error() set if it cannot be started.
+	//
+	// The child gets default signal handling and an empty signal mask, whatever lspf has set
+	// for its own threads.
+	//
+
+	int po[ 2 ] ;
+	int pe[ 2 ] ;
+	int rc ;
+
+	struct epoll_event ev ;
+
+	posix_spawn_file_actions_t fa ;
+	posix_spawnattr_t at ;
+
+	sigset_t mask ;
+	sigset_t defs ;
+
+	const int sigs[] = { SIGHUP, SIGINT, SIGQUIT, SIGPIPE, SIGTERM, SIGUSR1, SIGUSR2, SIGCHLD, SIGTSTP, SIGTTIN, SIGTTOU } ;
+
+	char* argv[] = { const_cast<char*>( "sh" ),
+			 const_cast<char*>( "-c" ),
+			 const_cast<char*>( cmd.c_str() ),
+			 nullptr } ;
+
+	if ( pipe2( po, O_CLOEXEC ) == -1 )
+	{
+		err = errno ;
+		return false ;
+	}
+
+	if ( pipe2( pe, O_CLOEXEC ) == -1 )
+	{
+		err = errno ;
+		close( po[ 0 ] ) ;
+		close( po[ 1 ] ) ;
+		return false ;
+	}
+
+	posix_spawn_file_actions_init( &fa ) ;
+	posix_spawn_file_actions_addopen( &fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0 ) ;
+	posix_spawn_file_actions_adddup2( &fa, po[ 1 ], STDOUT_FILENO ) ;
+	posix_spawn_file_actions_adddup2( &fa, pe[ 1 ], STDERR_FILENO ) ;
+
+	sigemptyset( &mask ) ;
+	sigemptyset( &defs ) ;
+	for ( auto s : sigs )
+	{
+		sigaddset( &defs, s ) ;
+	}
+
+	posix_spawnattr_init( &at ) ;
+	posix_spawnattr_setflags( &at, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF ) ;
+	posix_spawnattr_setpgroup( &at, 0 ) ;
+	posix_spawnattr_setsigmask( &at, &mask ) ;
+	posix_spawnattr_setsigdefault( &at, &defs ) ;
+
+	rc = posix_spawn( &pid, "/bin/sh", &fa, &at, argv, environ ) ;
+
+	posix_spawn_file_actions_destroy( &fa ) ;
+	posix_spawnattr_destroy( &at ) ;
+
+	close( po[ 1 ] ) ;
+	close( pe[ 1 ] ) ;
+
+	if ( rc != 0 )
+	{
+		err = rc ;
+		pid = -1 ;
+		close( po[ 0 ] ) ;
+		close( pe[ 0 ] ) ;
+		return false ;
+	}
+
+	fd_out = po[ 0 ] ;
+	fd_err = pe[ 0 ] ;
+
+	fcntl( fd_out, F_SETFL, fcntl( fd_out, F_GETFL ) | O_NONBLOCK ) ;
+	fcntl( fd_err, F_SETFL, fcntl( fd_err, F_GETFL ) | O_NONBLOCK ) ;
+
+	epfd = epoll_create1( EPOLL_CLOEXEC ) ;
+	if ( epfd == -1 )
+	{
+		err = errno ;
+		kill() ;
+		return false ;
+	}
+
+	ev.events  = EPOLLIN ;
+	ev.data.fd = fd_out ;
+	epoll_ctl( epfd, EPOLL_CTL_ADD, fd_out, &ev ) ;
+
+	ev.data.fd = fd_err ;
+	epoll_ctl( epfd, EPOLL_CTL_ADD, fd_err, &ev ) ;
+
+	return true ;
+}
+
+
+bool subProcess::run( const std::function<bool(const string&, bool)>& f,
+		      uint timeout,
+		      const std::function<bool()>& cancel )
+{
+	//
+	// Pass the output of the command to f a line at a time (second parameter true for stderr) until
+	// both pipes are closed and the command has ended.
+	//
+	// timeout - milliseconds before the command is killed (0 no limit).
+	// cancel  - kill the command if this returns true.
+	//
+	// A killed command is sent SIGTERM, then SIGKILL after 2 seconds.  If something it started still
+	// has the pipes open 1 second after that, stop waiting for them.
+	//
+	// Return true if the command ran to completion.
+	//
+
+	int i ;
+	int n ;
+	int open = 2 ;
+
+	string buf_out ;
+	string buf_err ;
+
+	struct epoll_event ev[ 2 ] ;
+
+	boost::posix_time::ptime now ;
+	boost::posix_time::ptime deadline ;
+
+	if ( epfd == -1 ) { return false ; }
+
+	now      = boost::posix_time::microsec_clock::universal_time() ;
+	deadline = now + boost::posix_time::milliseconds( timeout ) ;
+
+	while ( true )
+	{
+		if ( open == 0 && reap( false ) )
+		{
+			break ;
+		}
+		now = boost::posix_time::microsec_clock::universal_time() ;
+		if ( !stopped )
+		{
+			if ( cancel && cancel() )
+			{
+				kill() ;
+			}
+			else if ( timeout > 0 && now >= deadline )
+			{
+				timedout = true ;
+				kill() ;
+			}
+		}
+		else if ( !hard && now >= kill_time + boost::posix_time::seconds( 2 ) )
+		{
+			if ( pid > 0 ) { ::kill( -pid, SIGKILL ) ; }
+			hard      = true ;
+			kill_time = now ;
+		}
+		else if ( hard && now >= kill_time + boost::posix_time::seconds( 1 ) && reap( false ) )
+		{
+			break ;
+		}
+		if ( open == 0 )
+		{
+			boost::this_thread::sleep_for( boost::chrono::milliseconds( 10 ) ) ;
+			continue ;
+		}
+		n = epoll_wait( epfd, ev, 2, 100 ) ;
+		if ( n == -1 && errno != EINTR )
+		{
+			err = errno ;
+			kill() ;
+			open = 0 ;
+			continue ;
+		}
+		for ( i = 0 ; i < n ; ++i )
+		{
+			if ( !read_pipe( ev[ i ].data.fd,
+					 ( ev[ i ].data.fd == fd_out ) ? buf_out : buf_err,
+					 ( ev[ i ].data.fd == fd_err ),
+					 f ) )
+			{
+				epoll_ctl( epfd, EPOLL_CTL_DEL, ev[ i ].data.fd, nullptr ) ;
+				--open ;
+			}
+		}
+	}
+
+	close_fds() ;
+
+	return ( !stopped && err == 0 ) ;
+}
+
+
+bool subProcess::read_pipe( int fd,
+			    string& buf,
+			    bool e,
+			    const std::function<bool(const string&, bool)>& f )
+{
+	//
+	// Read what is available on pipe fd and pass complete lines to f.  At end of file, pass any
+	// partial last line.  Return false at end of file.
+	//
+	// Once the command has been killed, lines are read but not passed on.
+	//
+
+	ssize_t r ;
+
+	size_t p ;
+	size_t s ;
+
+	char b[ 65536 ] ;
+
+	while ( true )
+	{
+		r = read( fd, b, sizeof( b ) ) ;
+		if ( r > 0 )
+		{
+			p = buf.size() ;
+			s = 0 ;
+			buf.append( b, r ) ;
+			while ( ( p = buf.find( '\n', p ) ) != string::npos )
+			{
+				if ( !stopped && !f( buf.substr( s, p - s ), e ) )
+				{
+					kill() ;
+				}
+				s = ++p ;
+			}
+			buf.erase( 0, s ) ;
+			continue ;
+		}
+		if ( r == -1 && errno == EINTR )
+		{
+			continue ;
+		}
+		if ( r == -1 && errno == EAGAIN )
+		{
+			return true ;
+		}
+		if ( !buf.empty() && !stopped && !f( buf, e ) )
+		{
+			kill() ;
+		}
+		buf.clear() ;
+		return false ;
+	}
+}
+
+
+void subProcess::kill()
+{
+	//
+	// Send SIGTERM to the command's process group.  run() follows this with SIGKILL.
+	//
+
+	if ( stopped ) { return ; }
+
+	if ( pid > 0 )
+	{
+		::kill( -pid, SIGTERM ) ;
+	}
+
+	stopped   = true ;
+	kill_time = boost::posix_time::microsec_clock::universal_time() ;
+}
+
+
+bool subProcess::reap( bool block )
+{
+	//
+	// Collect the exit status of the command if it has ended.  Return true if it has.
+	//
+
+	int st ;
+
+	pid_t r ;
+
+	if ( pid <= 0 ) { return true ; }
+
+	while ( ( r = waitpid( pid, &st, ( block ) ? 0 : WNOHANG ) ) == -1 && errno == EINTR ) {}
+
+	if ( r == pid )
+	{
+		exit_status = ( WIFEXITED( st ) ) ? WEXITSTATUS( st ) : 128 + WTERMSIG( st ) ;
+		pid = -1 ;
+		return true ;
+	}
+
+	if ( r == -1 )
+	{
+		pid = -1 ;
+		return true ;
+	}
+
+	return false ;
+}
+
+
+void subProcess::close_fds()
+{
+	if ( fd_out != -1 ) { close( fd_out ) ; fd_out = -1 ; }
+	if ( fd_err != -1 ) { close( fd_err ) ; fd_err = -1 ; }
+	if ( epfd   != -1 ) { close( epfd   ) ; epfd   = -1 ; }
+}
+
+
+int run_command( const string& cmd,
+		 vector<string>& out,
+		 vector<string>* errs,
+		 const std::function<bool()>& cancel,
+		 uint timeout )
+{
+	//
+	// Run cmd adding its output lines to out and its error lines to errs (discarded if null).
+	// Return the exit status or -1 if the command could not be started.
+	//
+
+	subProcess p ;
+
+	if ( !p.start( cmd ) )
+	{
+		return -1 ;
+	}
+
+	p.run( [ &out, errs ]( const string& line, bool e )
+		{
+			if ( !e )
+			{
+				out.push_back( line ) ;
+			}
+			else if ( errs )
+			{
+				errs->push_back( line ) ;
+			}
+			return true ;
+		}, timeout, cancel ) ;
+
+	return p.status() ;
+}
+
+}
@@ -0,0 +1,116 @@
+/*
+  Copyright (c) 2015 Daniel John Erdos
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+/*********************************************************************************************/
+/*                                                                                           */
+/* Run shell commands without popen.                                                         */
+/*                                                                                           */
+/* subProcess   - start a command with posix_spawn ( /bin/sh -c cmd ) in its own process     */
+/*                group, with stdin from /dev/null and stdout/stderr on separate non-blocking*/
+/*                pipes.  run() waits on the pipes with epoll and passes each line to a      */
+/*                consumer as it arrives, so output can go straight into a table or file     */
+/*                without being collected first.                                             */
+/*                                                                                           */
+/*                The command is killed (the whole process group) if the consumer returns    */
+/*                false, the cancel function returns true or the timeout expires.  The cancel*/
+/*                function is checked at least every 100ms and when a signal (eg. SIGUSR1    */
+/*                from the lspf interrupt menu) interrupts the wait.                         */
+/*                                                                                           */
+/*                The exit status is collected with waitpid( WNOHANG ) once both pipes are   */
+/*                closed.  status() returns the exit code, or 128+signal if the command was  */
+/*                killed by a signal.                                                        */
+/*                                                                                           */
+/* run_command  - run a command and add its output lines to a vector (as popen/fgets did).   */
+/*                Returns the exit status, or -1 if the command could not be started.        */
+/*                                                                                           */
+/*********************************************************************************************/
+
+#include <functional>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+
+namespace lspf {
+
+class subProcess
+{
+	public:
+		subProcess() ;
+		~subProcess() ;
+
+		bool start( const string& ) ;
+
+		bool run( const std::function<bool(const string&, bool)>&,
+			  uint = 0,
+			  const std::function<bool()>& = nullptr ) ;
+
+		void kill() ;
+
+		int status() const
+		{
+			return exit_status ;
+		}
+
+		int error() const
+		{
+			return err ;
+		}
+
+		bool timed_out() const
+		{
+			return timedout ;
+		}
+
+		bool killed() const
+		{
+			return stopped ;
+		}
+
+	private:
+		bool read_pipe( int,
+				string&,
+				bool,
+				const std::function<bool(const string&, bool)>& ) ;
+
+		bool reap( bool ) ;
+
+		void close_fds() ;
+
+		pid_t pid ;
+
+		int fd_out ;
+		int fd_err ;
+		int epfd ;
+		int err ;
+		int exit_status ;
+
+		bool timedout ;
+		bool stopped ;
+		bool hard ;
+
+		boost::posix_time::ptime kill_time ;
+} ;
+
+
+int run_command( const string&,
+		 vector<string>&,
+		 vector<string>* = nullptr,
+		 const std::function<bool()>& = nullptr,
+		 uint = 0 ) ;
+
+}
@@ -0,0 +1,247 @@
+/*
+  Copyright (c) 2015 Daniel John Erdos
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+namespace lspf {
+
+workPool::workPool( uint n )
+{
+	active     = 0 ;
+	stopping   = false ;
+	cancel_req = false ;
+
+	if ( n == 0 )
+	{
+		n = default_size() ;
+	}
+
+	for ( uint i = 0 ; i < n ; ++i )
+	{
+		workers.push_back( new boost::thread( &workPool::worker, this ) ) ;
+	}
+}
+
+
+workPool::~workPool()
+{
+	{
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		stopping = true ;
+		tasks.clear() ;
+	}
+
+	cond_work.notify_all() ;
+
+	for ( auto t : workers )
+	{
+		t->join() ;
+		delete t ;
+	}
+}
+
+
+uint workPool::default_size()
+{
+	//
+	// Leave one processor for the application/screen thread but always have at least one worker.
+	//
+
+	uint n = boost::thread::hardware_concurrency() ;
+
+	return ( n > 2 ) ? n - 1 : 1 ;
+}
+
+
+void workPool::submit( const std::function<void()>& f )
+{
+	{
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		if ( cancel_req ) { return ; }
+		tasks.push_back( f ) ;
+	}
+
+	cond_work.notify_one() ;
+}
+
+
+void workPool::wait()
+{
+	//
+	// Wait for all queued tasks to complete.  Rethrow the first exception a task threw.
+	//
+
+	std::exception_ptr e ;
+
+	{
+		boost::unique_lock<boost::mutex> lock( mtx ) ;
+		while ( !tasks.empty() || active > 0 )
+		{
+			cond_idle.wait( lock ) ;
+		}
+		cancel_req = false ;
+		e    = eptr ;
+		eptr = nullptr ;
+	}
+
+	if ( e )
+	{
+		std::rethrow_exception( e ) ;
+	}
+}
+
+
+bool workPool::idle()
+{
+	boost::lock_guard<boost::mutex> lock( mtx ) ;
+
+	return ( tasks.empty() && active == 0 ) ;
+}
+
+
+void workPool::cancel()
+{
+	//
+	// Discard queued tasks.  Running tasks can check cancelled() and return early.
+	// The flag is reset by wait().
+	//
+
+	{
+		boost::lock_guard<boost::mutex> lock( mtx ) ;
+		cancel_req = true ;
+		tasks.clear() ;
+	}
+
+	cond_idle.notify_all() ;
+}
+
+
+void workPool::worker()
+{
+	std::function<void()> f ;
+
+	while ( true )
+	{
+		{
+			boost::unique_lock<boost::mutex> lock( mtx ) ;
+			while ( !stopping && tasks.empty() )
+			{
+				cond_work.wait( lock ) ;
+			}
+			if ( stopping ) { return ; }
+			f = tasks.front() ;
+			tasks.pop_front() ;
+			++active ;
+		}
+		try
+		{
+			f() ;
+		}
+		catch ( ... )
+		{
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			if ( !eptr ) { eptr = std::current_exception() ; }
+		}
+		{
+			boost::lock_guard<boost::mutex> lock( mtx ) ;
+			--active ;
+			if ( tasks.empty() && active == 0 )
+			{
+				cond_idle.notify_all() ;
+			}
+		}
+	}
+}
+
+
+uint parallel_chunks( size_t n,
+		      size_t min_chunk )
+{
+	//
+	// Return the number of chunks parallel_ranges() will split n items into.
+	// Chunks are never smaller than min_chunk items.
+	//
+
+	size_t chunks ;
+	size_t hw = boost::thread::hardware_concurrency() ;
+
+	if ( min_chunk == 0 ) { min_chunk = 1 ; }
+
+	chunks = min( hw, n / min_chunk ) ;
+
+	return ( chunks > 1 ) ? chunks : 1 ;
+}
+
+
+uint parallel_ranges( size_t n,
+		      size_t min_chunk,
+		      const std::function<void(size_t, size_t, uint)>& f )
+{
+	//
+	// Call f( begin, end, chunk ) for contiguous chunks covering [0,n).  The last chunk runs
+	// on the calling thread.  Return the number of chunks used.
+	//
+
+	uint chunks = parallel_chunks( n, min_chunk ) ;
+
+	std::exception_ptr e ;
+
+	boost::mutex emtx ;
+
+	vector<boost::thread*> threads ;
+
+	if ( chunks == 1 )
+	{
+		f( 0, n, 0 ) ;
+		return 1 ;
+	}
+
+	auto run = [ &f, &e, &emtx ]( size_t b, size_t e1, uint c )
+	{
+		try
+		{
+			f( b, e1, c ) ;
+		}
+		catch ( ... )
+		{
+			boost::lock_guard<boost::mutex> lock( emtx ) ;
+			if ( !e ) { e = std::current_exception() ; }
+		}
+	} ;
+
+	for ( uint c = 0 ; c < chunks - 1 ; ++c )
+	{
+		threads.push_back( new boost::thread( run, n * c / chunks, n * ( c + 1 ) / chunks, c ) ) ;
+	}
+
+	run( n * ( chunks - 1 ) / chunks, n, chunks - 1 ) ;
+
+	for ( auto t : threads )
+	{
+		t->join() ;
+		delete t ;
+	}
+
+	if ( e )
+	{
+		std::rethrow_exception( e ) ;
+	}
+
+	return chunks ;
+}
+
+}
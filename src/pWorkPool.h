@@ -0,0 +1,94 @@
+/*
+  Copyright (c) 2015 Daniel John Erdos
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+/*********************************************************************************************/
+/*                                                                                           */
+/* Worker pool for applications that need to spread work over several threads.              */
+/*                                                                                           */
+/* workPool        - fixed number of worker threads servicing a queue of tasks.              */
+/*                   wait() blocks until the queue is drained and all workers are idle.      */
+/*                   cancel() discards queued tasks and sets a flag running tasks can poll.  */
+/*                                                                                           */
+/* parallel_ranges - split [0,n) into contiguous chunks and run them on separate threads,    */
+/*                   returning when all chunks have completed.  The first exception thrown   */
+/*                   by a chunk is rethrown in the caller.                                   */
+/*                   parallel_chunks() returns the number of chunks that will be used so     */
+/*                   callers can size per-chunk result areas beforehand.                     */
+/*                                                                                           */
+/*********************************************************************************************/
+
+#include <functional>
+#include <deque>
+#include <exception>
+#include <atomic>
+
+namespace lspf {
+
+class workPool
+{
+	public:
+		explicit workPool( uint = 0 ) ;
+		~workPool() ;
+
+		void submit( const std::function<void()>& ) ;
+		void wait() ;
+		void cancel() ;
+
+		bool cancelled() const
+		{
+			return cancel_req ;
+		}
+
+		bool idle() ;
+
+		uint size() const
+		{
+			return workers.size() ;
+		}
+
+		static uint default_size() ;
+
+	private:
+		void worker() ;
+
+		boost::mutex mtx ;
+
+		boost::condition cond_work ;
+		boost::condition cond_idle ;
+
+		std::deque<std::function<void()>> tasks ;
+		vector<boost::thread*> workers ;
+
+		uint active ;
+
+		bool stopping ;
+		std::atomic<bool> cancel_req ;
+
+		std::exception_ptr eptr ;
+} ;
+
+
+uint parallel_chunks( size_t,
+		      size_t ) ;
+
+uint parallel_ranges( size_t,
+		      size_t,
+		      const std::function<void(size_t, size_t, uint)>& ) ;
+
+}